@@ -0,0 +1,415 @@
+// Season analytics over exported session files
+//
+// Reads the phone's copy of the session memory as export.js stores it
+// (export_file.h), or archives of it (archive.h, mapped rather than parsed), for
+// any number of athletes and seasons. Prints one line per athlete:
+//
+//   athlete=<name> sessions=<n> laps=<n> hours=<h> best=<t> p10=<t> median=<t> p90=<t> worst=<t>
+//     mean=<t> stdev=<t> cv=<%> fade=<%> [plan_delta=<t> on_plan=<%>]
+//
+// Files are named <athlete>[-<season>].json, or .rta for an archive, and the
+// seasons of one athlete are pooled. Lap times are formatted the way the watch formats them.
+//   - cv is the spread of lap times within a session, averaged over sessions.
+//   - fade is how much slower the second half of a session's laps is than the
+//     first, negative for a negative split.
+// Files are parsed, then athletes summarised, as tasks on a work-stealing pool
+// (pool.h). Each athlete is summed in file and session order by one task, so
+// the output is the same for any thread count.
+//
+// -p holds a pacer plan the way the watch does (plan.h), -r repeating it, in
+// place of the plan laps an archive was made with.
+//   - plan_delta is the mean split offset from the plan, as the lap overlay
+//     shows it.
+//   - on_plan is the share of laps within -t percent of their plan lap.
+// -s adds a line per session, as the watch lists them. -k scalar|sse2|avx2 picks
+// the kernels (kernels.h) rather than the best the CPU runs.
+//
+// -g writes a synthetic season set instead: two seasons of sessions for each
+// athlete, with the lap counts the watch can hold.
+//
+//   analytics [-j threads] [-k kernels] [-p plan] [-r] [-t tolerance_percent] [-s] file...
+//   analytics -g dir [-a athletes] [-n sessions_per_season] [-S seed]
+#include <getopt.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "pebble.h"
+#include "stopwatch.h"
+#include "archive.h"
+#include "export_file.h"
+#include "kernels.h"
+#include "plan.h"
+#include "pool.h"
+
+#define NAME_MAX_LEN 64
+
+typedef struct Export {
+  const char *path;
+  char athlete[NAME_MAX_LEN];
+  SessionSet set;
+  bool failed;
+} Export;
+
+typedef struct Athlete {
+  uint32_t first_export;  // Exports of one athlete are next to each other
+  uint32_t num_exports;
+  uint32_t num_sessions;
+  uint32_t num_laps;
+  int64_t total_cs;
+  int32_t lap_cs[5];      // Best, p10, median, p90, worst
+  int32_t mean_cs;
+  int32_t stdev_cs;
+  double cv;
+  double fade;
+  bool planned;
+  int32_t plan_delta_cs;
+  double on_plan;
+} Athlete;
+
+static Export *exports;
+static uint32_t num_exports;
+static Athlete *athletes;
+static uint32_t num_athletes;
+static bool plan;
+static double tolerance = 2.0;
+static int32_t *plan_lap_cs;   // Plan lap k, up to the longest session
+static uint32_t max_laps;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1e3 + ts.tv_nsec/1e6;
+}
+
+// m:ss.cc, or h:mm:ss.cc from an hour
+static void format_cs(char *str, size_t size, int32_t cs) {
+  SWTime t = SWTime_from_centisecond((cs < 0) ? -cs : cs);
+  const char *sign = (cs < 0) ? "-" : "";
+  if (t.hour > 0) {
+    snprintf(str, size, "%s%d:%02d:%02d.%02d", sign, t.hour, t.minute, t.second, t.centisecond);
+  } else {
+    snprintf(str, size, "%s%d:%02d.%02d", sign, t.minute, t.second, t.centisecond);
+  }
+}
+
+//----- Begin parsing
+// Athlete name from the file name, up to the season
+static void athlete_name(const char *path, char *name) {
+  const char *base = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+  size_t len = strcspn(base, "-.");
+  if (len >= NAME_MAX_LEN) { len = NAME_MAX_LEN-1; }
+  memcpy(name, base, len);
+  name[len] = '\0';
+}
+
+// Task: read export i, mapping it if it is an archive
+static void parse_export(void *ctx, uint32_t i) {
+  Export *e = &exports[i];
+  size_t len = strlen(e->path);
+  bool archive = len > 4 && strcmp(e->path + len - 4, ".rta") == 0;
+
+  athlete_name(e->path, e->athlete);
+  e->failed = archive ? !archive_read(e->path, &e->set) : !export_file_read(e->path, &e->set);
+}
+//----- End parsing
+
+//----- Begin statistics
+// Put the k-th smallest of v[lo..hi] at v[k], smaller ones before it and larger
+// ones after, so quantiles taken in increasing order can each narrow lo
+static void select_nth(int32_t *v, int32_t lo, int32_t hi, int32_t k) {
+  while (lo < hi) {
+    int32_t pivot = v[lo + (hi-lo)/2];
+    int32_t i = lo, j = hi;
+    while (i <= j) {
+      while (v[i] < pivot) { i++; }
+      while (v[j] > pivot) { j--; }
+      if (i <= j) {
+        int32_t t = v[i];
+        v[i++] = v[j];
+        v[j--] = t;
+      }
+    }
+    if (k <= j) {
+      hi = j;
+    } else if (k >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+}
+
+// Task: summarise athlete a over all its exports
+static void summarise_athlete(void *ctx, uint32_t a) {
+  Athlete *ath = &athletes[a];
+  int64_t sum = 0, sum_sq = 0;
+  int64_t plan_delta = 0;
+  uint32_t on_plan = 0;
+  uint32_t cv_sessions = 0;
+  double cv = 0, fade = 0;
+
+  for (uint32_t x=ath->first_export; x<ath->first_export+ath->num_exports; x++) {
+    ath->num_sessions += exports[x].set.num_sessions;
+    ath->num_laps += exports[x].set.num_laps;
+  }
+  if (ath->num_laps == 0) { return; }
+
+  // Sessions of one export are contiguous, so its laps are copied whole
+  int32_t *sorted = malloc(ath->num_laps * sizeof(int32_t));
+  int32_t *split = malloc(max_laps * sizeof(int32_t));
+  int32_t *target_split = malloc(max_laps * sizeof(int32_t));
+  uint32_t n = 0;
+  for (uint32_t x=ath->first_export; x<ath->first_export+ath->num_exports; x++) {
+    const SessionSet *e = &exports[x].set;
+    memcpy(sorted + n, e->lap_cs, e->num_laps * sizeof(int32_t));
+    n += e->num_laps;
+
+    for (uint32_t s=0; s<e->num_sessions; s++) {
+      const int32_t *lap = &e->lap_cs[e->first_lap[s]];
+      const int32_t *target = plan ? plan_lap_cs : e->target_cs ? &e->target_cs[e->first_lap[s]] : NULL;
+      uint32_t laps = e->first_lap[s+1] - e->first_lap[s];
+      KernelStats half[2];
+
+      // Halves, and the middle lap of an odd session, make up the session
+      kernel_stats(lap, laps/2, &half[0]);
+      kernel_stats(lap + laps - laps/2, laps/2, &half[1]);
+      int64_t s_sum = half[0].sum + half[1].sum + ((laps % 2) ? lap[laps/2] : 0);
+      int64_t s_sum_sq = half[0].sum_sq + half[1].sum_sq + ((laps % 2) ? (int64_t)lap[laps/2]*lap[laps/2] : 0);
+      sum += s_sum;
+      sum_sq += s_sum_sq;
+      if (laps >= 2) {
+        double mean = (double)s_sum / laps;
+        double var = (double)s_sum_sq / laps - mean*mean;
+        cv += (mean > 0) ? sqrt((var > 0) ? var : 0) / mean : 0;
+        fade += (half[0].sum > 0) ? (double)(half[1].sum - half[0].sum) / half[0].sum : 0;
+        cv_sessions++;
+      }
+
+      // The offset the lap overlay shows, and the lap against its plan lap
+      if (target) {
+        kernel_prefix_sum(lap, split, laps);
+        kernel_prefix_sum(target, target_split, laps);
+        for (uint32_t i=0; i<laps; i++) {
+          plan_delta += (split[i] > target_split[i]) ? split[i] - target_split[i] : target_split[i] - split[i];
+          if (fabs((double)(lap[i] - target[i])) <= target[i] * tolerance / 100) { on_plan++; }
+        }
+        ath->planned = true;
+      }
+    }
+  }
+  free(split);
+  free(target_split);
+
+  // Quantiles by selection rather than a full sort
+  uint32_t rank[5] = {0, (n-1) / 10, (n-1) / 2, (n-1) * 9 / 10, n-1};
+  for (int q=0, lo=0; q<5; q++) {
+    select_nth(sorted, lo, n-1, rank[q]);
+    ath->lap_cs[q] = sorted[rank[q]];
+    lo = rank[q];
+  }
+  free(sorted);
+
+  double mean = (double)sum / n;
+  double var = (double)sum_sq / n - mean*mean;
+  ath->total_cs = sum;
+  ath->mean_cs = (int32_t)lround(mean);
+  ath->stdev_cs = (int32_t)lround(sqrt((var > 0) ? var : 0));
+  ath->cv = cv_sessions ? 100 * cv / cv_sessions : 0;
+  ath->fade = cv_sessions ? 100 * fade / cv_sessions : 0;
+  ath->plan_delta_cs = (int32_t)(plan_delta / n);
+  ath->on_plan = 100.0 * on_plan / n;
+}
+//----- End statistics
+
+//----- Begin output
+static void print_sessions(const SessionSet *e) {
+  char total[24], best[24], date[32];
+  for (uint32_t s=0; s<e->num_sessions; s++) {
+    const int32_t *lap = &e->lap_cs[e->first_lap[s]];
+    uint32_t laps = e->first_lap[s+1] - e->first_lap[s];
+    int32_t split = 0, best_cs = lap[0];
+    for (uint32_t i=0; i<laps; i++) {
+      split += lap[i];
+      if (lap[i] < best_cs) { best_cs = lap[i]; }
+    }
+    time_t t = e->save_time[s];
+    strftime(date, sizeof(date), "%m/%d/%Y %I:%M %p", localtime(&t));
+    format_cs(total, sizeof(total), split);
+    format_cs(best, sizeof(best), best_cs);
+    printf("  session id=%u date=\"%s\" laps=%u total=%s best=%s\n", e->id[s], date, laps, total, best);
+  }
+}
+
+static void print_athlete(const Athlete *a) {
+  static const char *names[] = {"best", "p10", "median", "p90", "worst"};
+  const char *name = exports[a->first_export].athlete;
+  char str[24];
+
+  printf("athlete=%s sessions=%u laps=%u", name, a->num_sessions, a->num_laps);
+  if (a->num_laps == 0) {
+    putchar('\n');
+    return;
+  }
+  printf(" hours=%.1f", a->total_cs / 360000.0);
+  for (int i=0; i<5; i++) {
+    format_cs(str, sizeof(str), a->lap_cs[i]);
+    printf(" %s=%s", names[i], str);
+  }
+  format_cs(str, sizeof(str), a->mean_cs);
+  printf(" mean=%s", str);
+  format_cs(str, sizeof(str), a->stdev_cs);
+  printf(" stdev=%s cv=%.2f%% fade=%+.2f%%", str, a->cv, a->fade);
+  if (a->planned) {
+    format_cs(str, sizeof(str), a->plan_delta_cs);
+    printf(" plan_delta=%s on_plan=%.1f%%", str, a->on_plan);
+  }
+  putchar('\n');
+}
+//----- End output
+
+static int compare_paths(const void *a, const void *b) {
+  const Export *x = a, *y = b;
+  int c = strcmp(x->athlete, y->athlete);
+  return c ? c : strcmp(x->path, y->path);
+}
+
+//----- Begin synthetic exports
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+// Each athlete has a pace, a lap-to-lap spread and a tendency to fade or to
+// negative split, and races sessions of 1 to NUM_LAP_MEMORY-1 laps
+static int generate(const char *dir, uint32_t num_athletes, uint32_t num_sessions, uint32_t seed) {
+  char path[512];
+  int32_t lap_cs[NUM_LAP_MEMORY];
+  uint32_t id = 1;
+
+  rng_state = seed ? seed : 1;
+  mkdir(dir, 0777);
+  for (uint32_t a=0; a<num_athletes; a++) {
+    int32_t pace = 6000 + rng() % 6000;
+    int32_t spread = 50 + rng() % 300;
+    int32_t fade = (int32_t)(rng() % 1001) - 400;  // Per mille over a session
+    for (uint32_t season=0; season<2; season++) {
+      SessionSet set = {0};
+      for (uint32_t s=0; s<num_sessions; s++) {
+        uint32_t laps = 1 + rng() % (NUM_LAP_MEMORY-1);
+        uint32_t save_time = 1388534400 + season*31536000 + s*86400 + rng() % 36000;
+        for (uint32_t i=0; i<laps; i++) {
+          lap_cs[i] = pace + pace*fade/1000*(int32_t)i/(int32_t)laps + (int32_t)(rng() % (2*spread+1)) - spread;
+        }
+        session_set_add(&set, id++, save_time, lap_cs, laps);
+      }
+      snprintf(path, sizeof(path), "%s/a%04u-%u.json", dir, a, 2014+season);
+      if (!export_file_write(path, &set)) {
+        perror(path);
+        return 2;
+      }
+      session_set_free(&set);
+    }
+  }
+  return 0;
+}
+//----- End synthetic exports
+
+int main(int argc, char **argv) {
+  uint32_t threads = pool_default_threads();
+  const char *generate_dir = NULL;
+  const char *plan_spec = NULL;
+  uint32_t gen_athletes = 100, gen_sessions = 200, seed = 1;
+  bool sessions = false;
+  bool repeat = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:k:p:rt:sg:a:n:S:")) != -1) {
+    switch (opt) {
+      case 'j': threads = atoi(optarg); break;
+      case 'k':
+        if (!kernel_select_name(optarg)) {
+          fprintf(stderr, "analytics: kernels %s not available\n", optarg);
+          return 2;
+        }
+        break;
+      case 'p':
+        plan_spec = optarg;
+        plan = true;
+        break;
+      case 'r': repeat = true; break;
+      case 't': tolerance = atof(optarg); break;
+      case 's': sessions = true; break;
+      case 'g': generate_dir = optarg; break;
+      case 'a': gen_athletes = atoi(optarg); break;
+      case 'n': gen_sessions = atoi(optarg); break;
+      case 'S': seed = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-j threads] [-k kernels] [-p plan] [-r] [-t tolerance_percent] [-s] file...\n"
+                        "       %s -g dir [-a athletes] [-n sessions_per_season] [-S seed]\n", argv[0], argv[0]);
+        return 2;
+    }
+  }
+  if (generate_dir) { return generate(generate_dir, gen_athletes, gen_sessions, seed); }
+  if (plan && !plan_parse(plan_spec, repeat)) {
+    fprintf(stderr, "analytics: bad plan %s\n", plan_spec);
+    return 2;
+  }
+
+  num_exports = argc - optind;
+  exports = calloc(num_exports ? num_exports : 1, sizeof(Export));
+  for (uint32_t i=0; i<num_exports; i++) { exports[i].path = argv[optind+i]; }
+
+  double start = now_ms();
+  PoolStats parse_stats = pool_run(threads, num_exports, parse_export, NULL);
+  double parsed = now_ms();
+
+  // Group the exports by athlete
+  qsort(exports, num_exports, sizeof(Export), compare_paths);
+  athletes = calloc(num_exports ? num_exports : 1, sizeof(Athlete));
+  for (uint32_t i=0; i<num_exports; i++) {
+    if (exports[i].failed) {
+      perror(exports[i].path);
+      return 2;
+    }
+    if (num_athletes == 0 || strcmp(exports[i].athlete, exports[athletes[num_athletes-1].first_export].athlete) != 0) {
+      athletes[num_athletes++].first_export = i;
+    }
+    athletes[num_athletes-1].num_exports++;
+  }
+  // The plan is looked up once per lap, so its laps are worked out once up front
+  for (uint32_t i=0; i<num_exports; i++) {
+    const SessionSet *e = &exports[i].set;
+    for (uint32_t s=0; s<e->num_sessions; s++) {
+      uint32_t laps = e->first_lap[s+1] - e->first_lap[s];
+      if (laps > max_laps) { max_laps = laps; }
+    }
+  }
+  plan_lap_cs = plan ? plan_laps(max_laps) : NULL;
+
+  PoolStats stats_stats = pool_run(threads, num_athletes, summarise_athlete, NULL);
+  double done = now_ms();
+
+  uint64_t total_laps = 0;
+  uint32_t total_sessions = 0, malformed = 0;
+  for (uint32_t a=0; a<num_athletes; a++) {
+    print_athlete(&athletes[a]);
+    for (uint32_t x=athletes[a].first_export; sessions && x<athletes[a].first_export+athletes[a].num_exports; x++) {
+      print_sessions(&exports[x].set);
+    }
+    total_laps += athletes[a].num_laps;
+    total_sessions += athletes[a].num_sessions;
+  }
+  for (uint32_t i=0; i<num_exports; i++) { malformed += exports[i].set.malformed; }
+
+  // Timings vary from run to run, so they go to stderr and stdout can be compared
+  fprintf(stderr, "analytics: files=%u athletes=%u sessions=%u laps=%llu malformed=%u threads=%u steals=%u"
+                  " kernels=%s parse_ms=%.1f stats_ms=%.1f\n",
+          num_exports, num_athletes, total_sessions, (unsigned long long)total_laps, malformed,
+          parse_stats.threads > stats_stats.threads ? parse_stats.threads : stats_stats.threads,
+          parse_stats.steals + stats_stats.steals, kernel_level_name(kernel_level()), parsed - start, done - parsed);
+  return 0;
+}
\ No newline at end of file
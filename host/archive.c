@@ -0,0 +1,287 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "archive.h"
+
+#define ALIGN(n) (((n) + 7) & ~(uint64_t)7)
+
+struct Archive {
+  const uint8_t *base;
+  size_t size;
+};
+
+_Static_assert(sizeof(ArchiveHeader) == 32, "archive header layout");
+_Static_assert(sizeof(ArchiveSegment) == 16 + 16*ARCHIVE_NUM_COLUMNS, "archive segment layout");
+
+//----- Begin reading
+static bool column_ok(const ArchiveSegment *seg, uint64_t start, ArchiveColumn c, uint32_t count) {
+  const ArchiveColumnRef *col = &seg->column[c];
+  return col->count == count && col->offset % 8 == 0 && col->offset >= start + sizeof(ArchiveSegment) &&
+         col->offset + (uint64_t)count*4 <= start + seg->size;
+}
+
+// Check everything a reader indexes with, so a damaged file is refused at open
+// rather than read out of bounds later
+static bool validate(const Archive *a) {
+  const ArchiveHeader *h = (const ArchiveHeader *)a->base;
+  uint64_t offset = h->header_size;
+  uint64_t num_laps = 0;
+  uint32_t num_sessions = 0;
+
+  if (a->size < sizeof(ArchiveHeader) || h->magic != ARCHIVE_MAGIC || h->version != ARCHIVE_VERSION ||
+      h->header_size < sizeof(ArchiveHeader) || h->header_size % 8 != 0 || h->end > a->size) {
+    return false;
+  }
+  for (uint32_t i=0; i<h->num_segments; i++) {
+    const ArchiveSegment *seg = (const ArchiveSegment *)(a->base + offset);
+    if (offset + sizeof(ArchiveSegment) > h->end || seg->size < sizeof(ArchiveSegment) ||
+        seg->size % 8 != 0 || offset + seg->size > h->end) {
+      return false;
+    }
+    if (!column_ok(seg, offset, ARCHIVE_ID, seg->num_sessions) ||
+        !column_ok(seg, offset, ARCHIVE_SAVE_TIME, seg->num_sessions) ||
+        !column_ok(seg, offset, ARCHIVE_BOUNDS, seg->num_sessions+1) ||
+        !column_ok(seg, offset, ARCHIVE_LAPS, seg->num_laps) ||
+        !column_ok(seg, offset, ARCHIVE_TARGETS, seg->column[ARCHIVE_TARGETS].count ? seg->num_laps : 0)) {
+      return false;
+    }
+    const uint32_t *bounds = (const uint32_t *)(a->base + seg->column[ARCHIVE_BOUNDS].offset);
+    if (bounds[0] != 0 || bounds[seg->num_sessions] != seg->num_laps) { return false; }
+    for (uint32_t s=0; s<seg->num_sessions; s++) {
+      if (bounds[s] > bounds[s+1]) { return false; }
+    }
+    num_sessions += seg->num_sessions;
+    num_laps += seg->num_laps;
+    offset += seg->size;
+  }
+  return offset == h->end && num_sessions == h->num_sessions && num_laps == h->num_laps;
+}
+
+static Archive *map(int fd) {
+  Archive *a = malloc(sizeof(Archive));
+  struct stat st;
+  void *base;
+
+  if (!a || fstat(fd, &st) != 0) {
+    free(a);
+    return NULL;
+  }
+  a->size = st.st_size;
+  base = (a->size >= sizeof(ArchiveHeader)) ? mmap(NULL, a->size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  if (base == MAP_FAILED) {
+    if (a->size < sizeof(ArchiveHeader)) { errno = EINVAL; }
+    free(a);
+    return NULL;
+  }
+  a->base = base;
+  if (!validate(a)) {
+    archive_close(a);
+    errno = EINVAL;
+    return NULL;
+  }
+  return a;
+}
+
+// The file is mapped read-only for as long as the archive is open. NULL with
+// errno set if it cannot be, or is not a whole archive.
+Archive *archive_open(const char *path) {
+  int fd = open(path, O_RDONLY);
+  Archive *a;
+
+  if (fd < 0) { return NULL; }
+  a = map(fd);
+  close(fd);
+  return a;
+}
+
+void archive_close(Archive *archive) {
+  if (!archive) { return; }
+  munmap((void *)archive->base, archive->size);
+  free(archive);
+}
+
+const ArchiveHeader *archive_header(const Archive *archive) {
+  return (const ArchiveHeader *)archive->base;
+}
+
+// The first segment when segment is NULL, NULL after the last
+const ArchiveSegment *archive_next_segment(const Archive *archive, const ArchiveSegment *segment) {
+  const ArchiveHeader *h = archive_header(archive);
+  const uint8_t *next = segment ? (const uint8_t *)segment + segment->size : archive->base + h->header_size;
+  return (next < archive->base + h->end) ? (const ArchiveSegment *)next : NULL;
+}
+
+const void *archive_column(const Archive *archive, const ArchiveSegment *segment, ArchiveColumn column, uint32_t *count) {
+  *count = segment->column[column].count;
+  return archive->base + segment->column[column].offset;
+}
+
+// Every session in the archive, in the order they were appended, into an empty
+// set. Targets are zero for laps archived without a plan.
+bool archive_read(const char *path, SessionSet *set) {
+  Archive *a = archive_open(path);
+  bool targets = false;
+  uint32_t n;
+
+  if (!a) { return false; }
+  for (const ArchiveSegment *seg=archive_next_segment(a, NULL); seg; seg=archive_next_segment(a, seg)) {
+    const uint32_t *id = archive_column(a, seg, ARCHIVE_ID, &n);
+    const uint32_t *save_time = archive_column(a, seg, ARCHIVE_SAVE_TIME, &n);
+    const uint32_t *bounds = archive_column(a, seg, ARCHIVE_BOUNDS, &n);
+    const int32_t *lap_cs = archive_column(a, seg, ARCHIVE_LAPS, &n);
+    for (uint32_t s=0; s<seg->num_sessions; s++) {
+      session_set_add(set, id[s], save_time[s], &lap_cs[bounds[s]], bounds[s+1] - bounds[s]);
+    }
+    targets |= seg->column[ARCHIVE_TARGETS].count > 0;
+  }
+
+  if (targets && (set->target_cs = calloc(set->num_laps, sizeof(int32_t)))) {
+    int32_t *target_cs = set->target_cs;
+    for (const ArchiveSegment *seg=archive_next_segment(a, NULL); seg; seg=archive_next_segment(a, seg)) {
+      const int32_t *column = archive_column(a, seg, ARCHIVE_TARGETS, &n);
+      memcpy(target_cs, column, n * sizeof(int32_t));
+      target_cs += seg->num_laps;
+    }
+  }
+  archive_close(a);
+  return !targets || set->target_cs;
+}
+//----- End reading
+
+
+//----- Begin appending
+static int compare_ids(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static bool write_at(int fd, const void *buf, size_t len, uint64_t offset) {
+  const uint8_t *p = buf;
+  while (len > 0) {
+    ssize_t n = pwrite(fd, p, len, offset);
+    if (n <= 0) { return false; }
+    p += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+// Header of the archive open on fd, a fresh one if the file is empty, and the
+// ids already in it, sorted
+static bool read_ids(int fd, ArchiveHeader *h, uint32_t **ids) {
+  struct stat st;
+  uint32_t n = 0;
+
+  *h = (ArchiveHeader){.magic=ARCHIVE_MAGIC, .version=ARCHIVE_VERSION,
+                       .header_size=sizeof(ArchiveHeader), .end=sizeof(ArchiveHeader)};
+  if (fstat(fd, &st) != 0) { return false; }
+  if (st.st_size == 0) {
+    *ids = NULL;
+    return true;
+  }
+
+  Archive *a = map(fd);
+  if (!a) { return false; }
+  *h = *archive_header(a);
+  *ids = malloc((h->num_sessions ? h->num_sessions : 1) * sizeof(uint32_t));
+  for (const ArchiveSegment *seg=archive_next_segment(a, NULL); *ids && seg; seg=archive_next_segment(a, seg)) {
+    uint32_t count;
+    const uint32_t *id = archive_column(a, seg, ARCHIVE_ID, &count);
+    memcpy(*ids + n, id, count * sizeof(uint32_t));
+    n += count;
+  }
+  archive_close(a);
+  qsort(*ids, n, sizeof(uint32_t), compare_ids);
+  return *ids != NULL;
+}
+
+// The segment of the sessions of set marked in add, laid out to start at
+// offset start
+static uint8_t *build_segment(const SessionSet *set, const bool *add, uint64_t start, ArchiveSegment *seg) {
+  uint64_t offset = start + sizeof(ArchiveSegment);
+  uint32_t s = 0, lap = 0;
+
+  for (uint32_t i=0; i<set->num_sessions; i++) {
+    if (!add[i]) { continue; }
+    seg->num_sessions++;
+    seg->num_laps += set->first_lap[i+1] - set->first_lap[i];
+  }
+  uint32_t count[ARCHIVE_NUM_COLUMNS] = {seg->num_sessions, seg->num_sessions, seg->num_sessions+1,
+                                         seg->num_laps, set->target_cs ? seg->num_laps : 0};
+  for (int c=0; c<ARCHIVE_NUM_COLUMNS; c++) {
+    seg->column[c] = (ArchiveColumnRef){.offset=offset, .count=count[c]};
+    offset += ALIGN((uint64_t)count[c] * 4);
+  }
+  seg->size = offset - start;
+
+  uint8_t *buf = calloc(1, seg->size);
+  if (!buf) { return NULL; }
+  uint32_t *id = (uint32_t *)(buf + seg->column[ARCHIVE_ID].offset - start);
+  uint32_t *save_time = (uint32_t *)(buf + seg->column[ARCHIVE_SAVE_TIME].offset - start);
+  uint32_t *bounds = (uint32_t *)(buf + seg->column[ARCHIVE_BOUNDS].offset - start);
+  int32_t *lap_cs = (int32_t *)(buf + seg->column[ARCHIVE_LAPS].offset - start);
+  int32_t *target_cs = (int32_t *)(buf + seg->column[ARCHIVE_TARGETS].offset - start);
+
+  for (uint32_t i=0; i<set->num_sessions; i++) {
+    uint32_t first = set->first_lap[i], laps = set->first_lap[i+1] - first;
+    if (!add[i]) { continue; }
+    id[s] = set->id[i];
+    save_time[s] = set->save_time[i];
+    bounds[s++] = lap;
+    memcpy(&lap_cs[lap], &set->lap_cs[first], laps * sizeof(int32_t));
+    if (set->target_cs) { memcpy(&target_cs[lap], &set->target_cs[first], laps * sizeof(int32_t)); }
+    lap += laps;
+  }
+  bounds[s] = lap;
+  memcpy(buf, seg, sizeof(ArchiveSegment));
+  return buf;
+}
+
+// Add the sessions of set not yet in the archive, by id, as one segment. The
+// file is created if it does not exist; nothing already in it is rewritten.
+bool archive_append(const char *path, const SessionSet *set, uint32_t *num_added) {
+  int fd = open(path, O_RDWR | O_CREAT, 0666);
+  ArchiveHeader h;
+  ArchiveSegment seg = {0};
+  uint32_t *ids;
+  bool ok;
+
+  *num_added = 0;
+  if (fd < 0) { return false; }
+  if (!read_ids(fd, &h, &ids)) {
+    close(fd);
+    return false;
+  }
+
+  bool *add = calloc(set->num_sessions ? set->num_sessions : 1, sizeof(bool));
+  for (uint32_t i=0; add && i<set->num_sessions; i++) {
+    add[i] = !ids || !bsearch(&set->id[i], ids, h.num_sessions, sizeof(uint32_t), compare_ids);
+    *num_added += add[i];
+  }
+  uint8_t *buf = add ? build_segment(set, add, h.end, &seg) : NULL;
+  ok = buf != NULL;
+
+  // The segment goes down before the header that counts it in, and the header
+  // is one small write, so a failed append leaves the archive as it was
+  if (ok && *num_added > 0) {
+    ok = write_at(fd, buf, seg.size, h.end) && fsync(fd) == 0;
+    h.num_segments++;
+    h.num_sessions += seg.num_sessions;
+    h.num_laps += seg.num_laps;
+    h.end += seg.size;
+  }
+  ok = ok && write_at(fd, &h, sizeof(h), 0) && fsync(fd) == 0;
+  if (!ok) { *num_added = 0; }
+
+  free(buf);
+  free(add);
+  free(ids);
+  close(fd);
+  return ok;
+}
+//----- End appending
\ No newline at end of file
@@ -0,0 +1,70 @@
+// Columnar archive of session history, for the host tools
+//
+// A fixed header, then segments one after another, each added by one append.
+// A segment is a fixed header giving the offset and length of each of its
+// columns, then the columns themselves: flat little-endian arrays of 32-bit
+// values, 8-byte aligned, so a mapped file is read in place and a scan of one
+// column touches nothing else.
+//
+//   id          session id as the phone numbers it, one per session
+//   save time   seconds, as the watch saved it, one per session
+//   bounds      first lap of each session in the segment, plus the end of the
+//               last one, num_sessions+1 entries
+//   laps        split deltas: each lap in centiseconds, one per lap
+//   targets     pacer plan lap in centiseconds, one per lap, or empty when the
+//               sessions were archived without a plan
+//
+// An append writes its segment past the end of the archive, then the header
+// that counts it in, so a failed append leaves the archive as it was.
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+#include <stdbool.h>
+#include <stdint.h>
+#include "export_file.h"
+
+#define ARCHIVE_MAGIC   0x52415452  // "RTAR" on disk, so a big-endian reader refuses it
+#define ARCHIVE_VERSION 1
+
+typedef enum ArchiveColumn {
+  ARCHIVE_ID,
+  ARCHIVE_SAVE_TIME,
+  ARCHIVE_BOUNDS,
+  ARCHIVE_LAPS,
+  ARCHIVE_TARGETS,
+  ARCHIVE_NUM_COLUMNS
+} ArchiveColumn;
+
+typedef struct ArchiveHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;   // The first segment starts here
+  uint32_t num_segments;
+  uint32_t num_sessions;
+  uint64_t num_laps;
+  uint64_t end;           // One past the last segment
+} ArchiveHeader;
+
+typedef struct ArchiveColumnRef {
+  uint64_t offset;        // From the start of the file
+  uint32_t count;
+  uint32_t reserved;
+} ArchiveColumnRef;
+
+typedef struct ArchiveSegment {
+  uint32_t num_sessions;
+  uint32_t num_laps;
+  uint64_t size;          // Header and columns; the next segment starts this far on
+  ArchiveColumnRef column[ARCHIVE_NUM_COLUMNS];
+} ArchiveSegment;
+
+typedef struct Archive Archive;
+
+extern Archive *archive_open(const char *path);
+extern void archive_close(Archive *archive);
+extern const ArchiveHeader *archive_header(const Archive *archive);
+extern const ArchiveSegment *archive_next_segment(const Archive *archive, const ArchiveSegment *segment);
+extern const void *archive_column(const Archive *archive, const ArchiveSegment *segment, ArchiveColumn column, uint32_t *count);
+extern bool archive_read(const char *path, SessionSet *set);
+extern bool archive_append(const char *path, const SessionSet *set, uint32_t *num_added);
+
+#endif
\ No newline at end of file
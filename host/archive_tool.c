@@ -0,0 +1,148 @@
+// Archive the phone's session exports, and read archives back out
+//
+// Appends the sessions of export files (export_file.h) to a columnar archive
+// (archive.h), leaving out any whose id is already in it, so the same export
+// can be archived again as it grows. With -p each lap is archived with its lap
+// of the pacer plan (plan.h), -r repeating it.
+//
+// -c writes the archive out as CSV instead, one row per lap:
+//
+//   id,date,lap,lap_cs,split_cs,target_cs
+//
+// and -i prints its segments. Both read the mapped columns in place.
+//
+//   archive_tool [-p plan] [-r] archive export_file...
+//   archive_tool -c|-i archive
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "archive.h"
+#include "export_file.h"
+#include "kernels.h"
+#include "plan.h"
+
+static const char *column_names[] = {"id", "save_time", "bounds", "laps", "targets"};
+
+static int append(const char *path, char **files, int num_files, bool plan) {
+  for (int f=0; f<num_files; f++) {
+    SessionSet set = {0};
+    uint32_t added;
+
+    if (!export_file_read(files[f], &set)) {
+      perror(files[f]);
+      return 2;
+    }
+    if (plan) {
+      uint32_t max_laps = 0;
+      for (uint32_t s=0; s<set.num_sessions; s++) {
+        if (set.first_lap[s+1] - set.first_lap[s] > max_laps) { max_laps = set.first_lap[s+1] - set.first_lap[s]; }
+      }
+      int32_t *plan_cs = plan_laps(max_laps);
+      set.target_cs = malloc((set.num_laps ? set.num_laps : 1) * sizeof(int32_t));
+      for (uint32_t s=0; s<set.num_sessions; s++) {
+        for (uint32_t i=set.first_lap[s]; i<set.first_lap[s+1]; i++) { set.target_cs[i] = plan_cs[i - set.first_lap[s]]; }
+      }
+      free(plan_cs);
+    }
+    if (!archive_append(path, &set, &added)) {
+      perror(path);
+      return 2;
+    }
+    printf("%s: sessions=%u added=%u malformed=%u\n", files[f], set.num_sessions, added, set.malformed);
+    session_set_free(&set);
+  }
+  return 0;
+}
+
+static int write_csv(const Archive *a) {
+  int32_t *split = NULL;
+  uint32_t split_cap = 0;
+  char date[32];
+
+  printf("id,date,lap,lap_cs,split_cs,target_cs\n");
+  for (const ArchiveSegment *seg=archive_next_segment(a, NULL); seg; seg=archive_next_segment(a, seg)) {
+    uint32_t n, num_targets;
+    const uint32_t *id = archive_column(a, seg, ARCHIVE_ID, &n);
+    const uint32_t *save_time = archive_column(a, seg, ARCHIVE_SAVE_TIME, &n);
+    const uint32_t *bounds = archive_column(a, seg, ARCHIVE_BOUNDS, &n);
+    const int32_t *lap_cs = archive_column(a, seg, ARCHIVE_LAPS, &n);
+    const int32_t *target_cs = archive_column(a, seg, ARCHIVE_TARGETS, &num_targets);
+
+    for (uint32_t s=0; s<seg->num_sessions; s++) {
+      uint32_t laps = bounds[s+1] - bounds[s];
+      time_t t = save_time[s];
+      if (laps > split_cap) {
+        split_cap = laps;
+        split = realloc(split, split_cap * sizeof(int32_t));
+        if (!split) { return 2; }
+      }
+      kernel_prefix_sum(&lap_cs[bounds[s]], split, laps);
+      strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&t));
+      for (uint32_t i=0; i<laps; i++) {
+        printf("%u,%s,%u,%d,%d,", id[s], date, i+1, lap_cs[bounds[s]+i], split[i]);
+        if (num_targets) { printf("%d", target_cs[bounds[s]+i]); }
+        putchar('\n');
+      }
+    }
+  }
+  free(split);
+  return ferror(stdout) ? 2 : 0;
+}
+
+static int print_info(const char *path, const Archive *a) {
+  const ArchiveHeader *h = archive_header(a);
+  uint32_t i = 0;
+
+  printf("%s: version=%u segments=%u sessions=%u laps=%llu bytes=%llu\n", path, h->version, h->num_segments,
+         h->num_sessions, (unsigned long long)h->num_laps, (unsigned long long)h->end);
+  for (const ArchiveSegment *seg=archive_next_segment(a, NULL); seg; seg=archive_next_segment(a, seg)) {
+    printf("  segment %u: sessions=%u laps=%u bytes=%llu", i++, seg->num_sessions, seg->num_laps,
+           (unsigned long long)seg->size);
+    for (int c=0; c<ARCHIVE_NUM_COLUMNS; c++) {
+      printf(" %s@%llu", column_names[c], (unsigned long long)seg->column[c].offset);
+    }
+    putchar('\n');
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *plan_spec = NULL;
+  bool repeat = false;
+  char mode = 'a';
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:rci")) != -1) {
+    switch (opt) {
+      case 'p': plan_spec = optarg; break;
+      case 'r': repeat = true; break;
+      case 'c': mode = 'c'; break;
+      case 'i': mode = 'i'; break;
+      default:
+        optind = argc + 1;
+        break;
+    }
+  }
+  if (optind >= argc || (mode != 'a' && optind != argc-1)) {
+    fprintf(stderr, "usage: %s [-p plan] [-r] archive export_file...\n"
+                    "       %s -c|-i archive\n", argv[0], argv[0]);
+    return 2;
+  }
+  if (plan_spec && !plan_parse(plan_spec, repeat)) {
+    fprintf(stderr, "archive_tool: bad plan %s\n", plan_spec);
+    return 2;
+  }
+  if (mode == 'a') { return append(argv[optind], argv+optind+1, argc-optind-1, plan_spec != NULL); }
+
+  Archive *a = archive_open(argv[optind]);
+  if (!a) {
+    perror(argv[optind]);
+    return 2;
+  }
+  int result = (mode == 'c') ? write_csv(a) : print_info(argv[optind], a);
+  archive_close(a);
+  return result;
+}
\ No newline at end of file
@@ -0,0 +1,334 @@
+// Microbenchmarks for the per-tick and per-lap paths of the app, and for the
+// host analytics kernels (kernels.h) at each level the CPU runs
+//
+// Like racetime_sim, stopwatch.c is compiled in so its static tick and lap
+// functions can be timed in place. Each benchmark prints one line,
+//
+//   bench=<name> ops=<n> ns_per_op=<t>
+//
+// taking the fastest of several runs of wall-clock time. Save the output of one
+// build and pass it to -c on the next to see the change per benchmark; the run
+// fails if any benchmark got slower by more than the threshold.
+//
+//   bench [-f name_prefix] [-m min_ms] [-c baseline_file] [-t threshold_percent]
+#include <getopt.h>
+#include "pebble.h"
+#include "sim.h"
+#include "kernels.h"
+
+#define main racetime_main
+#include "stopwatch.c"
+#undef main
+
+#define BENCH_RUNS        5
+#define BENCH_INPUTS      256     // Power of two, inputs are indexed modulo it
+#define BENCH_MAX_ENTRIES 64
+#define BENCH_SEASON_LAPS (1<<20) // About a season of a big squad, well past the caches
+
+typedef struct Bench {
+  const char *name;
+  void (*setup)(void);
+  void (*run)(uint32_t ops);
+  bool (*available)(void);  // Left out when it returns false, always run if NULL
+} Bench;
+
+typedef struct BenchResult {
+  char name[48];
+  double ns_per_op;
+} BenchResult;
+
+static volatile int32_t sink;
+static SWTime input_a[BENCH_INPUTS];
+static SWTime input_b[BENCH_INPUTS];
+static SWTime elapsed;
+static uint8_t record_lap_laps;
+static int32_t *season_in;
+static int32_t *season_out;
+
+//----- Begin SWTime arithmetic
+// Fields near the top of their range, so most additions carry and most subtractions borrow
+static void setup_swtime(void) {
+  srand(1);
+  for (int i=0; i<BENCH_INPUTS; i++) {
+    input_a[i] = (SWTime){.centisecond=50+rand()%50, .second=30+rand()%30, .minute=30+rand()%30, .hour=rand()%50};
+    input_b[i] = (SWTime){.centisecond=50+rand()%50, .second=30+rand()%30, .minute=30+rand()%30, .hour=rand()%50};
+  }
+}
+
+static void run_swtime_add(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    sink += SWTime_add(input_a[i%BENCH_INPUTS], input_b[i%BENCH_INPUTS]).second;
+  }
+}
+
+static void run_swtime_subtract(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    sink += SWTime_subtract(input_b[i%BENCH_INPUTS], input_a[i%BENCH_INPUTS]).second;
+  }
+}
+
+static void run_swtime_compare(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    sink += SWTime_compare(input_a[i%BENCH_INPUTS], input_b[i%BENCH_INPUTS]);
+  }
+}
+//----- End SWTime arithmetic
+
+//----- Begin countdown timer
+// A 5-lap plan of 1:00 laps, or a single plan of 600 laps of 1:00, each one
+// entered by hand so the plan is as fragmented as the timer config can make it
+static void setup_cdt(bool repeat, uint16_t length) {
+  cdt_t *cdt = cdt_get();
+  cdt_reset_all();
+  for (uint16_t i=0; i<length; i++) { cdt_set_lap(i, (SWTime){.minute=1}); }
+  for (uint16_t i=1; i<CDT_MAX_BLOCKS && i<length; i+=2) { cdt_set_lap(i, (SWTime){.minute=1, .second=i%60}); }
+  cdt->enable = true;
+  cdt->repeat = repeat;
+  cdt_reset();
+  elapsed = (SWTime){0, 0, 0, 0};
+}
+
+static void setup_cdt_single(void) { setup_cdt(false, 600); }
+static void setup_cdt_repeat(void) { setup_cdt(true, 5); }
+
+// One SW_STEP_MS_SHORT tick at a time through a two-hour session
+static void run_cdt_tick(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    elapsed = SWTime_add(elapsed, (SWTime){.centisecond=SW_STEP_MS_SHORT/10});
+    if (elapsed.hour >= 2) {
+      elapsed = (SWTime){0, 0, 0, 0};
+      cdt_reset();
+    }
+    cdt_update(elapsed);
+    sink += cdt_get()->display.second;
+  }
+}
+
+// First tick after a reset at 9 hours in: the plan catches up lap by lap
+static void run_cdt_catch_up(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    cdt_reset();
+    cdt_update((SWTime){.hour=9});
+    sink += cdt_get()->index;
+  }
+}
+//----- End countdown timer
+
+//----- Begin host kernels
+// One op is one lap, the season array streamed through as many times as it takes
+static void setup_season(void) {
+  if (!season_in) {
+    season_in = malloc(BENCH_SEASON_LAPS * sizeof(int32_t));
+    season_out = malloc(BENCH_SEASON_LAPS * sizeof(int32_t));
+  }
+  srand(1);
+  for (uint32_t i=0; i<BENCH_SEASON_LAPS; i++) { season_in[i] = 6000 + rand()%3000; }
+}
+
+static void setup_kernel_scalar(void) { setup_season(); kernel_select(KERNEL_SCALAR); }
+static void setup_kernel_sse2(void)   { setup_season(); kernel_select(KERNEL_SSE2); }
+static void setup_kernel_avx2(void)   { setup_season(); kernel_select(KERNEL_AVX2); }
+
+static bool has_sse2(void) { return kernel_select(KERNEL_SSE2); }
+static bool has_avx2(void) { return kernel_select(KERNEL_AVX2); }
+
+static void run_kernel_delta(uint32_t ops) {
+  for (uint32_t done=0; done<ops; done+=BENCH_SEASON_LAPS) {
+    uint32_t n = (ops-done < BENCH_SEASON_LAPS) ? ops-done : BENCH_SEASON_LAPS;
+    kernel_delta(season_in, season_out, n);
+  }
+  sink += season_out[ops % BENCH_SEASON_LAPS];
+}
+
+static void run_kernel_prefix_sum(uint32_t ops) {
+  for (uint32_t done=0; done<ops; done+=BENCH_SEASON_LAPS) {
+    uint32_t n = (ops-done < BENCH_SEASON_LAPS) ? ops-done : BENCH_SEASON_LAPS;
+    kernel_prefix_sum(season_in, season_out, n);
+  }
+  sink += season_out[ops % BENCH_SEASON_LAPS];
+}
+
+static void run_kernel_stats(uint32_t ops) {
+  KernelStats stats;
+  for (uint32_t done=0; done<ops; done+=BENCH_SEASON_LAPS) {
+    uint32_t n = (ops-done < BENCH_SEASON_LAPS) ? ops-done : BENCH_SEASON_LAPS;
+    kernel_stats(season_in, n, &stats);
+    sink += (int32_t)stats.sum_sq;
+  }
+}
+//----- End host kernels
+
+//----- Begin stopwatch paths
+// A running session with laps-1 laps behind it and a repeating timer plan, in
+// the state a lap press leaves it in
+static void setup_stopwatch(uint8_t laps) {
+  setup_cdt_repeat();
+  session_index = 0;
+  session[0] = (Session_t){.start_index=0, .end_index=laps-1};
+  for (uint8_t i=0; i<laps; i++) { split_cs[i] = (i+1)*6100; }
+  time_ms(&stopwatch.time_start.s, &stopwatch.time_start.ms);
+  stopwatch.time_offset = (WatchTime_t){.s=laps*61+30, .ms=0};
+  stopwatch.sw_state = SW_STATE_LAP_RECORD;
+}
+
+static void setup_record_lap(void) { setup_stopwatch(record_lap_laps); }
+static void setup_record_lap_1(void)  { record_lap_laps = 1;  setup_record_lap(); }
+static void setup_record_lap_10(void) { record_lap_laps = 10; setup_record_lap(); }
+static void setup_record_lap_25(void) { record_lap_laps = 25; setup_record_lap(); }
+static void setup_record_lap_49(void) { record_lap_laps = NUM_LAP_MEMORY-1; setup_record_lap(); }
+static void setup_display(void)       { setup_stopwatch(10); }
+
+// The lap is taken back after each op so every op records the same lap.
+// Includes the deferred overlay and queueing the lap for telemetry, which are
+// part of the path on the watch
+static void run_record_lap(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    session[0].end_index = record_lap_laps-1;
+    record_lap();
+    workq_flush();
+    sink += warning_str_value[0];
+  }
+}
+
+static void run_update_display(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    update_display();
+    sink += watchface_digit[1][4].str[0];
+  }
+}
+
+// Everything a timer_callback tick does, then the redraw it causes
+static void run_tick(uint32_t ops) {
+  for (uint32_t i=0; i<ops; i++) {
+    update_time();
+    update_display();
+    sim_ui_flush();
+  }
+}
+//----- End stopwatch paths
+
+static const Bench benches[] = {
+  {"swtime_add",           setup_swtime,        run_swtime_add},
+  {"swtime_subtract",      setup_swtime,        run_swtime_subtract},
+  {"swtime_compare",       setup_swtime,        run_swtime_compare},
+  {"cdt_update_tick_single",     setup_cdt_single, run_cdt_tick},
+  {"cdt_update_tick_repeat",     setup_cdt_repeat, run_cdt_tick},
+  {"cdt_update_catch_up_single", setup_cdt_single, run_cdt_catch_up},
+  {"cdt_update_catch_up_repeat", setup_cdt_repeat, run_cdt_catch_up},
+  {"record_lap_1",         setup_record_lap_1,  run_record_lap},
+  {"record_lap_10",        setup_record_lap_10, run_record_lap},
+  {"record_lap_25",        setup_record_lap_25, run_record_lap},
+  {"record_lap_49",        setup_record_lap_49, run_record_lap},
+  {"update_display",       setup_display,       run_update_display},
+  {"tick",                 setup_display,       run_tick},
+  {"kernel_delta_scalar",      setup_kernel_scalar, run_kernel_delta},
+  {"kernel_delta_sse2",        setup_kernel_sse2,   run_kernel_delta,      has_sse2},
+  {"kernel_delta_avx2",        setup_kernel_avx2,   run_kernel_delta,      has_avx2},
+  {"kernel_prefix_sum_scalar", setup_kernel_scalar, run_kernel_prefix_sum},
+  {"kernel_prefix_sum_sse2",   setup_kernel_sse2,   run_kernel_prefix_sum, has_sse2},
+  {"kernel_prefix_sum_avx2",   setup_kernel_avx2,   run_kernel_prefix_sum, has_avx2},
+  {"kernel_stats_scalar",      setup_kernel_scalar, run_kernel_stats},
+  {"kernel_stats_sse2",        setup_kernel_sse2,   run_kernel_stats,      has_sse2},
+  {"kernel_stats_avx2",        setup_kernel_avx2,   run_kernel_stats,      has_avx2},
+};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+// Grow the op count until a run takes min_ms, then keep the fastest of BENCH_RUNS
+static double measure(const Bench *b, uint32_t min_ms, uint32_t *ops_out) {
+  uint32_t ops = 1;
+  double best = 0;
+
+  b->setup();
+  for (;;) {
+    double start = now_ns();
+    b->run(ops);
+    double ns = now_ns() - start;
+    if (ns >= min_ms*1e6 || ops >= (1u<<30)) { break; }
+    ops *= (ns < min_ms*1e5) ? 10 : 2;
+  }
+  for (int r=0; r<BENCH_RUNS; r++) {
+    b->setup();
+    double start = now_ns();
+    b->run(ops);
+    double ns_per_op = (now_ns() - start) / ops;
+    if (r == 0 || ns_per_op < best) { best = ns_per_op; }
+  }
+  *ops_out = ops;
+  return best;
+}
+
+static int load_baseline(const char *path, BenchResult *results) {
+  FILE *f = fopen(path, "r");
+  char line[256];
+  int n = 0;
+
+  if (!f) {
+    perror(path);
+    exit(2);
+  }
+  while (n < BENCH_MAX_ENTRIES && fgets(line, sizeof(line), f)) {
+    char *ns = strstr(line, "ns_per_op=");
+    if (sscanf(line, "bench=%47s", results[n].name) == 1 && ns) {
+      results[n++].ns_per_op = atof(ns + strlen("ns_per_op="));
+    }
+  }
+  fclose(f);
+  return n;
+}
+
+int main(int argc, char **argv) {
+  const char *filter = "";
+  const char *baseline_file = NULL;
+  uint32_t min_ms = 200;
+  double threshold = 10;
+  BenchResult baseline[BENCH_MAX_ENTRIES];
+  int num_baseline = 0;
+  int regressions = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "f:m:c:t:")) != -1) {
+    switch (opt) {
+      case 'f': filter = optarg; break;
+      case 'm': min_ms = atoi(optarg); break;
+      case 'c': baseline_file = optarg; break;
+      case 't': threshold = atof(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-f name_prefix] [-m min_ms] [-c baseline_file] [-t threshold_percent]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (baseline_file) { num_baseline = load_baseline(baseline_file, baseline); }
+
+  // The app as launched from a fresh install, main window up
+  sim_persist_clear();
+  init();
+
+  for (size_t i=0; i<sizeof(benches)/sizeof(benches[0]); i++) {
+    const Bench *b = &benches[i];
+    uint32_t ops;
+    if (strncmp(b->name, filter, strlen(filter)) != 0 || (b->available && !b->available())) { continue; }
+
+    double ns_per_op = measure(b, min_ms, &ops);
+    printf("bench=%s ops=%u ns_per_op=%.2f", b->name, ops, ns_per_op);
+    for (int j=0; j<num_baseline; j++) {
+      if (strcmp(baseline[j].name, b->name) != 0 || baseline[j].ns_per_op <= 0) { continue; }
+      double change = (ns_per_op / baseline[j].ns_per_op - 1) * 100;
+      printf(" baseline_ns=%.2f change_percent=%+.1f", baseline[j].ns_per_op, change);
+      if (change > threshold) {
+        printf(" REGRESSION");
+        regressions++;
+      }
+    }
+    putchar('\n');
+    fflush(stdout);
+  }
+
+  deinit();
+  if (baseline_file) { printf("regressions=%d threshold_percent=%.1f\n", regressions, threshold); }
+  return (regressions == 0) ? 0 : 1;
+}
\ No newline at end of file
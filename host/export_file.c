@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "export_file.h"
+
+static void *resize(void *array, size_t size) {
+  void *resized = realloc(array, size);
+  if (!resized) {
+    perror("export_file");
+    exit(2);
+  }
+  return resized;
+}
+
+static void *grow(void *array, uint32_t count, uint32_t *cap, size_t size) {
+  if (count < *cap) { return array; }
+  *cap = (*cap == 0) ? 64 : *cap * 2;
+  return resize(array, *cap * size);
+}
+
+void session_set_add(SessionSet *set, uint32_t id, uint32_t save_time, const int32_t *lap_cs, uint32_t laps) {
+  uint32_t session_cap = set->session_cap;
+  uint32_t lap_cap = set->lap_cap;
+
+  // One spare for the end of the last session
+  set->first_lap = grow(set->first_lap, set->num_sessions+1, &session_cap, sizeof(uint32_t));
+  if (session_cap != set->session_cap) {
+    set->id = resize(set->id, session_cap * sizeof(uint32_t));
+    set->save_time = resize(set->save_time, session_cap * sizeof(uint32_t));
+    set->session_cap = session_cap;
+  }
+  while (set->num_laps + laps > set->lap_cap) {
+    set->lap_cs = grow(set->lap_cs, set->lap_cap, &lap_cap, sizeof(int32_t));
+    set->lap_cap = lap_cap;
+  }
+
+  set->first_lap[0] = 0;
+  memcpy(&set->lap_cs[set->num_laps], lap_cs, laps * sizeof(int32_t));
+  set->id[set->num_sessions] = id;
+  set->save_time[set->num_sessions] = save_time;
+  set->num_laps += laps;
+  set->first_lap[++set->num_sessions] = set->num_laps;
+}
+
+void session_set_free(SessionSet *set) {
+  free(set->id);
+  free(set->save_time);
+  free(set->first_lap);
+  free(set->lap_cs);
+  free(set->target_cs);
+  memset(set, 0, sizeof(*set));
+}
+
+static char *read_file(const char *path) {
+  FILE *f = fopen(path, "rb");
+  struct stat st;
+  char *buf;
+
+  if (!f) { return NULL; }
+  if (fstat(fileno(f), &st) != 0 || !(buf = malloc(st.st_size + 1))) {
+    fclose(f);
+    return NULL;
+  }
+  size_t len = fread(buf, 1, st.st_size, f);
+  buf[len] = '\0';
+  fclose(f);
+  return buf;
+}
+
+// Value of a numeric field inside one session object, false if it is missing
+static bool get_field(const char *obj, const char *name, long *value) {
+  const char *p = strstr(obj, name);
+  char *end;
+  if (!p) { return false; }
+  *value = strtol(p + strlen(name), &end, 10);
+  return end != p + strlen(name);
+}
+
+// Sessions are added to the set in file order
+bool export_file_read(const char *path, SessionSet *set) {
+  char *buf = read_file(path);
+  char *p = buf;
+  int32_t *laps = NULL;
+  uint32_t lap_cap = 0;
+
+  if (!buf) { return false; }
+  while ((p = strchr(p, '"'))) {
+    char *end;
+    unsigned long id = strtoul(p+1, &end, 10);
+    if (end == p+1 || strncmp(end, "\":{", 3) != 0) {
+      p++;
+      continue;
+    }
+    char *obj = end + 3;
+    char *close = strchr(obj, '}');
+    if (!close) { break; }
+    *close = '\0';
+    p = close + 1;
+
+    long save_time, total_laps;
+    char *q = strstr(obj, "\"laps\":[");
+    if (!get_field(obj, "\"saveTime\":", &save_time) || !get_field(obj, "\"totalLaps\":", &total_laps) || !q) {
+      set->malformed++;
+      continue;
+    }
+
+    // Laps not yet transferred are null, and the session is left out
+    uint32_t n = 0;
+    q += strlen("\"laps\":[");
+    while (*q != ']') {
+      long cs = strtol(q, &end, 10);
+      if (end == q) { break; }
+      laps = grow(laps, n, &lap_cap, sizeof(int32_t));
+      laps[n++] = (int32_t)cs;
+      q = (*end == ',') ? end+1 : end;
+    }
+    if (*q != ']' || n != (uint32_t)total_laps || total_laps == 0) {
+      set->malformed++;
+      continue;
+    }
+    session_set_add(set, id, (uint32_t)save_time, laps, n);
+  }
+  free(laps);
+  free(buf);
+  return true;
+}
+
+// Same as JSON.stringify of the sessions in localStorage
+bool export_file_write(const char *path, const SessionSet *set) {
+  FILE *f = fopen(path, "w");
+
+  if (!f) { return false; }
+  fputc('{', f);
+  for (uint32_t s=0; s<set->num_sessions; s++) {
+    fprintf(f, "%s\"%u\":{\"saveTime\":%u,\"totalLaps\":%u,\"laps\":[", s ? "," : "",
+            set->id[s], set->save_time[s], set->first_lap[s+1] - set->first_lap[s]);
+    for (uint32_t i=set->first_lap[s]; i<set->first_lap[s+1]; i++) {
+      fprintf(f, "%s%d", (i > set->first_lap[s]) ? "," : "", set->lap_cs[i]);
+    }
+    fputs("]}", f);
+  }
+  fputc('}', f);
+  return fclose(f) == 0;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+// Session files from the phone, as export.js stores them
+//
+// One JSON object of sessions keyed by id, in id order as JSON.stringify
+// writes them, each with its save time and its laps in centiseconds:
+//
+//   {"12":{"saveTime":1404229200,"totalLaps":3,"laps":[6012,6150,5987]},...}
+#ifndef EXPORT_FILE_H
+#define EXPORT_FILE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sessions in columns, session s has laps first_lap[s]..first_lap[s+1]-1
+typedef struct SessionSet {
+  uint32_t num_sessions;
+  uint32_t num_laps;
+  uint32_t *id;
+  uint32_t *save_time;
+  uint32_t *first_lap;    // num_sessions+1 entries
+  int32_t *lap_cs;
+  int32_t *target_cs;     // Pacer plan lap for each lap, NULL without a plan
+  uint32_t malformed;     // Sessions skipped, such as ones still partly transferred
+  uint32_t session_cap;
+  uint32_t lap_cap;
+} SessionSet;
+
+extern void session_set_add(SessionSet *set, uint32_t id, uint32_t save_time, const int32_t *lap_cs, uint32_t laps);
+extern void session_set_free(SessionSet *set);
+extern bool export_file_read(const char *path, SessionSet *set);
+extern bool export_file_write(const char *path, const SessionSet *set);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,231 @@
+// Stand-in phone receiver for the session export and sync pipeline
+//
+// Runs export.c against the simulated AppMessage link, decodes every packet the
+// way src/export.js does, and checks the phone's copy against the session memory.
+// Two rounds are run: a full sync from nothing, then a day's worth of changes
+// (sessions deleted and added) synced from the phone's high-water mark.
+// With -w the phone's copy is then written out the way export.js stores it, for
+// the analytics tool.
+//
+//   export_receiver [-l transport_loss_permille] [-a app_loss_permille] [-o outbox_size] [-s seed] [-v] [-w file]
+#include <getopt.h>
+#include "pebble.h"
+#include "sim.h"
+#include "stopwatch.h"
+#include "comm.h"
+#include "export.h"
+#include "sync.h"
+#include "session_codec.h"
+#include "session_store.h"
+#include "export_file.h"
+
+#define PHONE_MAX_IDS 1024
+
+//----- Begin stand-in phone
+typedef struct PhoneSession {
+  bool present;
+  uint32_t save_time;
+  uint8_t total_laps;
+  int32_t laps[NUM_LAP_MEMORY];
+} PhoneSession;
+
+static uint16_t phone_next_seq;
+static int32_t phone_nacked_seq = -1;
+static bool phone_done;
+static uint32_t phone_packets;
+static uint16_t phone_revision;
+static PhoneSession phone_recv[PHONE_MAX_IDS];   // Sessions in the current transfer
+static PhoneSession phone_store[PHONE_MAX_IDS];  // Same as localStorage in export.js
+static bool verbose;
+
+static void phone_reply(uint32_t key, uint16_t seq) {
+  DictionaryIterator *iter = sim_phone_outbox_begin();
+  dict_write_uint16(iter, key, seq);
+  sim_phone_outbox_send();
+}
+
+static void phone_decode(const uint8_t *data, uint16_t size) {
+  CodecReader r = {.buf=data, .len=size, .pos=0};
+  CodecChunk chunk;
+  while (r.pos < r.len) {
+    if (!codec_chunk_read(&r, &chunk) || chunk.session >= PHONE_MAX_IDS) {
+      fprintf(stderr, "receiver: malformed chunk header\n");
+      exit(1);
+    }
+    PhoneSession *s = &phone_recv[chunk.session];
+    if (chunk.first_lap == 0) {
+      s->present = true;
+      s->save_time = chunk.save_time;
+      s->total_laps = chunk.total_laps;
+    }
+    for (uint8_t i=0; i<chunk.num_laps; i++) {
+      if (!codec_chunk_get_lap(&r, &chunk, &s->laps[chunk.first_lap+i])) {
+        fprintf(stderr, "receiver: malformed lap\n");
+        exit(1);
+      }
+    }
+  }
+}
+
+static void phone_store_sync(DictionaryIterator *iter) {
+  Tuple *full = dict_find(iter, MSG_KEY_SYNC_FULL);
+  Tuple *tombstones = dict_find(iter, MSG_KEY_SYNC_TOMBSTONES);
+
+  if (full && full->value->uint8) { memset(phone_store, 0, sizeof(phone_store)); }
+  for (uint16_t id=0; id<PHONE_MAX_IDS; id++) {
+    if (phone_recv[id].present) { phone_store[id] = phone_recv[id]; }
+  }
+  if (tombstones) {
+    CodecReader r = {.buf=tombstones->value->data, .len=tombstones->length, .pos=0};
+    uint32_t id;
+    while (r.pos < r.len && codec_get_varint(&r, &id)) {
+      if (id < PHONE_MAX_IDS) { phone_store[id].present = false; }
+    }
+  }
+  phone_revision = dict_find(iter, MSG_KEY_SYNC_REVISION)->value->uint16;
+}
+
+static void phone_handler(DictionaryIterator *iter) {
+  Tuple *seq = dict_find(iter, MSG_KEY_EXPORT_SEQ);
+  Tuple *end = dict_find(iter, MSG_KEY_EXPORT_END);
+
+  if (seq) {
+    if (verbose) { printf("[%6llu] packet %u (%u bytes)\n", (unsigned long long)sim_now_ms(), seq->value->uint16, dict_find(iter, MSG_KEY_EXPORT_DATA)->length); }
+    if (seq->value->uint16 == phone_next_seq) {
+      Tuple *data = dict_find(iter, MSG_KEY_EXPORT_DATA);
+      phone_decode(data->value->data, data->length);
+      phone_packets++;
+      phone_reply(MSG_KEY_EXPORT_ACK, ++phone_next_seq);
+    } else if (seq->value->uint16 > phone_next_seq) {
+      if (phone_nacked_seq != phone_next_seq) {
+        phone_nacked_seq = phone_next_seq;
+        phone_reply(MSG_KEY_EXPORT_NACK, phone_next_seq);
+      }
+    } else {
+      phone_reply(MSG_KEY_EXPORT_ACK, phone_next_seq);
+    }
+  }
+  if (end && end->value->uint16 == phone_next_seq) {
+    phone_store_sync(iter);
+    phone_done = true;
+  }
+}
+
+// Same as the 'ready' event in export.js
+static bool phone_store_write(const char *path) {
+  SessionSet set = {0};
+  bool ok;
+
+  for (uint16_t id=0; id<PHONE_MAX_IDS; id++) {
+    PhoneSession *s = &phone_store[id];
+    if (s->present) { session_set_add(&set, id, s->save_time, s->laps, s->total_laps); }
+  }
+  ok = export_file_write(path, &set);
+  session_set_free(&set);
+  return ok;
+}
+
+static void phone_request_sync(void) {
+  phone_next_seq = 0;
+  phone_nacked_seq = -1;
+  phone_done = false;
+  phone_packets = 0;
+  memset(phone_recv, 0, sizeof(phone_recv));
+  phone_reply(MSG_KEY_SYNC_REQUEST, phone_revision);
+}
+//----- End stand-in phone
+
+static bool verify(void) {
+  uint32_t mismatches = 0;
+  uint16_t phone_sessions = 0;
+  for (uint16_t id=0; id<PHONE_MAX_IDS; id++) {
+    if (phone_store[id].present) { phone_sessions++; }
+  }
+  if (phone_sessions != session_index) { mismatches++; }
+  for (uint8_t s=0; s<session_index; s++) {
+    PhoneSession *p = &phone_store[session_rev[s].id];
+    uint8_t total_laps = session[s].end_index - session[s].start_index + 1;
+    if (!p->present || p->total_laps != total_laps || p->save_time != (uint32_t)save_time[s]) { mismatches++; continue; }
+    for (uint8_t i=0; i<total_laps; i++) {
+      int32_t lap = get_lap_cs(session[s], session[s].start_index+i);
+      if (p->laps[i] != lap) { mismatches++; }
+    }
+  }
+  return mismatches == 0;
+}
+
+// One sync from the phone's high-water mark; print its cost and check the result
+static bool run_round(const char *name) {
+  SimLinkStats before = sim_link_get_stats();
+  uint64_t start_ms = sim_now_ms();
+
+  phone_request_sync();
+  sim_run_until_idle(10*60*1000);
+
+  SimLinkStats stats = sim_link_get_stats();
+  bool ok = phone_done && export_get_state() == EXPORT_STATE_DONE && verify();
+
+  printf("round=%s sessions=%u laps=%u revision=%u\n", name, session_index, session[session_index].start_index, phone_revision);
+  printf("  state=%s elapsed_ms=%llu reduced_sniff_ms=%llu sniff_after=%s\n",
+         (export_get_state() == EXPORT_STATE_DONE) ? "done" : "failed",
+         (unsigned long long)(sim_now_ms() - start_ms),
+         (unsigned long long)(stats.reduced_sniff_ms - before.reduced_sniff_ms),
+         (app_comm_get_sniff_interval() == SNIFF_INTERVAL_NORMAL) ? "normal" : "reduced");
+  printf("  to_phone messages=%u bytes=%u packets=%u transport_failures=%u app_drops=%u\n",
+         stats.messages_to_phone - before.messages_to_phone, stats.bytes_to_phone - before.bytes_to_phone,
+         phone_packets, stats.transport_failures - before.transport_failures, stats.app_drops - before.app_drops);
+  printf("  to_watch messages=%u bytes=%u\n",
+         stats.messages_to_watch - before.messages_to_watch, stats.bytes_to_watch - before.bytes_to_watch);
+  printf("  verify=%s\n", ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  SimLink config = {.latency_ms={200, 25}, .send_timeout_ms=1000, .seed=1};
+  const char *write_path = NULL;
+  int opt;
+  bool ok;
+
+  while ((opt = getopt(argc, argv, "l:a:o:s:vw:")) != -1) {
+    switch (opt) {
+      case 'l': config.transport_loss_permille = atoi(optarg); break;
+      case 'a': config.app_loss_permille = atoi(optarg); break;
+      case 'o': config.outbox_size_maximum = atoi(optarg); break;
+      case 's': config.seed = atoi(optarg); break;
+      case 'v': verbose = true; break;
+      case 'w': write_path = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-l transport_loss_permille] [-a app_loss_permille] [-o outbox_size] [-s seed] [-v] [-w file]\n", argv[0]);
+        return 2;
+    }
+  }
+
+  // Leave room for the day's new sessions
+  session_store_fill(config.seed, 16);
+  sim_link_configure(config);
+  sim_phone_set_handler(phone_handler);
+  sync_init();
+  comm_init();
+  export_init();
+
+  ok = run_round("full");
+
+  // A day of training: two old sessions deleted, two new ones saved
+  delete_session(1);
+  delete_session(session_index/2);
+  session_store_add();
+  session_store_add();
+  ok = run_round("delta") && ok;
+
+  // Nothing changed: the sync is a request and an END
+  ok = run_round("idle") && ok;
+  if (write_path && !phone_store_write(write_path)) {
+    perror(write_path);
+    ok = false;
+  }
+
+  export_deinit();
+  comm_deinit();
+  sync_deinit();
+  return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include <stddef.h>
+#include <string.h>
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNEL_X86
+#endif
+
+typedef struct KernelOps {
+  void (*delta)(const int32_t *split, int32_t *lap, uint32_t n);
+  void (*prefix_sum)(const int32_t *lap, int32_t *split, uint32_t n);
+  void (*stats)(const int32_t *v, uint32_t n, KernelStats *stats);
+} KernelOps;
+
+static const char *level_names[] = {"scalar", "sse2", "avx2"};
+
+//----- Begin scalar
+// Unsigned so that overflow wraps, as the vector additions do
+static void delta_scalar(const int32_t *split, int32_t *lap, uint32_t n) {
+  uint32_t prev = 0;
+  for (uint32_t i=0; i<n; i++) {
+    lap[i] = (int32_t)((uint32_t)split[i] - prev);
+    prev = split[i];
+  }
+}
+
+static void prefix_sum_scalar(const int32_t *lap, int32_t *split, uint32_t n) {
+  uint32_t sum = 0;
+  for (uint32_t i=0; i<n; i++) {
+    sum += (uint32_t)lap[i];
+    split[i] = (int32_t)sum;
+  }
+}
+
+// Added to whatever stats already holds, so the vector kernels finish their
+// tails with it
+static void stats_add_scalar(const int32_t *v, uint32_t n, KernelStats *stats) {
+  for (uint32_t i=0; i<n; i++) {
+    if (v[i] < stats->min) { stats->min = v[i]; }
+    if (v[i] > stats->max) { stats->max = v[i]; }
+    stats->sum += v[i];
+    stats->sum_sq = (int64_t)((uint64_t)stats->sum_sq + (uint64_t)((int64_t)v[i]*v[i]));
+  }
+}
+
+static void stats_scalar(const int32_t *v, uint32_t n, KernelStats *stats) {
+  *stats = (KernelStats){.min=INT32_MAX, .max=INT32_MIN};
+  stats_add_scalar(v, n, stats);
+}
+//----- End scalar
+
+#ifdef KERNEL_X86
+//----- Begin SSE2
+__attribute__((target("sse2")))
+static void delta_sse2(const int32_t *split, int32_t *lap, uint32_t n) {
+  uint32_t i = 1;
+
+  if (n == 0) { return; }
+  lap[0] = split[0];
+  for (; i+4<=n; i+=4) {
+    __m128i cur = _mm_loadu_si128((const __m128i *)(split+i));
+    __m128i prev = _mm_loadu_si128((const __m128i *)(split+i-1));
+    _mm_storeu_si128((__m128i *)(lap+i), _mm_sub_epi32(cur, prev));
+  }
+  for (; i<n; i++) { lap[i] = (int32_t)((uint32_t)split[i] - (uint32_t)split[i-1]); }
+}
+
+// Scan within the vector by two shifted adds, then add the sum carried in
+__attribute__((target("sse2")))
+static void prefix_sum_sse2(const int32_t *lap, int32_t *split, uint32_t n) {
+  __m128i carry = _mm_setzero_si128();
+  uint32_t i = 0;
+
+  for (; i+4<=n; i+=4) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(lap+i));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi32(x, carry);
+    _mm_storeu_si128((__m128i *)(split+i), x);
+    carry = _mm_shuffle_epi32(x, 0xFF);
+  }
+  uint32_t sum = (uint32_t)_mm_cvtsi128_si32(carry);
+  for (; i<n; i++) {
+    sum += (uint32_t)lap[i];
+    split[i] = (int32_t)sum;
+  }
+}
+
+// SSE2 has no signed 32-bit min, max, widening or multiply, so they are made
+// from compares, sign masks and the unsigned even-lane multiply
+__attribute__((target("sse2")))
+static void stats_sse2(const int32_t *v, uint32_t n, KernelStats *stats) {
+  __m128i vmin = _mm_set1_epi32(INT32_MAX), vmax = _mm_set1_epi32(INT32_MIN);
+  __m128i sum = _mm_setzero_si128(), sum_sq = _mm_setzero_si128();
+  uint32_t i = 0;
+
+  for (; i+4<=n; i+=4) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(v+i));
+    __m128i lt = _mm_cmplt_epi32(x, vmin);
+    __m128i gt = _mm_cmpgt_epi32(x, vmax);
+    vmin = _mm_or_si128(_mm_and_si128(lt, x), _mm_andnot_si128(lt, vmin));
+    vmax = _mm_or_si128(_mm_and_si128(gt, x), _mm_andnot_si128(gt, vmax));
+
+    __m128i sign = _mm_srai_epi32(x, 31);
+    sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(x, sign));
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(x, sign));
+
+    __m128i abs = _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+    sum_sq = _mm_add_epi64(sum_sq, _mm_mul_epu32(abs, abs));
+    abs = _mm_srli_epi64(abs, 32);
+    sum_sq = _mm_add_epi64(sum_sq, _mm_mul_epu32(abs, abs));
+  }
+
+  int32_t mins[4], maxs[4];
+  int64_t sums[2], sum_sqs[2];
+  _mm_storeu_si128((__m128i *)mins, vmin);
+  _mm_storeu_si128((__m128i *)maxs, vmax);
+  _mm_storeu_si128((__m128i *)sums, sum);
+  _mm_storeu_si128((__m128i *)sum_sqs, sum_sq);
+  *stats = (KernelStats){.min=INT32_MAX, .max=INT32_MIN, .sum=sums[0]+sums[1], .sum_sq=sum_sqs[0]+sum_sqs[1]};
+  for (int l=0; l<4; l++) {
+    if (mins[l] < stats->min) { stats->min = mins[l]; }
+    if (maxs[l] > stats->max) { stats->max = maxs[l]; }
+  }
+  stats_add_scalar(v+i, n-i, stats);
+}
+//----- End SSE2
+
+//----- Begin AVX2
+__attribute__((target("avx2")))
+static void delta_avx2(const int32_t *split, int32_t *lap, uint32_t n) {
+  uint32_t i = 1;
+
+  if (n == 0) { return; }
+  lap[0] = split[0];
+  for (; i+8<=n; i+=8) {
+    __m256i cur = _mm256_loadu_si256((const __m256i *)(split+i));
+    __m256i prev = _mm256_loadu_si256((const __m256i *)(split+i-1));
+    _mm256_storeu_si256((__m256i *)(lap+i), _mm256_sub_epi32(cur, prev));
+  }
+  for (; i<n; i++) { lap[i] = (int32_t)((uint32_t)split[i] - (uint32_t)split[i-1]); }
+}
+
+// The byte shifts only work within each 128-bit half, so the low half's total
+// is added to the high half before the carry
+__attribute__((target("avx2")))
+static void prefix_sum_avx2(const int32_t *lap, int32_t *split, uint32_t n) {
+  __m256i carry = _mm256_setzero_si256();
+  __m256i last = _mm256_set1_epi32(7);
+  uint32_t i = 0;
+
+  for (; i+8<=n; i+=8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(lap+i));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+    __m256i low_total = _mm256_shuffle_epi32(x, 0xFF);
+    x = _mm256_add_epi32(x, _mm256_permute2x128_si256(low_total, low_total, 0x08));
+    x = _mm256_add_epi32(x, carry);
+    _mm256_storeu_si256((__m256i *)(split+i), x);
+    carry = _mm256_permutevar8x32_epi32(x, last);
+  }
+  uint32_t sum = (uint32_t)_mm256_cvtsi256_si32(carry);
+  for (; i<n; i++) {
+    sum += (uint32_t)lap[i];
+    split[i] = (int32_t)sum;
+  }
+}
+
+__attribute__((target("avx2")))
+static void stats_avx2(const int32_t *v, uint32_t n, KernelStats *stats) {
+  __m256i vmin = _mm256_set1_epi32(INT32_MAX), vmax = _mm256_set1_epi32(INT32_MIN);
+  __m256i sum = _mm256_setzero_si256(), sum_sq = _mm256_setzero_si256();
+  uint32_t i = 0;
+
+  for (; i+8<=n; i+=8) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)(v+i));
+    vmin = _mm256_min_epi32(vmin, x);
+    vmax = _mm256_max_epi32(vmax, x);
+    sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+    sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+    sum_sq = _mm256_add_epi64(sum_sq, _mm256_mul_epi32(x, x));
+    x = _mm256_srli_epi64(x, 32);
+    sum_sq = _mm256_add_epi64(sum_sq, _mm256_mul_epi32(x, x));
+  }
+
+  int32_t mins[8], maxs[8];
+  int64_t sums[4], sum_sqs[4];
+  _mm256_storeu_si256((__m256i *)mins, vmin);
+  _mm256_storeu_si256((__m256i *)maxs, vmax);
+  _mm256_storeu_si256((__m256i *)sums, sum);
+  _mm256_storeu_si256((__m256i *)sum_sqs, sum_sq);
+  *stats = (KernelStats){.min=INT32_MAX, .max=INT32_MIN,
+                         .sum=sums[0]+sums[1]+sums[2]+sums[3], .sum_sq=sum_sqs[0]+sum_sqs[1]+sum_sqs[2]+sum_sqs[3]};
+  for (int l=0; l<8; l++) {
+    if (mins[l] < stats->min) { stats->min = mins[l]; }
+    if (maxs[l] > stats->max) { stats->max = maxs[l]; }
+  }
+  stats_add_scalar(v+i, n-i, stats);
+}
+//----- End AVX2
+#endif
+
+static const KernelOps level_ops[KERNEL_NUM_LEVELS] = {
+  {delta_scalar, prefix_sum_scalar, stats_scalar},
+#ifdef KERNEL_X86
+  {delta_sse2, prefix_sum_sse2, stats_sse2},
+  {delta_avx2, prefix_sum_avx2, stats_avx2},
+#endif
+};
+
+static KernelLevel level;
+static const KernelOps *ops = &level_ops[KERNEL_SCALAR];
+
+static bool supported(KernelLevel l) {
+#ifdef KERNEL_X86
+  __builtin_cpu_init();
+  if (l == KERNEL_SSE2) { return __builtin_cpu_supports("sse2"); }
+  if (l == KERNEL_AVX2) { return __builtin_cpu_supports("avx2"); }
+#endif
+  return l == KERNEL_SCALAR;
+}
+
+// False, and the level is left as it was, if the CPU does not run it
+bool kernel_select(KernelLevel l) {
+  if (l >= KERNEL_NUM_LEVELS || !supported(l)) { return false; }
+  level = l;
+  ops = &level_ops[l];
+  return true;
+}
+
+bool kernel_select_name(const char *name) {
+  for (int l=0; l<KERNEL_NUM_LEVELS; l++) {
+    if (strcmp(name, level_names[l]) == 0) { return kernel_select(l); }
+  }
+  return false;
+}
+
+KernelLevel kernel_level(void) {
+  return level;
+}
+
+const char *kernel_level_name(KernelLevel l) {
+  return (l < KERNEL_NUM_LEVELS) ? level_names[l] : "unknown";
+}
+
+// Before main, so the worker threads only ever read ops
+__attribute__((constructor))
+static void kernel_init(void) {
+  for (int l=KERNEL_NUM_LEVELS-1; l>KERNEL_SCALAR && !kernel_select(l); l--) {}
+}
+
+// lap[0] is split[0]. The arrays must not overlap.
+void kernel_delta(const int32_t *split, int32_t *lap, uint32_t n) {
+  ops->delta(split, lap, n);
+}
+
+// split[0] is lap[0]. The arrays must not overlap.
+void kernel_prefix_sum(const int32_t *lap, int32_t *split, uint32_t n) {
+  ops->prefix_sum(lap, split, n);
+}
+
+void kernel_stats(const int32_t *v, uint32_t n, KernelStats *stats) {
+  ops->stats(v, n, stats);
+}
\ No newline at end of file
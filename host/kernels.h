@@ -0,0 +1,38 @@
+// Bulk kernels over centisecond arrays for the host tools
+//
+// Lap times from splits (what get_lap_cs() does one lap at a time), splits
+// from lap times, and the reductions the season statistics are made of. Each
+// kernel has a scalar version and, on x86, SSE2 and AVX2 versions; the best one
+// the CPU runs is picked at startup, and kernel_select() changes it, as the
+// benchmarks do. Every version gives the same result bit for bit, additions
+// wrapping the same way.
+#ifndef KERNELS_H
+#define KERNELS_H
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum KernelLevel {
+  KERNEL_SCALAR,
+  KERNEL_SSE2,
+  KERNEL_AVX2,
+  KERNEL_NUM_LEVELS
+} KernelLevel;
+
+// Of n values; an empty array has min INT32_MAX and max INT32_MIN
+typedef struct KernelStats {
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  int64_t sum_sq;
+} KernelStats;
+
+extern bool kernel_select(KernelLevel level);
+extern bool kernel_select_name(const char *name);
+extern KernelLevel kernel_level(void);
+extern const char *kernel_level_name(KernelLevel level);
+
+extern void kernel_delta(const int32_t *split, int32_t *lap, uint32_t n);
+extern void kernel_prefix_sum(const int32_t *lap, int32_t *split, uint32_t n);
+extern void kernel_stats(const int32_t *v, uint32_t n, KernelStats *stats);
+
+#endif
\ No newline at end of file
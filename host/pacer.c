@@ -0,0 +1,376 @@
+// Pacer plan optimiser: fits a plan to an athlete's history and a goal time
+//
+// Reads the athlete's sessions (export files or archives, as analytics does)
+// and works out how their pace runs over a session: each lap against the
+// session's mean lap, at its place between start and finish. That profile,
+// averaged over the sessions and sampled at the laps of the race, is scaled to
+// the goal and fitted with the fewest plan blocks (cdt.h) that come within -e
+// of the best fit -b blocks can give. Fade and negative splits come out as
+// blocks that step up or down.
+//
+// The fit is a piecewise-linear segmentation by dynamic programming, one layer
+// per block, each layer's end points searched in parallel on the pool
+// (pool.h). It is the same for every goal time, so it is done once and each
+// goal only scales and rounds it; with -g left out, goals are read a line at a
+// time from stdin for what-if runs. One line per goal:
+//
+//   goal=<t> laps=<n> blocks=<n> rms_cs=<cs> bytes=<n> plan=<plan> code=<hex>
+//
+// plan is in the form analytics and archive_tool take with -p, and code is the
+// plan as cdt_encode() codes it, for the phone to send to the watch
+// (plan_import.h). -s adds the target and plan of each lap.
+//
+//   pacer [-j threads] -n laps [-g goal[,goal...]] [-b max_blocks] [-e rms_cs] [-r] [-s] file...
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+#include "pebble.h"
+#include "cdt.h"
+#include "plan_import.h"
+#include "archive.h"
+#include "export_file.h"
+#include "pool.h"
+
+#define PACER_DEFAULT_BLOCKS 8
+#define PACER_PROFILE_TASKS  64   // Session chunks, summed in order so the profile is the same for any thread count
+
+typedef struct Fit {
+  uint16_t first;   // First lap of the line
+  uint16_t last;
+} Fit;
+
+static SessionSet *sets;
+static uint32_t num_sets;
+static uint32_t num_laps;
+static uint8_t max_blocks = PACER_DEFAULT_BLOCKS;
+static double *profile;         // Lap against the session mean, per race lap
+static double *partial;         // PACER_PROFILE_TASKS rows of num_laps sums
+static uint32_t partial_count[PACER_PROFILE_TASKS];
+static uint32_t num_sessions;
+static double sum[5][CDT_MAX_SEGMENTS+1];     // Prefix sums of x, x^2, y, xy, y^2 over the profile, x the lap
+static double *error;           // error[k*num_laps + j]: least squared error of laps 0..j in k+1 lines
+static uint16_t *start;         // start[k*num_laps + j]: first lap of the last of those lines
+static uint8_t layer;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1e3 + ts.tv_nsec/1e6;
+}
+
+// m:ss.cc, or h:mm:ss.cc from an hour
+static void format_cs(char *str, size_t size, int32_t cs) {
+  SWTime t = SWTime_from_centisecond((cs < 0) ? -cs : cs);
+  const char *sign = (cs < 0) ? "-" : "";
+  if (t.hour > 0) {
+    snprintf(str, size, "%s%d:%02d:%02d.%02d", sign, t.hour, t.minute, t.second, t.centisecond);
+  } else {
+    snprintf(str, size, "%s%d:%02d.%02d", sign, t.minute, t.second, t.centisecond);
+  }
+}
+
+// [[h:]m:]s[.cc] in centiseconds, -1 if malformed
+static int32_t parse_time(const char *str) {
+  int64_t seconds = 0;
+  int32_t cs = 0;
+  char *end;
+
+  for (;;) {
+    long part = strtol(str, &end, 10);
+    if (end == str || part < 0) { return -1; }
+    seconds = seconds*60 + part;
+    if (*end != ':') { break; }
+    str = end+1;
+  }
+  if (*end == '.') {
+    const char *frac = end+1;
+    if (frac[0] < '0' || frac[0] > '9') { return -1; }
+    cs = (frac[0]-'0')*10;
+    end = (char *)frac+1;
+    if (*end >= '0' && *end <= '9') { cs += *end++ - '0'; }
+  }
+  if (*end != '\0' && *end != '\n') { return -1; }
+  return (seconds*100 + cs > CDT_MAX_TOTAL_CS) ? -1 : (int32_t)(seconds*100 + cs);
+}
+
+//----- Begin profile
+// Task: read file i, mapping it if it is an archive
+static void read_file(void *ctx, uint32_t i) {
+  const char *path = ((char **)ctx)[i];
+  size_t len = strlen(path);
+  bool ok = (len > 4 && strcmp(path + len - 4, ".rta") == 0) ? archive_read(path, &sets[i]) : export_file_read(path, &sets[i]);
+  if (!ok) {
+    perror(path);
+    exit(2);
+  }
+}
+
+// Task: add up chunk c of the sessions. Race lap i is sampled from the lap of
+// each session that covers the middle of the race lap.
+static void profile_chunk(void *ctx, uint32_t c) {
+  double *row = &partial[c * num_laps];
+  uint32_t n = 0;
+
+  for (uint32_t f=0; f<num_sets; f++) {
+    const SessionSet *set = &sets[f];
+    uint32_t lo = (uint32_t)((uint64_t)set->num_sessions * c / PACER_PROFILE_TASKS);
+    uint32_t hi = (uint32_t)((uint64_t)set->num_sessions * (c+1) / PACER_PROFILE_TASKS);
+    for (uint32_t s=lo; s<hi; s++) {
+      const int32_t *lap = &set->lap_cs[set->first_lap[s]];
+      uint32_t laps = set->first_lap[s+1] - set->first_lap[s];
+      int64_t total = 0;
+      for (uint32_t i=0; i<laps; i++) { total += lap[i]; }
+      if (laps < 2 || total <= 0) { continue; }
+      double mean = (double)total / laps;
+      for (uint32_t i=0; i<num_laps; i++) {
+        row[i] += lap[(uint64_t)(2*i+1) * laps / (2*num_laps)] / mean;
+      }
+      n++;
+    }
+  }
+  partial_count[c] = n;
+}
+
+// An even profile with no history to go on
+static void build_profile(uint32_t threads) {
+  partial = calloc(PACER_PROFILE_TASKS * num_laps, sizeof(double));
+  profile = calloc(num_laps, sizeof(double));
+  pool_run(threads, PACER_PROFILE_TASKS, profile_chunk, NULL);
+
+  for (uint32_t c=0; c<PACER_PROFILE_TASKS; c++) {
+    for (uint32_t i=0; i<num_laps; i++) { profile[i] += partial[c * num_laps + i]; }
+    num_sessions += partial_count[c];
+  }
+  double mean = 0;
+  for (uint32_t i=0; i<num_laps; i++) {
+    profile[i] = num_sessions ? profile[i] / num_sessions : 1;
+    mean += profile[i] / num_laps;
+  }
+  for (uint32_t i=0; i<num_laps; i++) { profile[i] /= mean; }
+  free(partial);
+}
+//----- End profile
+
+//----- Begin fit
+// Squared error of the least-squares line through laps a..b
+static double line_error(uint32_t a, uint32_t b) {
+  double s[5];
+  double m = b - a + 1;
+  for (int i=0; i<5; i++) { s[i] = sum[i][b+1] - sum[i][a]; }
+  double sxx = s[1] - s[0]*s[0]/m;
+  double sxy = s[3] - s[0]*s[2]/m;
+  double syy = s[4] - s[2]*s[2]/m;
+  double e = (sxx > 0) ? syy - sxy*sxy/sxx : syy;
+  return (e > 0) ? e : 0;
+}
+
+// Task: best split of laps 0..j into layer+1 lines, given the best splits into
+// layer lines
+static void fit_end(void *ctx, uint32_t task) {
+  uint32_t j = layer + task;
+  double best = INFINITY;
+  uint16_t best_start = 0;
+
+  for (uint32_t i=layer; i<=j; i++) {
+    double e = error[(layer-1)*num_laps + i-1] + line_error(i, j);
+    if (e < best) {
+      best = e;
+      best_start = i;
+    }
+  }
+  error[layer*num_laps + j] = best;
+  start[layer*num_laps + j] = best_start;
+}
+
+static void fit(uint32_t threads) {
+  for (uint32_t i=0; i<num_laps; i++) {
+    double x = i, y = profile[i];
+    double v[5] = {x, x*x, y, x*y, y*y};
+    for (int k=0; k<5; k++) { sum[k][i+1] = sum[k][i] + v[k]; }
+  }
+  error = malloc(max_blocks * num_laps * sizeof(double));
+  start = calloc(max_blocks * num_laps, sizeof(uint16_t));
+  for (uint32_t j=0; j<num_laps; j++) { error[j] = line_error(0, j); }
+  for (layer=1; layer<max_blocks; layer++) {
+    for (uint32_t j=0; j<layer && j<num_laps; j++) { error[layer*num_laps + j] = INFINITY; }
+    if (layer < num_laps) { pool_run(threads, num_laps - layer, fit_end, NULL); }
+  }
+}
+//----- End fit
+
+
+//----- Begin plans
+// Load the fit in k lines into the timer, scaled to goal_cs. Each line is
+// rounded to a whole step, then the laps are evened up to the goal; what is
+// left over after that goes on the last lap, as a block of its own if need be.
+static bool load_plan(uint32_t k, int32_t goal_cs, bool repeat) {
+  CDTBlock_t blocks[CDT_MAX_BLOCKS];
+  double scale = (double)goal_cs / num_laps;
+  int64_t total = 0;
+
+  uint32_t j = num_laps-1;
+  for (uint32_t b=k; b-- > 0; ) {
+    uint32_t a = start[b*num_laps + j];
+    uint32_t m = j - a + 1;
+    double mean = (sum[2][j+1] - sum[2][a]) / m * scale;
+    double step = 0;
+    if (m > 1) {
+      double sx = sum[0][j+1] - sum[0][a];
+      double sxx = (sum[1][j+1] - sum[1][a]) - sx*sx/m;
+      double sxy = (sum[3][j+1] - sum[3][a]) - sx*(sum[2][j+1] - sum[2][a])/m;
+      step = (sxx > 0) ? sxy / sxx * scale : 0;
+    }
+    if (step < INT16_MIN || step > INT16_MAX) { return false; }
+    int16_t step_cs = (int16_t)lround(step);
+    blocks[b] = (CDTBlock_t){.first_cs=(int32_t)lround(mean - step_cs*(m-1.0)/2), .step_cs=step_cs, .count=m};
+    total += (int64_t)m*blocks[b].first_cs + (int64_t)step_cs*m*(m-1)/2;
+    j = a-1;
+  }
+
+  int32_t left = (int32_t)(goal_cs - total);
+  int32_t even = left / (int32_t)num_laps;
+  left -= even * (int32_t)num_laps;
+  cdt_reset_all();
+  for (uint32_t b=0; b<k; b++) {
+    CDTBlock_t block = blocks[b];
+    block.first_cs += even;
+    if (b == k-1 && left != 0) {
+      int32_t last_cs = block.first_cs + (block.count-1)*block.step_cs;
+      block.count--;
+      if (!cdt_append_block(block)) { return false; }
+      block = (CDTBlock_t){.first_cs=last_cs+left, .step_cs=0, .count=1};
+    }
+    if (!cdt_append_block(block)) { return false; }
+  }
+  cdt_get()->repeat = repeat;
+  return SWTime_to_centisecond(cdt_get_split(num_laps)) == goal_cs;
+}
+
+// Root mean square of the loaded plan against the scaled profile
+static double plan_rms(int32_t goal_cs) {
+  double e = 0;
+  for (uint32_t i=0; i<num_laps; i++) {
+    double d = SWTime_to_centisecond(cdt_get_lap(i)) - profile[i] * goal_cs / num_laps;
+    e += d*d;
+  }
+  return sqrt(e / num_laps);
+}
+
+// The fewest lines within rms_slack of the best fit that code small enough to
+// send, loaded into the timer. False if no fit does.
+static bool choose_plan(int32_t goal_cs, double rms_slack, bool repeat, uint8_t *code, uint16_t *code_len, double *rms) {
+  double best = INFINITY;
+  double fit_rms[CDT_MAX_BLOCKS];
+  uint32_t max_k = (max_blocks < num_laps) ? max_blocks : num_laps;
+
+  for (uint32_t k=1; k<=max_k; k++) {
+    fit_rms[k-1] = INFINITY;
+    if (!load_plan(k, goal_cs, repeat) || cdt_encode(code, PLAN_IMPORT_MAX_BYTES) == 0) { continue; }
+    fit_rms[k-1] = plan_rms(goal_cs);
+    if (fit_rms[k-1] < best) { best = fit_rms[k-1]; }
+  }
+  for (uint32_t k=1; k<=max_k && best < INFINITY; k++) {
+    if (fit_rms[k-1] > best + rms_slack) { continue; }
+    load_plan(k, goal_cs, repeat);
+    *code_len = cdt_encode(code, PLAN_IMPORT_MAX_BYTES);
+    *rms = fit_rms[k-1];
+    // What the watch will make of it
+    return cdt_decode(code, *code_len) && SWTime_to_centisecond(cdt_get_split(num_laps)) == goal_cs;
+  }
+  return false;
+}
+
+static void print_plan(int32_t goal_cs, const uint8_t *code, uint16_t code_len, double rms, bool laps) {
+  const cdt_t *cdt = cdt_get();
+  char str[24];
+
+  format_cs(str, sizeof(str), goal_cs);
+  printf("goal=%s laps=%u blocks=%u rms_cs=%.1f bytes=%u plan=", str, num_laps, cdt->num_blocks, rms, code_len);
+  for (uint8_t b=0; b<cdt->num_blocks; b++) {
+    printf("%s%ux%d", b ? "," : "", cdt->block[b].count, cdt->block[b].first_cs);
+    if (cdt->block[b].step_cs != 0) { printf("%+d", cdt->block[b].step_cs); }
+  }
+  printf(" code=");
+  for (uint16_t i=0; i<code_len; i++) { printf("%02x", code[i]); }
+  putchar('\n');
+
+  for (uint32_t i=0; laps && i<num_laps; i++) {
+    char target[24], plan[24];
+    format_cs(target, sizeof(target), (int32_t)lround(profile[i] * goal_cs / num_laps));
+    format_cs(plan, sizeof(plan), SWTime_to_centisecond(cdt_get_lap(i)));
+    printf("  lap=%u profile=%.3f target=%s plan=%s\n", i+1, profile[i], target, plan);
+  }
+}
+//----- End plans
+
+static bool run_goal(const char *goal, double rms_slack, bool repeat, bool laps) {
+  uint8_t code[PLAN_IMPORT_MAX_BYTES];
+  uint16_t code_len;
+  int32_t goal_cs = parse_time(goal);
+  double rms;
+
+  if (goal_cs <= 0) {
+    fprintf(stderr, "pacer: bad goal %s\n", goal);
+    return false;
+  }
+  if (!choose_plan(goal_cs, rms_slack, repeat, code, &code_len, &rms)) {
+    fprintf(stderr, "pacer: no plan of %u laps in %s\n", num_laps, goal);
+    return false;
+  }
+  print_plan(goal_cs, code, code_len, rms, laps);
+  fflush(stdout);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  uint32_t threads = pool_default_threads();
+  char *goals = NULL;
+  double rms_slack = 5;
+  bool repeat = false;
+  bool laps = false;
+  bool ok = true;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:n:g:b:e:rs")) != -1) {
+    switch (opt) {
+      case 'j': threads = atoi(optarg); break;
+      case 'n': num_laps = atoi(optarg); break;
+      case 'g': goals = optarg; break;
+      case 'b': max_blocks = atoi(optarg); break;
+      case 'e': rms_slack = atof(optarg); break;
+      case 'r': repeat = true; break;
+      case 's': laps = true; break;
+      default:
+        num_laps = 0;
+        break;
+    }
+  }
+  if (num_laps < 1 || num_laps > CDT_MAX_SEGMENTS || max_blocks < 1 || max_blocks > CDT_MAX_BLOCKS-1) {
+    fprintf(stderr, "usage: %s [-j threads] -n laps [-g goal[,goal...]] [-b max_blocks] [-e rms_cs] [-r] [-s] file...\n"
+                    "laps must be 1..%d and max_blocks 1..%d\n", argv[0], CDT_MAX_SEGMENTS, CDT_MAX_BLOCKS-1);
+    return 2;
+  }
+
+  double begin = now_ms();
+  num_sets = argc - optind;
+  sets = calloc(num_sets ? num_sets : 1, sizeof(SessionSet));
+  pool_run(threads, num_sets, read_file, argv+optind);
+  double read = now_ms();
+  build_profile(threads);
+  double profiled = now_ms();
+  fit(threads);
+  double fitted = now_ms();
+  fprintf(stderr, "pacer: files=%u sessions=%u laps=%u read_ms=%.1f profile_ms=%.1f fit_ms=%.1f\n", num_sets,
+          num_sessions, num_laps, read - begin, profiled - read, fitted - profiled);
+
+  if (goals) {
+    for (char *goal=strtok(goals, ","); goal; goal=strtok(NULL, ",")) { ok = run_goal(goal, rms_slack, repeat, laps) && ok; }
+  } else {
+    char line[64];
+    while (fgets(line, sizeof(line), stdin)) {
+      line[strcspn(line, "\r\n")] = '\0';
+      if (line[0]) { ok = run_goal(line, rms_slack, repeat, laps) && ok; }
+    }
+  }
+  return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include "pebble.h"
+#include "cdt.h"
+#include "energy.h"
+#include "kernels.h"
+#include "plan.h"
+
+// cdt.c counts its persist writes and vibes; only its plan arithmetic is used here
+void energy_count(uint8_t counter, uint16_t n) {}
+
+bool plan_parse(const char *spec, bool repeat) {
+  cdt_reset_all();
+  while (*spec) {
+    char *end;
+    long count = strtol(spec, &end, 10);
+    if (end == spec || *end != 'x') { return false; }
+    long first_cs = strtol(end+1, &end, 10);
+    long step_cs = (*end == '+' || *end == '-') ? strtol(end, &end, 10) : 0;
+    if (count <= 0 || count > UINT16_MAX || step_cs < INT16_MIN || step_cs > INT16_MAX) { return false; }
+    if (!cdt_append_block((CDTBlock_t){.first_cs=first_cs, .step_cs=step_cs, .count=count})) { return false; }
+    if (*end == ',') { end++; } else if (*end != '\0') { return false; }
+    spec = end;
+  }
+  cdt_get()->enable = true;
+  cdt_get()->repeat = repeat;
+  return cdt_get()->length > 0;
+}
+
+// Plan lap for each of the first num_laps laps. Past the end of a single plan
+// the split stands still, so those laps have a plan of zero.
+int32_t *plan_laps(uint32_t num_laps) {
+  int32_t *split_cs = malloc((num_laps ? num_laps : 1) * sizeof(int32_t));
+  int32_t *lap_cs = malloc((num_laps ? num_laps : 1) * sizeof(int32_t));
+
+  if (split_cs && lap_cs) {
+    for (uint32_t k=0; k<num_laps; k++) { split_cs[k] = SWTime_to_centisecond(cdt_get_split(k+1)); }
+    kernel_delta(split_cs, lap_cs, num_laps);
+  }
+  free(split_cs);
+  return lap_cs;
+}
\ No newline at end of file
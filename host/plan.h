@@ -0,0 +1,13 @@
+// Pacer plans for the host tools, held in cdt.c the way the watch holds them
+//
+// A plan is a list of blocks of count x first_cs, stepping by step_cs and
+// separated by commas: 10x9000, or 5x6000+50,1x3000.
+#ifndef PLAN_H
+#define PLAN_H
+#include <stdbool.h>
+#include <stdint.h>
+
+extern bool plan_parse(const char *spec, bool repeat);
+extern int32_t *plan_laps(uint32_t num_laps);
+
+#endif
\ No newline at end of file
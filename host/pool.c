@@ -0,0 +1,123 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+
+#define POOL_MAX_THREADS 256
+
+typedef struct Range {
+  pthread_mutex_t lock;
+  uint32_t lo;  // Next task to run
+  uint32_t hi;  // One past the last task
+} Range;
+
+typedef struct Pool {
+  Range range[POOL_MAX_THREADS];
+  uint32_t num_threads;
+  PoolTask task;
+  void *ctx;
+  uint32_t steals[POOL_MAX_THREADS];
+} Pool;
+
+typedef struct Worker {
+  Pool *pool;
+  uint32_t id;
+} Worker;
+
+// Next task from the front of the worker's own range, false if it is empty
+static bool take(Range *r, uint32_t *task) {
+  bool ok;
+  pthread_mutex_lock(&r->lock);
+  ok = r->lo < r->hi;
+  if (ok) {
+    *task = r->lo;
+    __atomic_store_n(&r->lo, r->lo+1, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&r->lock);
+  return ok;
+}
+
+// Move the back half of the largest other range into the worker's own. The
+// sizes are read unlocked as a hint; the split itself is made under the lock
+static bool steal(Pool *pool, uint32_t id) {
+  for (;;) {
+    uint32_t victim = id;
+    uint32_t most = 0;
+    for (uint32_t i=0; i<pool->num_threads; i++) {
+      uint32_t left = __atomic_load_n(&pool->range[i].hi, __ATOMIC_RELAXED) -
+                      __atomic_load_n(&pool->range[i].lo, __ATOMIC_RELAXED);
+      if (i != id && left > most && left <= UINT32_MAX/2) {
+        victim = i;
+        most = left;
+      }
+    }
+    if (victim == id) { return false; }
+
+    Range *v = &pool->range[victim];
+    uint32_t lo, hi;
+    pthread_mutex_lock(&v->lock);
+    hi = v->hi;
+    lo = (v->lo < hi) ? v->lo + (hi - v->lo) / 2 : hi;
+    __atomic_store_n(&v->hi, lo, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&v->lock);
+    if (lo == hi) { continue; }  // Emptied while we looked, look again
+
+    Range *own = &pool->range[id];
+    pthread_mutex_lock(&own->lock);
+    __atomic_store_n(&own->lo, lo, __ATOMIC_RELAXED);
+    __atomic_store_n(&own->hi, hi, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&own->lock);
+    pool->steals[id]++;
+    return true;
+  }
+}
+
+static void *worker_main(void *arg) {
+  Worker *w = arg;
+  Pool *pool = w->pool;
+  uint32_t task;
+
+  do {
+    while (take(&pool->range[w->id], &task)) { pool->task(pool->ctx, task); }
+  } while (steal(pool, w->id));
+  return NULL;
+}
+
+uint32_t pool_default_threads(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n < 1) ? 1 : (n > POOL_MAX_THREADS) ? POOL_MAX_THREADS : (uint32_t)n;
+}
+
+PoolStats pool_run(uint32_t num_threads, uint32_t num_tasks, PoolTask task, void *ctx) {
+  static Pool pool;
+  pthread_t thread[POOL_MAX_THREADS];
+  Worker worker[POOL_MAX_THREADS];
+  PoolStats stats = {0, 0};
+
+  if (num_threads < 1) { num_threads = 1; }
+  if (num_threads > POOL_MAX_THREADS) { num_threads = POOL_MAX_THREADS; }
+  if (num_threads > num_tasks && num_tasks > 0) { num_threads = num_tasks; }
+  pool.num_threads = num_threads;
+  pool.task = task;
+  pool.ctx = ctx;
+  for (uint32_t i=0; i<num_threads; i++) {
+    pthread_mutex_init(&pool.range[i].lock, NULL);
+    pool.range[i].lo = (uint32_t)((uint64_t)num_tasks * i / num_threads);
+    pool.range[i].hi = (uint32_t)((uint64_t)num_tasks * (i+1) / num_threads);
+    pool.steals[i] = 0;
+  }
+
+  // The calling thread is worker 0
+  for (uint32_t i=0; i<num_threads; i++) { worker[i] = (Worker){&pool, i}; }
+  for (uint32_t i=1; i<num_threads; i++) { pthread_create(&thread[i], NULL, worker_main, &worker[i]); }
+  worker_main(&worker[0]);
+  for (uint32_t i=1; i<num_threads; i++) { pthread_join(thread[i], NULL); }
+
+  stats.threads = num_threads;
+  for (uint32_t i=0; i<num_threads; i++) {
+    stats.steals += pool.steals[i];
+    pthread_mutex_destroy(&pool.range[i].lock);
+  }
+  return stats;
+}
\ No newline at end of file
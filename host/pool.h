@@ -0,0 +1,21 @@
+// Work-stealing thread pool for the host tools
+//
+// Runs tasks 0..num_tasks-1 on a fixed set of threads. Each thread starts with
+// an even share of the task range and works through it from the front; one that
+// runs dry steals the back half of the largest range left. Tasks cannot add
+// tasks, so the run ends once every range is empty.
+#ifndef POOL_H
+#define POOL_H
+#include <stdint.h>
+
+typedef void (*PoolTask)(void *ctx, uint32_t task);
+
+typedef struct PoolStats {
+  uint32_t threads;
+  uint32_t steals;
+} PoolStats;
+
+extern uint32_t pool_default_threads(void);
+extern PoolStats pool_run(uint32_t num_threads, uint32_t num_tasks, PoolTask task, void *ctx);
+
+#endif
\ No newline at end of file
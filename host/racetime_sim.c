@@ -0,0 +1,486 @@
+// The whole watch app, run on the host against the stand-in pebble.h
+//
+// stopwatch.c is compiled in here with its main() renamed, so the real init,
+// windows, click handlers and state machine run unchanged on the virtual clock.
+// A scenario script presses buttons and jumps time, and can check the result:
+//
+//   up|select|down|back [hold_ms]    press and release, 100 ms unless given
+//   wait <ms>                        let virtual time pass
+//   repeat <n> <command> [; ...]     run the rest of the line n times
+//   tap                              shake the watch
+//   plan <hex>                       send a coded pacer plan from the phone, as pacer prints it
+//   relaunch [ms]                    exit the app, and launch it again ms later
+//   state                            print the stopwatch, session memory, summaries and energy counters
+//   trace on|off                     print windows, clicks and vibes as they happen
+//   expect state idle|run|lap|stop   check the stopwatch state
+//   expect sessions <n>              check the number of saved sessions
+//   expect splits <cs>...            check the splits of the last saved session
+//   expect glance on|off             check whether the face is in glance mode
+//   expect finishers <n> [ms]...     check the finish chute count, and its first finish times
+//   expect exported <n> [ms]...      check the last chute export the phone got, and its first times
+//   expect row <r> <text>            check the text of watch face row r (0-2), blanks left out
+//   expect drawn <text>...           check the last frame drew the words as one string
+//   expect plan <laps> <total_cs>    check the pacer plan's length and total
+//   expect timers <n>                check at most n timers fired since the last timers check
+//   expect vibes <n>                 check n vibes buzzed since the last vibes check
+//   expect writes <n>                check the last saved session was charged at least n persist writes
+//   expect persist <bytes>           check persistent storage holds at most bytes, e.g. after a relaunch
+//
+// With -p the persistent storage is loaded from the file before the app starts
+// and written back after it exits, so a second run sees the app relaunched.
+//
+// With -o the run is recorded as an event trace: every press, shake and phone
+// message with its virtual time, the window transitions and vibes they caused,
+// app exits and launches, and last the final state and engine cost. -x replays
+// a trace in place of a script, as fast as the virtual clock goes, and checks
+// it traces the same line for line. A replay starts from the persist file the
+// recording did, and leaves it as it was.
+//
+//   racetime_sim [-p persist_file] [-t] [-o trace_file] [script|-]
+//   racetime_sim [-p persist_file] [-t] -x trace_file
+#include <getopt.h>
+#include <stdarg.h>
+#include <time.h>
+#include "pebble.h"
+#include "sim.h"
+
+#define main racetime_main
+#include "stopwatch.c"
+#undef main
+#include "session_codec.h"
+
+#define SIM_CLICK_MS  100
+#define MAX_LINE      256
+#define MAX_TRACE_LINE 512
+#define MAX_TOKENS    (NUM_LAP_MEMORY+2)
+
+static FILE *script;
+static const char *script_name;
+static uint16_t line_number;
+static uint16_t failures;
+static uint32_t timers_checked;
+static uint32_t vibes_checked;
+static bool relaunch;
+
+// The finish chute as the phone puts it together from the chute export
+static uint8_t phone_chute[CHUTE_NUM_BLOCKS*PERSIST_DATA_MAX_LENGTH];
+static uint16_t phone_chute_len;
+static int32_t phone_chute_end = -1;  // CHUTE_END of the last export, -1 before one ended
+static uint32_t relaunch_ms;
+
+// The trace being replayed, one line ahead of the app
+static FILE *replay;
+static char replay_line[MAX_TRACE_LINE];
+static uint64_t replay_ms;
+static char *replay_event;
+static uint32_t replay_events;
+
+static const char *state_names[] = {"idle", "run", "lap", "stop", "reset", "reset-confirm", "save-confirm"};
+
+static void fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void fail(const char *fmt, ...) {
+  va_list args;
+  fprintf(stderr, "%s:%u: ", script_name, line_number);
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+  failures++;
+}
+
+static void print_state(void) {
+  printf("[%8llu] state=%s elapsed=%d.%02d sessions=%u laps=%u windows=%u\n",
+         (unsigned long long)sim_now_ms(), state_names[stopwatch.sw_state],
+         SWTime_to_centisecond(sw_elapsed)/100, SWTime_to_centisecond(sw_elapsed)%100, session_index,
+         session[session_index].end_index-session[session_index].start_index+1, sim_window_stack_size());
+  for (uint8_t s=0; s<session_index; s++) {
+    printf("  session %u%s:", s+1, session_is_pinned(s) ? " pinned" : "");
+    for (uint8_t i=session[s].start_index; i<=session[s].end_index; i++) {
+      printf(" %d", split_cs[i]);
+    }
+    const SummaryRow_t *row = summary_get(s);
+    printf("\n    summary laps=%u total=%d best=%d date=%s", row->summary.num_laps,
+           SWTime_to_centisecond(row->summary.total), SWTime_to_centisecond(row->summary.best_lap), row->date);
+    printf("\n    energy wakeups=%u redraws=%u text_draws=%u persist_writes=%u vibes=%u\n",
+           session_energy[s].wakeups, session_energy[s].redraws, (unsigned)session_energy[s].text_draws,
+           session_energy[s].persist_writes, session_energy[s].vibes);
+  }
+  if (chute_get_count() > 0) {
+    printf("  chute finishers=%u stored=%u lost=%u data_keys=%u\n", chute_get_count(),
+           chute_get()->num_stored, chute_get()->num_lost, chute_get()->key+(chute_get()->key_len > 0));
+  }
+}
+
+// Reading stores the pending finish times, so it is traced for a replay to read too
+static uint16_t read_finishers(uint32_t *finish_ms, uint16_t max) {
+  sim_trace_printf("read finishers %u", max);
+  return chute_read(finish_ms, max);
+}
+
+static void phone_handler(DictionaryIterator *iter) {
+  Tuple *seq = dict_find(iter, MSG_KEY_CHUTE_SEQ);
+  Tuple *data = dict_find(iter, MSG_KEY_CHUTE_DATA);
+  Tuple *end = dict_find(iter, MSG_KEY_CHUTE_END);
+
+  if ((seq && seq->value->uint8 == 0) || (!seq && end)) {
+    phone_chute_len = 0;
+    phone_chute_end = -1;
+  }
+  if (data && phone_chute_len + data->length <= sizeof(phone_chute)) {
+    memcpy(&phone_chute[phone_chute_len], data->value->data, data->length);
+    phone_chute_len += data->length;
+  }
+  if (end) { phone_chute_end = end->value->uint16; }
+}
+
+// Finish times of the chute export, decoded as the phone does
+static uint16_t read_exported(uint32_t *finish_ms, uint16_t max) {
+  CodecReader r = {phone_chute, phone_chute_len, 0};
+  uint32_t t = 0;
+  uint32_t gap;
+  uint16_t n = 0;
+
+  while (codec_get_varint(&r, &gap)) {
+    t += gap;
+    if (n < max) { finish_ms[n] = t; }
+    n++;
+  }
+  return n;
+}
+
+static void expect(char **tok, int n) {
+  if (n >= 3 && strcmp(tok[1], "state") == 0) {
+    if (strcmp(tok[2], state_names[stopwatch.sw_state]) != 0) {
+      fail("state is %s, expected %s", state_names[stopwatch.sw_state], tok[2]);
+    }
+  } else if (n >= 3 && strcmp(tok[1], "sessions") == 0) {
+    if (session_index != atoi(tok[2])) { fail("%u sessions, expected %s", session_index, tok[2]); }
+  } else if (n >= 2 && strcmp(tok[1], "splits") == 0) {
+    if (session_index == 0) { fail("no saved session"); return; }
+    Session_t s = session[session_index-1];
+    if (s.end_index-s.start_index+1 != n-2) {
+      fail("%u splits, expected %d", s.end_index-s.start_index+1, n-2);
+      return;
+    }
+    for (int i=0; i<n-2; i++) {
+      int32_t cs = split_cs[s.start_index+i];
+      if (cs != atoi(tok[i+2])) { fail("split %d is %d, expected %s", i+1, cs, tok[i+2]); }
+    }
+  } else if (n >= 3 && strcmp(tok[1], "glance") == 0) {
+    if (glance != (strcmp(tok[2], "on") == 0)) { fail("glance is %s, expected %s", glance ? "on" : "off", tok[2]); }
+  } else if (n >= 4 && strcmp(tok[1], "row") == 0) {
+    char text[NUM_DIGITS*2+1] = "";
+    uint8_t row = atoi(tok[2]);
+    if (row >= NUM_ROWS) { fail("no row %u", row); return; }
+    for (uint8_t i=0; i<NUM_DIGITS; i++) {
+      if (strcmp(watchface_digit[row][i].str, " ") != 0) { strcat(text, watchface_digit[row][i].str); }
+    }
+    if (strcmp(text, tok[3]) != 0) { fail("row %u is %s, expected %s", row, text, tok[3]); }
+  } else if (n >= 3 && strcmp(tok[1], "drawn") == 0) {
+    char text[MAX_LINE] = "";
+    for (int i=2; i<n; i++) {
+      if (i > 2) { strcat(text, " "); }
+      strcat(text, tok[i]);
+    }
+    if (!sim_ui_drawn(text)) { fail("\"%s\" not drawn", text); }
+  } else if (n >= 4 && strcmp(tok[1], "plan") == 0) {
+    cdt_t *cdt = cdt_get();
+    int32_t total_cs = SWTime_to_centisecond(cdt_get_split(cdt->length));
+    if (cdt->length != atoi(tok[2]) || total_cs != atoi(tok[3])) {
+      fail("plan of %u laps in %d, expected %s in %s", cdt->length, total_cs, tok[2], tok[3]);
+    }
+  } else if (n >= 3 && strcmp(tok[1], "writes") == 0) {
+    if (session_index == 0) { fail("no saved session"); return; }
+    uint8_t writes = session_energy[session_index-1].persist_writes;
+    if (writes < atoi(tok[2])) { fail("%u persist writes, expected at least %s", writes, tok[2]); }
+  } else if (n >= 3 && strcmp(tok[1], "persist") == 0) {
+    if (sim_persist_get_usage() > (uint32_t)atoi(tok[2])) { fail("%u bytes persisted, expected at most %s", sim_persist_get_usage(), tok[2]); }
+  } else if (n >= 3 && strcmp(tok[1], "timers") == 0) {
+    uint32_t fired = sim_timer_get_stats().fired - timers_checked;
+    timers_checked += fired;
+    if (fired > (uint32_t)atoi(tok[2])) { fail("%u timers fired, expected at most %s", fired, tok[2]); }
+  } else if (n >= 3 && strcmp(tok[1], "vibes") == 0) {
+    uint32_t buzzed = sim_ui_get_stats().vibes - vibes_checked;
+    vibes_checked += buzzed;
+    if (buzzed != (uint32_t)atoi(tok[2])) { fail("%u vibes, expected %s", buzzed, tok[2]); }
+  } else if (n >= 3 && strcmp(tok[1], "finishers") == 0) {
+    uint32_t finish_ms[MAX_TOKENS];
+    uint16_t num_read = read_finishers(finish_ms, n-3);
+    if (chute_get_count() != atoi(tok[2])) { fail("%u finishers, expected %s", chute_get_count(), tok[2]); }
+    for (int i=0; i<n-3; i++) {
+      if (i >= num_read) { fail("finisher %d not stored", i+1); break; }
+      if (finish_ms[i] != (uint32_t)atoi(tok[i+3])) { fail("finisher %d at %u ms, expected %s", i+1, finish_ms[i], tok[i+3]); }
+    }
+  } else if (n >= 3 && strcmp(tok[1], "exported") == 0) {
+    uint32_t finish_ms[MAX_TOKENS];
+    uint16_t num_read = read_exported(finish_ms, n-3);
+    if (phone_chute_end != atoi(tok[2])) { fail("chute export ended at %d, expected %s", phone_chute_end, tok[2]); }
+    if (num_read != atoi(tok[2])) { fail("%u finishers exported, expected %s", num_read, tok[2]); }
+    for (int i=0; i<n-3 && i<num_read; i++) {
+      if (finish_ms[i] != (uint32_t)atoi(tok[i+3])) { fail("exported finisher %d at %u ms, expected %s", i+1, finish_ms[i], tok[i+3]); }
+    }
+  } else {
+    fail("bad expect");
+  }
+}
+
+static void send_plan(const char *hex) {
+  uint8_t code[PLAN_IMPORT_MAX_BYTES];
+  uint16_t len = 0;
+
+  sim_trace_printf("plan %s", hex);
+  for (; hex[0] && hex[1] && len < sizeof(code); hex+=2) {
+    unsigned int byte;
+    if (sscanf(hex, "%2x", &byte) != 1) { break; }
+    code[len++] = byte;
+  }
+  DictionaryIterator *iter = sim_phone_outbox_begin();
+  dict_write_data(iter, MSG_KEY_PLAN, code, len);
+  sim_phone_outbox_send();
+}
+
+static void run_command(char **tok, int n) {
+  static const char *buttons[] = {"back", "up", "select", "down"};
+
+  for (ButtonId b=BUTTON_ID_BACK; b<NUM_BUTTONS; b++) {
+    if (strcmp(tok[0], buttons[b]) == 0) {
+      sim_press(b, (n > 1) ? atoi(tok[1]) : SIM_CLICK_MS);
+      return;
+    }
+  }
+  if (strcmp(tok[0], "wait") == 0 && n > 1) {
+    sim_advance_ms(atoi(tok[1]));
+  } else if (strcmp(tok[0], "repeat") == 0 && n > 2) {
+    for (int i=atoi(tok[1]); i>0; i--) {
+      // Commands separated by ;
+      for (int start=2, end=2; end<=n; end++) {
+        if (end < n && strcmp(tok[end], ";") != 0) { continue; }
+        if (end > start) { run_command(tok+start, end-start); }
+        start = end+1;
+      }
+    }
+  } else if (strcmp(tok[0], "plan") == 0 && n > 1) {
+    send_plan(tok[1]);
+  } else if (strcmp(tok[0], "relaunch") == 0) {
+    relaunch = true;
+    relaunch_ms = (n > 1) ? atoi(tok[1]) : 0;
+  } else if (strcmp(tok[0], "tap") == 0) {
+    sim_tap(ACCEL_AXIS_Z, 1);
+  } else if (strcmp(tok[0], "state") == 0) {
+    print_state();
+  } else if (strcmp(tok[0], "trace") == 0 && n > 1) {
+    sim_set_trace(strcmp(tok[1], "on") == 0);
+  } else if (strcmp(tok[0], "expect") == 0) {
+    expect(tok, n);
+  } else {
+    fail("unknown command %s", tok[0]);
+  }
+}
+
+// Run as the app's event loop: returning from it exits the app
+static void run_script(void) {
+  char line[MAX_LINE];
+  char *tok[MAX_TOKENS];
+
+  while (!relaunch && fgets(line, sizeof(line), script)) {
+    int n = 0;
+    line_number++;
+    if (strchr(line, '#')) { *strchr(line, '#') = '\0'; }
+    for (char *t=strtok(line, " \t\r\n"); t && n<MAX_TOKENS; t=strtok(NULL, " \t\r\n")) { tok[n++] = t; }
+    if (n > 0) { run_command(tok, n); }
+  }
+}
+
+//----- Begin event trace
+// Read the next line of the trace being replayed, false at its end
+static bool replay_next(void) {
+  unsigned long long ms;
+  int offset;
+
+  replay_event = NULL;
+  while (fgets(replay_line, sizeof(replay_line), replay)) {
+    line_number++;
+    replay_line[strcspn(replay_line, "\n")] = '\0';
+    if (sscanf(replay_line, "[%llu] %n", &ms, &offset) < 1) {
+      fail("bad trace line");
+      continue;
+    }
+    replay_ms = ms;
+    replay_event = &replay_line[offset];
+    if (replay_ms > sim_now_ms()) { sim_advance_ms(replay_ms - sim_now_ms()); }
+    return true;
+  }
+  return false;
+}
+
+// Run as the app's event loop in place of run_script(). Only the inputs are
+// fed back: everything else in the trace is what they caused, and comes out
+// of the replay again by itself
+static void run_trace(void) {
+  static const char *buttons[] = {"back", "up", "select", "down"};
+  uint32_t finish_ms[MAX_TOKENS];
+  char name[8];
+  unsigned int hold_ms, max;
+  int axis, direction;
+
+  while (replay_next()) {
+    if (sscanf(replay_event, "press %7s %u ms", name, &hold_ms) == 2) {
+      for (ButtonId b=BUTTON_ID_BACK; b<NUM_BUTTONS; b++) {
+        if (strcmp(name, buttons[b]) == 0) { sim_press(b, hold_ms); }
+      }
+    } else if (sscanf(replay_event, "tap axis %d direction %d", &axis, &direction) == 2) {
+      sim_tap(axis, direction);
+    } else if (sscanf(replay_event, "read finishers %u", &max) == 1 && max < MAX_TOKENS) {
+      read_finishers(finish_ms, max);
+    } else if (strncmp(replay_event, "plan ", 5) == 0) {
+      send_plan(&replay_event[5]);
+    } else if (strcmp(replay_event, "app exit") == 0) {
+      return;
+    } else {
+      continue;
+    }
+    replay_events++;
+  }
+}
+
+static void launch(void) {
+  sim_trace_printf("app launch");
+  racetime_main();
+  sim_trace_printf("app exit");
+}
+
+// Final state and cumulative engine cost, the last line of a trace
+static void trace_end(void) {
+  SimTimerStats timers = sim_timer_get_stats();
+  SimUiStats ui = sim_ui_get_stats();
+  uint32_t splits_hash = 2166136261u;
+  uint32_t wakeups = 0;
+
+  for (uint8_t s=0; s<session_index; s++) {
+    for (uint8_t i=session[s].start_index; i<=session[s].end_index; i++) {
+      splits_hash = (splits_hash ^ (uint32_t)split_cs[i]) * 16777619u;
+    }
+    wakeups += session_energy[s].wakeups;
+  }
+  sim_trace_printf("end state=%s elapsed_cs=%d sessions=%u splits_hash=%08x persist_bytes=%u "
+                   "timers=%u/%u/%u renders=%u layer_updates=%u draw_calls=%u text_draws=%u vibes=%u wakeups=%u",
+                   state_names[stopwatch.sw_state], SWTime_to_centisecond(sw_elapsed), session_index,
+                   splits_hash, sim_persist_get_usage(), timers.registered, timers.cancelled, timers.fired,
+                   ui.renders, ui.layer_updates, ui.draw_calls, ui.text_draws, ui.vibes, wakeups);
+}
+
+// Compare the replay's own trace with the recording, reporting the first difference
+static bool trace_matches(const char *path, const char *replayed, size_t size) {
+  FILE *original = fopen(path, "r");
+  FILE *copy = fmemopen((void *)replayed, size, "r");
+  char a[MAX_TRACE_LINE], b[MAX_TRACE_LINE];
+  uint32_t line = 0;
+  bool match = true;
+
+  while (match) {
+    bool more_a = fgets(a, sizeof(a), original) != NULL;
+    bool more_b = fgets(b, sizeof(b), copy) != NULL;
+    line++;
+    if (!more_a && !more_b) { break; }
+    if (!more_a || !more_b || strcmp(a, b) != 0) {
+      fprintf(stderr, "%s:%u: recorded %s", path, line, more_a ? a : "(end)\n");
+      fprintf(stderr, "%s:%u: replayed %s", path, line, more_b ? b : "(end)\n");
+      match = false;
+    }
+  }
+  fclose(copy);
+  fclose(original);
+  return match;
+}
+//----- End event trace
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1e3 + ts.tv_nsec/1e6;
+}
+
+int main(int argc, char **argv) {
+  const char *persist_file = NULL;
+  const char *record_file = NULL;
+  const char *replay_file = NULL;
+  char *replayed = NULL;
+  size_t replayed_size = 0;
+  FILE *record = NULL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:to:x:")) != -1) {
+    switch (opt) {
+      case 'p': persist_file = optarg; break;
+      case 't': sim_set_trace(true); break;
+      case 'o': record_file = optarg; break;
+      case 'x': replay_file = optarg; break;
+      default:
+        fprintf(stderr, "usage: %s [-p persist_file] [-t] [-o trace_file] [script|-]\n"
+                        "       %s [-p persist_file] [-t] -x trace_file\n", argv[0], argv[0]);
+        return 2;
+    }
+  }
+  if (replay_file) {
+    script_name = replay_file;
+    replay = fopen(replay_file, "r");
+    record = open_memstream(&replayed, &replayed_size);
+  } else {
+    script_name = (optind < argc) ? argv[optind] : "-";
+    script = (strcmp(script_name, "-") == 0) ? stdin : fopen(script_name, "r");
+    record = record_file ? fopen(record_file, "w") : NULL;
+  }
+  if ((replay_file && !replay) || (!replay_file && !script)) {
+    perror(script_name);
+    return 2;
+  }
+  if (record_file && !record) {
+    perror(record_file);
+    return 2;
+  }
+
+  // A missing file is a fresh install
+  if (persist_file) { sim_persist_load(persist_file); }
+  sim_set_record(record);
+  sim_phone_set_handler(phone_handler);
+  if (replay) {
+    double start_ms = now_ms();
+    sim_set_event_loop(run_trace);
+    while (replay_next() && strcmp(replay_event, "app launch") == 0) { launch(); }
+    trace_end();
+    double wall_ms = now_ms()-start_ms;
+    sim_set_record(NULL);
+    fclose(record);
+    if (!trace_matches(replay_file, replayed, replayed_size)) { failures++; }
+    free(replayed);
+    printf("%s: replayed events=%u sim_ms=%llu wall_ms=%.1f speedup=%.0fx\n", script_name, replay_events,
+           (unsigned long long)sim_now_ms(), wall_ms, sim_now_ms()/(wall_ms > 0 ? wall_ms : 1e-3));
+  } else {
+    sim_set_event_loop(run_script);
+    launch();
+    while (relaunch) {
+      relaunch = false;
+      sim_advance_ms(relaunch_ms);
+      launch();
+    }
+    if (record) {
+      trace_end();
+      sim_set_record(NULL);
+      fclose(record);
+    }
+    if (persist_file && !sim_persist_save(persist_file)) {
+      perror(persist_file);
+      return 2;
+    }
+  }
+
+  SimTimerStats timers = sim_timer_get_stats();
+  SimUiStats ui = sim_ui_get_stats();
+  printf("%s: sim_ms=%llu sessions=%u persist_bytes=%u\n", script_name,
+         (unsigned long long)sim_now_ms(), session_index, sim_persist_get_usage());
+  printf("  timers registered=%u cancelled=%u fired=%u\n", timers.registered, timers.cancelled, timers.fired);
+  printf("  ui renders=%u layer_updates=%u draw_calls=%u text_draws=%u vibes=%u\n",
+         ui.renders, ui.layer_updates, ui.draw_calls, ui.text_draws, ui.vibes);
+  printf("  verify=%s\n", (failures == 0) ? "ok" : "FAILED");
+  return (failures == 0) ? 0 : 1;
+}
\ No newline at end of file
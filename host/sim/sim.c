@@ -0,0 +1,578 @@
+#include <stdarg.h>
+#include "pebble.h"
+#include "sim.h"
+
+#define SIM_MAX_EVENTS   256
+#define SIM_MAX_MESSAGE  2048
+#define SIM_MAX_PERSIST  64
+
+enum sim_event_e {SIM_EVENT_NONE,
+                  SIM_EVENT_TIMER,
+                  SIM_EVENT_TO_PHONE,
+                  SIM_EVENT_TO_WATCH,
+                  SIM_EVENT_OUTBOX_SENT,
+                  SIM_EVENT_OUTBOX_FAILED};
+
+typedef struct SimEvent {
+  uint8_t kind;
+  uint32_t id;
+  uint64_t due;
+  AppTimerCallback callback;
+  void *data;
+  uint8_t *message;
+  uint16_t message_size;
+} SimEvent;
+
+static uint64_t now_ms;
+static uint32_t next_event_id = 1;
+static SimEvent events[SIM_MAX_EVENTS];
+static SimTimerStats timer_stats;
+
+//----- Begin virtual clock
+static SimEvent *event_add(uint8_t kind, uint64_t delay_ms) {
+  for (int i=0; i<SIM_MAX_EVENTS; i++) {
+    if (events[i].kind == SIM_EVENT_NONE) {
+      events[i] = (SimEvent){.kind=kind, .id=next_event_id++, .due=now_ms+delay_ms};
+      return &events[i];
+    }
+  }
+  fprintf(stderr, "sim: event queue overflow\n");
+  abort();
+}
+
+// Earliest due event, ties broken by creation order
+static SimEvent *event_next(void) {
+  SimEvent *next = NULL;
+  for (int i=0; i<SIM_MAX_EVENTS; i++) {
+    if (events[i].kind == SIM_EVENT_NONE) { continue; }
+    if (!next || events[i].due < next->due || (events[i].due == next->due && events[i].id < next->id)) {
+      next = &events[i];
+    }
+  }
+  return next;
+}
+
+static void event_fire(SimEvent *e);
+
+uint64_t sim_now_ms(void) {
+  return now_ms;
+}
+
+// Run the next event, advancing the clock to it; false if nothing is pending
+bool sim_step(void) {
+  SimEvent *e = event_next();
+  if (!e) { return false; }
+  SimEvent fired = *e;
+  e->kind = SIM_EVENT_NONE;
+  now_ms = fired.due;
+  event_fire(&fired);
+  free(fired.message);
+  sim_ui_flush();
+  return true;
+}
+
+void sim_advance_ms(uint64_t ms) {
+  uint64_t until = now_ms + ms;
+  SimEvent *e;
+  while ((e = event_next()) && e->due <= until) {
+    sim_step();
+  }
+  now_ms = until;
+}
+
+// Run events until none is left or max_ms of virtual time passed
+void sim_run_until_idle(uint64_t max_ms) {
+  uint64_t until = now_ms + max_ms;
+  SimEvent *e;
+  while ((e = event_next()) && e->due <= until) {
+    sim_step();
+  }
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  time_t s = SIM_EPOCH_S + now_ms/1000;
+  uint16_t ms = now_ms % 1000;
+  if (tloc) { *tloc = s; }
+  if (out_ms) { *out_ms = ms; }
+  return ms;
+}
+
+time_t sim_time(time_t *tloc) {
+  time_t s = SIM_EPOCH_S + now_ms/1000;
+  if (tloc) { *tloc = s; }
+  return s;
+}
+//----- End virtual clock
+
+//----- Begin logging
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  va_list args;
+  fprintf(stderr, "[%8llu] %s:%d ", (unsigned long long)now_ms, src_filename, src_line_number);
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fputc('\n', stderr);
+}
+//----- End logging
+
+//----- Begin timers
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  SimEvent *e = event_add(SIM_EVENT_TIMER, timeout_ms);
+  timer_stats.registered++;
+  e->callback = callback;
+  e->data = callback_data;
+  return (AppTimer *)(uintptr_t)e->id;
+}
+
+static SimEvent *timer_find(AppTimer *timer_handle) {
+  uint32_t id = (uint32_t)(uintptr_t)timer_handle;
+  for (int i=0; i<SIM_MAX_EVENTS; i++) {
+    if (events[i].kind == SIM_EVENT_TIMER && events[i].id == id) { return &events[i]; }
+  }
+  return NULL;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  SimEvent *e = timer_find(timer_handle);
+  if (!e) { return false; }
+  timer_stats.rescheduled++;
+  e->due = now_ms + new_timeout_ms;
+  return true;
+}
+
+// Cancelling a timer that already fired is harmless, as on the watch
+void app_timer_cancel(AppTimer *timer_handle) {
+  SimEvent *e = timer_find(timer_handle);
+  if (e) {
+    e->kind = SIM_EVENT_NONE;
+    timer_stats.cancelled++;
+  }
+}
+
+SimTimerStats sim_timer_get_stats(void) {
+  return timer_stats;
+}
+//----- End timers
+
+//----- Begin persistent storage
+typedef struct SimPersist {
+  bool used;
+  uint32_t key;
+  uint16_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} SimPersist;
+
+static SimPersist persist[SIM_MAX_PERSIST];
+
+static SimPersist *persist_find(uint32_t key) {
+  for (int i=0; i<SIM_MAX_PERSIST; i++) {
+    if (persist[i].used && persist[i].key == key) { return &persist[i]; }
+  }
+  return NULL;
+}
+
+void sim_persist_clear(void) {
+  memset(persist, 0, sizeof(persist));
+}
+
+uint32_t sim_persist_get_usage(void) {
+  uint32_t bytes = 0;
+  for (int i=0; i<SIM_MAX_PERSIST; i++) {
+    if (persist[i].used) { bytes += persist[i].size; }
+  }
+  return bytes;
+}
+
+// File format: one record per key, {uint32 key, uint16 size, data}, host byte order
+bool sim_persist_load(const char *path) {
+  FILE *f = fopen(path, "rb");
+  SimPersist p = {.used=true};
+  int i = 0;
+
+  if (!f) { return false; }
+  sim_persist_clear();
+  while (i < SIM_MAX_PERSIST &&
+         fread(&p.key, sizeof(p.key), 1, f) == 1 &&
+         fread(&p.size, sizeof(p.size), 1, f) == 1 &&
+         p.size <= PERSIST_DATA_MAX_LENGTH &&
+         fread(p.data, 1, p.size, f) == p.size) {
+    persist[i++] = p;
+  }
+  fclose(f);
+  return true;
+}
+
+bool sim_persist_save(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) { return false; }
+  for (int i=0; i<SIM_MAX_PERSIST; i++) {
+    if (!persist[i].used) { continue; }
+    fwrite(&persist[i].key, sizeof(persist[i].key), 1, f);
+    fwrite(&persist[i].size, sizeof(persist[i].size), 1, f);
+    fwrite(persist[i].data, 1, persist[i].size, f);
+  }
+  return fclose(f) == 0;
+}
+
+bool persist_exists(const uint32_t key) {
+  return persist_find(key) != NULL;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  SimPersist *p = persist_find(key);
+  if (!p) { return E_DOES_NOT_EXIST; }
+  size_t size = (p->size < buffer_size) ? p->size : buffer_size;
+  memcpy(buffer, p->data, size);
+  return size;
+}
+
+// Like the firmware, anything past PERSIST_DATA_MAX_LENGTH is silently dropped
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  SimPersist *p = persist_find(key);
+  for (int i=0; !p && i<SIM_MAX_PERSIST; i++) {
+    if (!persist[i].used) { p = &persist[i]; }
+  }
+  if (!p) { return E_OUT_OF_STORAGE; }
+  p->used = true;
+  p->key = key;
+  p->size = (size < PERSIST_DATA_MAX_LENGTH) ? size : PERSIST_DATA_MAX_LENGTH;
+  memcpy(p->data, data, p->size);
+  return p->size;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  int32_t value = 0;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+bool persist_read_bool(const uint32_t key) {
+  bool value = false;
+  persist_read_data(key, &value, sizeof(value));
+  return value;
+}
+
+int persist_write_bool(const uint32_t key, const bool value) {
+  return persist_write_data(key, &value, sizeof(value));
+}
+
+int persist_delete(const uint32_t key) {
+  SimPersist *p = persist_find(key);
+  if (!p) { return E_DOES_NOT_EXIST; }
+  p->used = false;
+  return S_SUCCESS;
+}
+//----- End persistent storage
+
+//----- Begin Dictionary
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+  va_list args;
+  uint32_t size = sizeof(Dictionary) + tuple_count*sizeof(Tuple);
+  va_start(args, tuple_count);
+  for (int i=0; i<tuple_count; i++) {
+    size += va_arg(args, uint32_t);
+  }
+  va_end(args);
+  return size;
+}
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t *const buffer, const uint16_t size) {
+  if (!iter || !buffer || size < sizeof(Dictionary)) { return DICT_INVALID_ARGS; }
+  iter->dictionary = (Dictionary *)buffer;
+  iter->dictionary->count = 0;
+  iter->cursor = iter->dictionary->head;
+  iter->end = buffer + size;
+  return DICT_OK;
+}
+
+static DictionaryResult dict_write_tuple(DictionaryIterator *iter, uint32_t key, TupleType type,
+                                         const void *data, uint16_t size) {
+  if (!iter || !iter->cursor) { return DICT_INVALID_ARGS; }
+  if ((uint8_t *)iter->cursor + sizeof(Tuple) + size > (uint8_t *)iter->end) { return DICT_NOT_ENOUGH_STORAGE; }
+  iter->cursor->key = key;
+  iter->cursor->type = type;
+  iter->cursor->length = size;
+  memcpy(iter->cursor->value->data, data, size);
+  iter->cursor = (Tuple *)((uint8_t *)iter->cursor + sizeof(Tuple) + size);
+  iter->dictionary->count++;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *const data, const uint16_t size) {
+  return dict_write_tuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_cstring(DictionaryIterator *iter, const uint32_t key, const char *const cstring) {
+  return dict_write_tuple(iter, key, TUPLE_CSTRING, cstring, strlen(cstring)+1);
+}
+
+DictionaryResult dict_write_uint8(DictionaryIterator *iter, const uint32_t key, const uint8_t value) {
+  return dict_write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint16(DictionaryIterator *iter, const uint32_t key, const uint16_t value) {
+  return dict_write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter, const uint32_t key, const uint32_t value) {
+  return dict_write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int8(DictionaryIterator *iter, const uint32_t key, const int8_t value) {
+  return dict_write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int16(DictionaryIterator *iter, const uint32_t key, const int16_t value) {
+  return dict_write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+  return dict_write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+  if (!iter || !iter->cursor) { return 0; }
+  uint32_t size = (uint8_t *)iter->cursor - (uint8_t *)iter->dictionary;
+  iter->end = iter->cursor;
+  iter->cursor = iter->dictionary->head;
+  return size;
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter, const uint8_t *const buffer, const uint16_t size) {
+  iter->dictionary = (Dictionary *)buffer;
+  iter->end = buffer + size;
+  iter->cursor = iter->dictionary->head;
+  return dict_read_first(iter);
+}
+
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  iter->cursor = iter->dictionary->head;
+  return (iter->dictionary->count > 0) ? iter->cursor : NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  Tuple *next = (Tuple *)((uint8_t *)iter->cursor + sizeof(Tuple) + iter->cursor->length);
+  if ((uint8_t *)next >= (uint8_t *)iter->end) { return NULL; }
+  iter->cursor = next;
+  return next;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  Tuple *t = iter->dictionary->head;
+  for (int i=0; i<iter->dictionary->count; i++) {
+    if (t->key == key) { return t; }
+    t = (Tuple *)((uint8_t *)t + sizeof(Tuple) + t->length);
+  }
+  return NULL;
+}
+//----- End Dictionary
+
+//----- Begin AppMessage link
+static SimLink sim_link = {.latency_ms={200, 25}, .send_timeout_ms=1000};
+static SimLinkStats link_stats;
+static uint32_t link_rand_state = 1;
+static SniffInterval sniff_interval;
+static uint64_t sniff_reduced_since;
+
+static uint32_t inbox_size, outbox_size;
+static uint8_t outbox_buffer[SIM_MAX_MESSAGE];
+static DictionaryIterator outbox_iter;
+static bool outbox_pending;     // Between outbox_begin and outbox_send
+static bool outbox_in_flight;   // Between outbox_send and sent/failed callback
+static void *message_context;
+static AppMessageInboxReceived inbox_received;
+static AppMessageInboxDropped inbox_dropped;
+static AppMessageOutboxSent outbox_sent;
+static AppMessageOutboxFailed outbox_failed;
+
+static uint8_t phone_buffer[SIM_MAX_MESSAGE];
+static DictionaryIterator phone_iter;
+static SimPhoneHandler phone_handler;
+
+static bool link_roll(uint16_t permille) {
+  link_rand_state = link_rand_state * 1103515245 + 12345;
+  return ((link_rand_state >> 16) % 1000) < permille;
+}
+
+static uint32_t link_latency(void) {
+  return sim_link.latency_ms[sniff_interval];
+}
+
+void sim_link_configure(SimLink config) {
+  sim_link = config;
+  link_rand_state = config.seed ? config.seed : 1;
+}
+
+SimLinkStats sim_link_get_stats(void) {
+  SimLinkStats stats = link_stats;
+  if (sniff_interval == SNIFF_INTERVAL_REDUCED) { stats.reduced_sniff_ms += now_ms - sniff_reduced_since; }
+  return stats;
+}
+
+void sim_phone_set_handler(SimPhoneHandler handler) {
+  phone_handler = handler;
+}
+
+DictionaryIterator *sim_phone_outbox_begin(void) {
+  dict_write_begin(&phone_iter, phone_buffer, inbox_size);
+  return &phone_iter;
+}
+
+void sim_phone_outbox_send(void) {
+  uint32_t size = dict_write_end(&phone_iter);
+  SimEvent *e = event_add(SIM_EVENT_TO_WATCH, link_latency());
+  e->message = malloc(size);
+  memcpy(e->message, phone_buffer, size);
+  e->message_size = size;
+  link_stats.messages_to_watch++;
+  link_stats.bytes_to_watch += size;
+}
+
+void app_comm_set_sniff_interval(const SniffInterval interval) {
+  if (interval == sniff_interval) { return; }
+  if (interval == SNIFF_INTERVAL_REDUCED) {
+    sniff_reduced_since = now_ms;
+  } else {
+    link_stats.reduced_sniff_ms += now_ms - sniff_reduced_since;
+  }
+  sniff_interval = interval;
+}
+
+SniffInterval app_comm_get_sniff_interval(void) {
+  return sniff_interval;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  if (size_inbound > app_message_inbox_size_maximum() || size_outbound > app_message_outbox_size_maximum()) {
+    return APP_MSG_OUT_OF_MEMORY;
+  }
+  inbox_size = size_inbound;
+  outbox_size = size_outbound;
+  return APP_MSG_OK;
+}
+
+void app_message_deregister_callbacks(void) {
+  inbox_received = NULL;
+  inbox_dropped = NULL;
+  outbox_sent = NULL;
+  outbox_failed = NULL;
+}
+
+void *app_message_get_context(void) {
+  return message_context;
+}
+
+void *app_message_set_context(void *context) {
+  void *prev = message_context;
+  message_context = context;
+  return prev;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+  AppMessageInboxReceived prev = inbox_received;
+  inbox_received = received_callback;
+  return prev;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+  AppMessageInboxDropped prev = inbox_dropped;
+  inbox_dropped = dropped_callback;
+  return prev;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  AppMessageOutboxSent prev = outbox_sent;
+  outbox_sent = sent_callback;
+  return prev;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+  AppMessageOutboxFailed prev = outbox_failed;
+  outbox_failed = failed_callback;
+  return prev;
+}
+
+uint32_t app_message_inbox_size_maximum(void) {
+  return SIM_MAX_MESSAGE;
+}
+
+uint32_t app_message_outbox_size_maximum(void) {
+  return sim_link.outbox_size_maximum ? sim_link.outbox_size_maximum : SIM_MAX_MESSAGE;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if (outbox_size == 0) { return APP_MSG_INVALID_ARGS; }
+  if (outbox_pending || outbox_in_flight) { return APP_MSG_BUSY; }
+  dict_write_begin(&outbox_iter, outbox_buffer, outbox_size);
+  outbox_pending = true;
+  *iterator = &outbox_iter;
+  return APP_MSG_OK;
+}
+
+// Transport round trip: delivery after one latency, the transport ack after another
+AppMessageResult app_message_outbox_send(void) {
+  if (!outbox_pending) { return APP_MSG_INVALID_ARGS; }
+  uint32_t size = (uint8_t *)outbox_iter.end - outbox_buffer;
+  if (outbox_iter.cursor != outbox_iter.dictionary->head) {
+    // dict_write_end() was not called
+    size = (uint8_t *)outbox_iter.cursor - outbox_buffer;
+  }
+  outbox_pending = false;
+  outbox_in_flight = true;
+  link_stats.messages_to_phone++;
+  link_stats.bytes_to_phone += size;
+
+  if (link_roll(sim_link.transport_loss_permille)) {
+    link_stats.transport_failures++;
+    event_add(SIM_EVENT_OUTBOX_FAILED, sim_link.send_timeout_ms);
+    return APP_MSG_OK;
+  }
+  if (link_roll(sim_link.app_loss_permille)) {
+    link_stats.app_drops++;
+  } else {
+    SimEvent *e = event_add(SIM_EVENT_TO_PHONE, link_latency());
+    e->message = malloc(size);
+    memcpy(e->message, outbox_buffer, size);
+    e->message_size = size;
+  }
+  event_add(SIM_EVENT_OUTBOX_SENT, 2*link_latency());
+  return APP_MSG_OK;
+}
+
+static void deliver(SimEvent *e, bool to_phone) {
+  DictionaryIterator iter;
+  dict_read_begin_from_buffer(&iter, e->message, e->message_size);
+  if (to_phone) {
+    if (phone_handler) { phone_handler(&iter); }
+  } else if (inbox_received) {
+    inbox_received(&iter, message_context);
+  }
+}
+//----- End AppMessage link
+
+static void event_fire(SimEvent *e) {
+  switch (e->kind) {
+    case SIM_EVENT_TIMER:
+      timer_stats.fired++;
+      e->callback(e->data);
+      break;
+    case SIM_EVENT_TO_PHONE:
+      deliver(e, true);
+      break;
+    case SIM_EVENT_TO_WATCH:
+      deliver(e, false);
+      break;
+    case SIM_EVENT_OUTBOX_SENT:
+      outbox_in_flight = false;
+      if (outbox_sent) { outbox_sent(&outbox_iter, message_context); }
+      break;
+    case SIM_EVENT_OUTBOX_FAILED:
+      outbox_in_flight = false;
+      if (outbox_failed) { outbox_failed(&outbox_iter, APP_MSG_SEND_TIMEOUT, message_context); }
+      break;
+  }
+}
\ No newline at end of file
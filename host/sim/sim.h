@@ -0,0 +1,93 @@
+#ifndef SIM_H
+#define SIM_H
+#include "pebble.h"
+
+// Host-side driver API for the Pebble stand-in
+//
+// All time is virtual: nothing happens until the driver advances the clock,
+// at which point due timers and in-flight messages fire in timestamp order.
+
+//----- Begin virtual clock
+#define SIM_EPOCH_S 1420070400    // Wall clock at virtual time 0, seen through time_ms()
+
+extern uint64_t sim_now_ms(void);
+extern bool sim_step(void);
+extern void sim_advance_ms(uint64_t);
+extern void sim_run_until_idle(uint64_t);
+//----- End virtual clock
+
+//----- Begin timers
+typedef struct SimTimerStats {
+  uint32_t registered;
+  uint32_t rescheduled;
+  uint32_t cancelled;
+  uint32_t fired;
+} SimTimerStats;
+
+extern SimTimerStats sim_timer_get_stats(void);
+//----- End timers
+
+//----- Begin persistent storage
+// Held in memory for the lifetime of the process, like a watch that keeps the app installed.
+// Load and save carry it across runs, like relaunching the app
+extern void sim_persist_clear(void);
+extern uint32_t sim_persist_get_usage(void);
+extern bool sim_persist_load(const char *path);
+extern bool sim_persist_save(const char *path);
+//----- End persistent storage
+
+//----- Begin AppMessage link to the phone
+typedef struct SimLink {
+  uint32_t latency_ms[2];             // One-way latency at SNIFF_INTERVAL_NORMAL, SNIFF_INTERVAL_REDUCED
+  uint32_t send_timeout_ms;           // Delay before APP_MSG_SEND_TIMEOUT on a lost message
+  uint16_t outbox_size_maximum;       // Reported by app_message_outbox_size_maximum(), 0 for default
+  uint16_t transport_loss_permille;   // Message lost on air, watch sees outbox_failed
+  uint16_t app_loss_permille;         // Message acked by transport but lost before the phone app
+  uint32_t seed;
+} SimLink;
+
+typedef struct SimLinkStats {
+  uint32_t messages_to_phone;
+  uint32_t bytes_to_phone;
+  uint32_t messages_to_watch;
+  uint32_t bytes_to_watch;
+  uint32_t transport_failures;
+  uint32_t app_drops;
+  uint64_t reduced_sniff_ms;          // Time spent with the radio in reduced sniff mode
+} SimLinkStats;
+
+typedef void (*SimPhoneHandler)(DictionaryIterator *iter);
+
+extern void sim_link_configure(SimLink);
+extern SimLinkStats sim_link_get_stats(void);
+extern void sim_phone_set_handler(SimPhoneHandler);
+extern DictionaryIterator *sim_phone_outbox_begin(void);
+extern void sim_phone_outbox_send(void);
+//----- End AppMessage link to the phone
+
+//----- Begin app UI (ui.c)
+// Windows, layers and clicks behave like the firmware's; drawing is counted, not rasterized.
+// The top window is redrawn after every event that marked something dirty
+typedef void (*SimEventLoop)(void);
+
+typedef struct SimUiStats {
+  uint32_t renders;         // Frames drawn
+  uint32_t layer_updates;   // Layers drawn, update procs included
+  uint32_t draw_calls;      // graphics_* calls, text included
+  uint32_t text_draws;
+  uint32_t vibes;
+} SimUiStats;
+
+extern void sim_set_event_loop(SimEventLoop);   // Run by app_event_loop() in place of the firmware's loop
+extern void sim_set_trace(bool);                // Print windows, clicks, vibes and light to stdout
+extern void sim_set_record(FILE *);             // Also write them to the file, one line each, NULL to stop
+extern void sim_trace_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+extern void sim_ui_flush(void);
+extern void sim_press(ButtonId, uint32_t hold_ms);
+extern void sim_tap(AccelAxisType, int32_t);
+extern uint8_t sim_window_stack_size(void);
+extern SimUiStats sim_ui_get_stats(void);
+extern bool sim_ui_drawn(const char *);      // Drawn as one string in the last frame
+//----- End app UI (ui.c)
+
+#endif
\ No newline at end of file
@@ -0,0 +1,913 @@
+#include <stdarg.h>
+#include "pebble.h"
+#include "sim.h"
+
+#define SIM_SCREEN_W        144
+#define SIM_SCREEN_H        168
+#define SIM_STATUS_BAR_H    16
+#define SIM_MAX_WINDOWS     8
+#define SIM_REPEAT_DELAY_MS 400   // Hold time before a repeating click starts repeating
+#define SIM_MENU_LONG_MS    500
+#define SIM_SCROLL_STEP     40
+#define SIM_FRAME_TEXT_MAX  2048  // Text kept from the last frame
+
+enum sim_layer_kind_e {SIM_LAYER_PLAIN,
+                       SIM_LAYER_TEXT,
+                       SIM_LAYER_BITMAP,
+                       SIM_LAYER_INVERTER,
+                       SIM_LAYER_SCROLL,
+                       SIM_LAYER_MENU};
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  bool hidden;
+  uint8_t kind;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  Window *window;       // Set on root layers only
+  void *data;           // layer_create_with_data() payload
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GTextAlignment alignment;
+  GTextOverflowMode overflow;
+  GColor text_color;
+  GColor background_color;
+};
+
+struct BitmapLayer {
+  Layer layer;
+  const GBitmap *bitmap;
+  GAlign alignment;
+  GColor background_color;
+  GCompOp compositing_mode;
+};
+
+struct InverterLayer {
+  Layer layer;
+};
+
+struct ScrollLayer {
+  Layer layer;
+  Layer content;
+  GSize content_size;
+  ScrollLayerCallbacks callbacks;
+  void *context;
+};
+
+struct MenuLayer {
+  Layer layer;
+  MenuLayerCallbacks callbacks;
+  void *context;
+  MenuIndex selected;
+};
+
+typedef struct ClickConfig {
+  ClickHandler single;
+  uint16_t repeat_ms;
+  ClickHandler long_down;
+  ClickHandler long_up;
+  uint16_t long_delay_ms;
+  ClickHandler raw_down;
+  ClickHandler raw_up;
+  void *raw_context;
+  void *context;
+} ClickConfig;
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  ClickConfigProvider click_config_provider;
+  void *click_config_context;
+  bool click_config_has_context;
+  ScrollLayer *scroll_layer;    // Set by scroll_layer_set_click_config_onto_window()
+  MenuLayer *menu_layer;        // Set by menu_layer_set_click_config_onto_window()
+  ClickConfig clicks[NUM_BUTTONS];
+  GColor background_color;
+  bool fullscreen;
+  bool loaded;
+};
+
+struct GBitmap {
+  uint32_t resource_id;
+};
+
+struct GFontInfo {
+  const char *key;
+  int16_t height;
+};
+
+typedef struct SimClickRecognizer {
+  ButtonId button_id;
+} SimClickRecognizer;
+
+static Window *window_stack[SIM_MAX_WINDOWS];
+static uint8_t window_stack_size;
+static Window *configuring;       // Window whose click config provider is running
+static void *configuring_context;
+static bool dirty;
+static bool trace;
+static FILE *record;
+static SimEventLoop event_loop;
+static SimUiStats ui_stats;
+
+// Every string drawn in the last frame, each followed by a NUL
+static char frame_text[SIM_FRAME_TEXT_MAX];
+static uint16_t frame_text_len;
+static AccelTapHandler accel_tap_handler;
+static TickHandler tick_handler;
+
+void sim_trace_printf(const char *fmt, ...) {
+  va_list args;
+  if (trace) {
+    printf("[%8llu] ", (unsigned long long)sim_now_ms());
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+  }
+  if (record) {
+    fprintf(record, "[%8llu] ", (unsigned long long)sim_now_ms());
+    va_start(args, fmt);
+    vfprintf(record, fmt, args);
+    va_end(args);
+    fputc('\n', record);
+  }
+}
+
+//----- Begin graphics
+// Rendering does no rasterizing: calls are counted so the cost of a frame can be profiled
+struct GContext {
+  GColor fill_color;
+  GColor stroke_color;
+  GColor text_color;
+};
+
+static GContext context;
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color)   { ctx->fill_color = color; }
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) { ctx->stroke_color = color; }
+void graphics_context_set_text_color(GContext *ctx, GColor color)   { ctx->text_color = color; }
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment,
+                        const GTextLayoutCacheRef layout) {
+  ui_stats.draw_calls++;
+  ui_stats.text_draws++;
+  if (text && frame_text_len + strlen(text) < sizeof(frame_text)) {
+    strcpy(&frame_text[frame_text_len], text);
+    frame_text_len += strlen(text)+1;
+  }
+}
+
+// Rough metrics: one line per newline, glyphs half as wide as the font is tall
+GSize graphics_text_layout_get_content_size(const char *text, GFont const font, const GRect box,
+                                            const GTextOverflowMode overflow_mode, const GTextAlignment alignment) {
+  int16_t height = font ? font->height : 18;
+  int16_t lines = 1, line_len = 0, max_len = 0;
+  for (const char *c=text; c && *c; c++) {
+    if (*c == '\n') {
+      if (c[1] != '\0') { lines++; }
+      line_len = 0;
+      continue;
+    }
+    if (++line_len > max_len) { max_len = line_len; }
+  }
+  GSize size = GSize(max_len*height/2, lines*height);
+  if (size.w > box.size.w) { size.w = box.size.w; }
+  if (size.h > box.size.h) { size.h = box.size.h; }
+  return size;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) { ui_stats.draw_calls++; }
+void graphics_draw_rect(GContext *ctx, GRect rect)                             { ui_stats.draw_calls++; }
+void graphics_draw_round_rect(GContext *ctx, GRect rect, uint16_t radius)      { ui_stats.draw_calls++; }
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius)            { ui_stats.draw_calls++; }
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius)            { ui_stats.draw_calls++; }
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1)                   { ui_stats.draw_calls++; }
+void graphics_draw_pixel(GContext *ctx, GPoint point)                          { ui_stats.draw_calls++; }
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) { ui_stats.draw_calls++; }
+//----- End graphics
+
+//----- Begin fonts and resources
+static struct GFontInfo fonts[] = {
+  {FONT_KEY_GOTHIC_14, 14},
+  {FONT_KEY_GOTHIC_14_BOLD, 14},
+  {FONT_KEY_GOTHIC_18, 18},
+  {FONT_KEY_GOTHIC_18_BOLD, 18},
+  {FONT_KEY_GOTHIC_24, 24},
+  {FONT_KEY_GOTHIC_24_BOLD, 24},
+  {FONT_KEY_GOTHIC_28, 28},
+  {FONT_KEY_GOTHIC_28_BOLD, 28},
+  {FONT_KEY_BITHAM_30_BLACK, 30},
+  {FONT_KEY_BITHAM_34_MEDIUM_NUMBERS, 34},
+  {FONT_KEY_BITHAM_42_BOLD, 42},
+  {FONT_KEY_BITHAM_42_MEDIUM_NUMBERS, 42},
+};
+
+GFont fonts_get_system_font(const char *font_key) {
+  for (size_t i=0; i<sizeof(fonts)/sizeof(fonts[0]); i++) {
+    if (strcmp(fonts[i].key, font_key) == 0) { return &fonts[i]; }
+  }
+  fprintf(stderr, "sim: unknown font %s\n", font_key);
+  abort();
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  GBitmap *bitmap = malloc(sizeof(GBitmap));
+  bitmap->resource_id = resource_id;
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  free(bitmap);
+}
+//----- End fonts and resources
+
+//----- Begin layers
+static void layer_init(Layer *layer, GRect frame, uint8_t kind) {
+  *layer = (Layer){.frame=frame, .bounds=GRect(0, 0, frame.size.w, frame.size.h), .kind=kind};
+}
+
+static void layer_draw(Layer *layer);
+
+static void layer_draw_children(Layer *layer) {
+  for (Layer *child=layer->first_child; child; child=child->next_sibling) {
+    layer_draw(child);
+  }
+}
+
+static void menu_layer_draw(MenuLayer *menu_layer);
+
+static void layer_draw(Layer *layer) {
+  if (layer->hidden) { return; }
+  ui_stats.layer_updates++;
+  if (layer->update_proc) {
+    layer->update_proc(layer, &context);
+  } else {
+    switch (layer->kind) {
+      case SIM_LAYER_TEXT:
+        if (((TextLayer *)layer)->background_color != GColorClear) { graphics_fill_rect(&context, layer->bounds, 0, GCornerNone); }
+        if (((TextLayer *)layer)->text) { ui_stats.draw_calls++; ui_stats.text_draws++; }
+        break;
+      case SIM_LAYER_BITMAP:
+        if (((BitmapLayer *)layer)->bitmap) { ui_stats.draw_calls++; }
+        break;
+      case SIM_LAYER_INVERTER:
+        ui_stats.draw_calls++;
+        break;
+      case SIM_LAYER_SCROLL:
+        layer_draw(&((ScrollLayer *)layer)->content);
+        break;
+      case SIM_LAYER_MENU:
+        menu_layer_draw((MenuLayer *)layer);
+        break;
+    }
+  }
+  layer_draw_children(layer);
+}
+
+Layer *layer_create(GRect frame) {
+  Layer *layer = malloc(sizeof(Layer));
+  layer_init(layer, frame, SIM_LAYER_PLAIN);
+  return layer;
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = layer_create(frame);
+  layer->data = calloc(1, data_size);
+  return layer;
+}
+
+void layer_destroy(Layer *layer) {
+  if (!layer) { return; }
+  layer_remove_from_parent(layer);
+  free(layer->data);
+  free(layer);
+}
+
+void *layer_get_data(const Layer *layer) {
+  return layer->data;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  Layer **link = &parent->first_child;
+  layer_remove_from_parent(child);
+  while (*link) { link = &(*link)->next_sibling; }
+  *link = child;
+  child->parent = parent;
+  dirty = true;
+}
+
+void layer_remove_from_parent(Layer *child) {
+  if (!child->parent) { return; }
+  for (Layer **link=&child->parent->first_child; *link; link=&(*link)->next_sibling) {
+    if (*link == child) {
+      *link = child->next_sibling;
+      break;
+    }
+  }
+  child->parent = NULL;
+  child->next_sibling = NULL;
+  dirty = true;
+}
+
+void layer_mark_dirty(Layer *layer)               { dirty = true; }
+GRect layer_get_frame(const Layer *layer)         { return layer->frame; }
+GRect layer_get_bounds(const Layer *layer)        { return layer->bounds; }
+void layer_set_frame(Layer *layer, GRect frame)   { layer->frame = frame; dirty = true; }
+void layer_set_bounds(Layer *layer, GRect bounds) { layer->bounds = bounds; dirty = true; }
+bool layer_get_hidden(const Layer *layer)         { return layer->hidden; }
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  if (layer->hidden != hidden) { dirty = true; }
+  layer->hidden = hidden;
+}
+
+Window *layer_get_window(const Layer *layer) {
+  while (layer->parent) { layer = layer->parent; }
+  return layer->window;
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *text_layer = malloc(sizeof(TextLayer));
+  layer_init(&text_layer->layer, frame, SIM_LAYER_TEXT);
+  text_layer->text = NULL;
+  text_layer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
+  text_layer->alignment = GTextAlignmentLeft;
+  text_layer->overflow = GTextOverflowModeWordWrap;
+  text_layer->text_color = GColorBlack;
+  text_layer->background_color = GColorWhite;
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  if (!text_layer) { return; }
+  layer_remove_from_parent(&text_layer->layer);
+  free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer)                         { return &text_layer->layer; }
+void text_layer_set_text(TextLayer *text_layer, const char *text)          { text_layer->text = text; dirty = true; }
+const char *text_layer_get_text(TextLayer *text_layer)                     { return text_layer->text; }
+void text_layer_set_font(TextLayer *text_layer, GFont font)                { text_layer->font = font; dirty = true; }
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment a) { text_layer->alignment = a; dirty = true; }
+void text_layer_set_text_color(TextLayer *text_layer, GColor color)        { text_layer->text_color = color; dirty = true; }
+void text_layer_set_background_color(TextLayer *text_layer, GColor color)  { text_layer->background_color = color; dirty = true; }
+void text_layer_set_overflow_mode(TextLayer *text_layer, GTextOverflowMode m) { text_layer->overflow = m; dirty = true; }
+
+void text_layer_set_size(TextLayer *text_layer, const GSize max_size) {
+  text_layer->layer.frame.size = max_size;
+  text_layer->layer.bounds.size = max_size;
+  dirty = true;
+}
+
+GSize text_layer_get_content_size(TextLayer *text_layer) {
+  return graphics_text_layout_get_content_size(text_layer->text, text_layer->font, text_layer->layer.bounds,
+                                               text_layer->overflow, text_layer->alignment);
+}
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+  BitmapLayer *bitmap_layer = malloc(sizeof(BitmapLayer));
+  layer_init(&bitmap_layer->layer, frame, SIM_LAYER_BITMAP);
+  bitmap_layer->bitmap = NULL;
+  bitmap_layer->alignment = GAlignCenter;
+  bitmap_layer->background_color = GColorClear;
+  bitmap_layer->compositing_mode = GCompOpAssign;
+  return bitmap_layer;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+  if (!bitmap_layer) { return; }
+  layer_remove_from_parent(&bitmap_layer->layer);
+  free(bitmap_layer);
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer)                     { return (Layer *)&bitmap_layer->layer; }
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap)     { bitmap_layer->bitmap = bitmap; dirty = true; }
+void bitmap_layer_set_alignment(BitmapLayer *bitmap_layer, GAlign alignment)       { bitmap_layer->alignment = alignment; dirty = true; }
+void bitmap_layer_set_background_color(BitmapLayer *bitmap_layer, GColor color)    { bitmap_layer->background_color = color; dirty = true; }
+void bitmap_layer_set_compositing_mode(BitmapLayer *bitmap_layer, GCompOp mode)    { bitmap_layer->compositing_mode = mode; dirty = true; }
+
+InverterLayer *inverter_layer_create(GRect frame) {
+  InverterLayer *inverter_layer = malloc(sizeof(InverterLayer));
+  layer_init(&inverter_layer->layer, frame, SIM_LAYER_INVERTER);
+  return inverter_layer;
+}
+
+void inverter_layer_destroy(InverterLayer *inverter_layer) {
+  if (!inverter_layer) { return; }
+  layer_remove_from_parent(&inverter_layer->layer);
+  free(inverter_layer);
+}
+
+Layer *inverter_layer_get_layer(InverterLayer *inverter_layer) {
+  return &inverter_layer->layer;
+}
+//----- End layers
+
+//----- Begin clicks
+static void click_subscribe(ButtonId button_id, ClickConfig config) {
+  if (!configuring) {
+    fprintf(stderr, "sim: click subscription outside a click config provider\n");
+    abort();
+  }
+  ClickConfig *c = &configuring->clicks[button_id];
+  if (config.single)    { c->single = config.single; c->repeat_ms = config.repeat_ms; }
+  if (config.long_down || config.long_up) {
+    c->long_down = config.long_down;
+    c->long_up = config.long_up;
+    c->long_delay_ms = config.long_delay_ms;
+  }
+  if (config.raw_down || config.raw_up) {
+    c->raw_down = config.raw_down;
+    c->raw_up = config.raw_up;
+    c->raw_context = config.raw_context;
+  }
+  c->context = configuring_context;
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler) {
+  click_subscribe(button_id, (ClickConfig){.single=handler});
+}
+
+void window_single_repeating_click_subscribe(ButtonId button_id, uint16_t repeat_interval_ms, ClickHandler handler) {
+  click_subscribe(button_id, (ClickConfig){.single=handler, .repeat_ms=repeat_interval_ms});
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler) {
+  click_subscribe(button_id, (ClickConfig){.long_down=down_handler, .long_up=up_handler,
+                                           .long_delay_ms=(delay_ms == 0) ? 500 : delay_ms});
+}
+
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler, ClickHandler up_handler, void *context) {
+  click_subscribe(button_id, (ClickConfig){.raw_down=down_handler, .raw_up=up_handler, .raw_context=context});
+}
+
+ButtonId click_recognizer_get_button_id(ClickRecognizerRef recognizer) {
+  return ((SimClickRecognizer *)recognizer)->button_id;
+}
+
+static void scroll_click_handler(ClickRecognizerRef recognizer, void *context);
+static void menu_click_handler(ClickRecognizerRef recognizer, void *context);
+static void menu_long_click_handler(ClickRecognizerRef recognizer, void *context);
+
+// Same order as the firmware: layer defaults first, then the app's own provider
+static void window_configure_clicks(Window *window) {
+  memset(window->clicks, 0, sizeof(window->clicks));
+  configuring = window;
+  if (window->menu_layer) {
+    configuring_context = window->menu_layer;
+    window_single_repeating_click_subscribe(BUTTON_ID_UP, 100, menu_click_handler);
+    window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 100, menu_click_handler);
+    window_single_click_subscribe(BUTTON_ID_SELECT, menu_click_handler);
+    window_long_click_subscribe(BUTTON_ID_SELECT, SIM_MENU_LONG_MS, menu_long_click_handler, NULL);
+  } else if (window->scroll_layer) {
+    configuring_context = window->scroll_layer;
+    window_single_repeating_click_subscribe(BUTTON_ID_UP, 100, scroll_click_handler);
+    window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 100, scroll_click_handler);
+    if (window->scroll_layer->callbacks.click_config_provider) {
+      configuring_context = window->scroll_layer->context;
+      window->scroll_layer->callbacks.click_config_provider(configuring_context);
+    }
+  } else if (window->click_config_provider) {
+    configuring_context = window->click_config_has_context ? window->click_config_context : window;
+    window->click_config_provider(configuring_context);
+  }
+  configuring = NULL;
+}
+//----- End clicks
+
+//----- Begin scroll layer
+ScrollLayer *scroll_layer_create(GRect frame) {
+  ScrollLayer *scroll_layer = malloc(sizeof(ScrollLayer));
+  layer_init(&scroll_layer->layer, frame, SIM_LAYER_SCROLL);
+  layer_init(&scroll_layer->content, GRect(0, 0, frame.size.w, frame.size.h), SIM_LAYER_PLAIN);
+  scroll_layer->content_size = frame.size;
+  scroll_layer->callbacks = (ScrollLayerCallbacks){NULL, NULL};
+  scroll_layer->context = scroll_layer;
+  return scroll_layer;
+}
+
+void scroll_layer_destroy(ScrollLayer *scroll_layer) {
+  if (!scroll_layer) { return; }
+  layer_remove_from_parent(&scroll_layer->layer);
+  free(scroll_layer);
+}
+
+Layer *scroll_layer_get_layer(const ScrollLayer *scroll_layer)                    { return (Layer *)&scroll_layer->layer; }
+void scroll_layer_add_child(ScrollLayer *scroll_layer, Layer *child)              { layer_add_child(&scroll_layer->content, child); }
+void scroll_layer_set_callbacks(ScrollLayer *scroll_layer, ScrollLayerCallbacks callbacks) { scroll_layer->callbacks = callbacks; }
+void scroll_layer_set_context(ScrollLayer *scroll_layer, void *context)           { scroll_layer->context = context; }
+GPoint scroll_layer_get_content_offset(ScrollLayer *scroll_layer)                 { return scroll_layer->content.frame.origin; }
+
+void scroll_layer_set_click_config_onto_window(ScrollLayer *scroll_layer, Window *window) {
+  window->scroll_layer = scroll_layer;
+}
+
+void scroll_layer_set_content_size(ScrollLayer *scroll_layer, GSize size) {
+  scroll_layer->content_size = size;
+  scroll_layer->content.frame.size = size;
+  scroll_layer->content.bounds.size = size;
+  dirty = true;
+}
+
+void scroll_layer_set_content_offset(ScrollLayer *scroll_layer, GPoint offset, bool animated) {
+  int16_t min_y = scroll_layer->layer.frame.size.h - scroll_layer->content_size.h;
+  if (offset.y < min_y) { offset.y = min_y; }
+  if (offset.y > 0) { offset.y = 0; }
+  scroll_layer->content.frame.origin = offset;
+  dirty = true;
+  if (scroll_layer->callbacks.content_offset_changed_handler) {
+    scroll_layer->callbacks.content_offset_changed_handler(scroll_layer, scroll_layer->context);
+  }
+}
+
+static void scroll_click_handler(ClickRecognizerRef recognizer, void *context) {
+  ScrollLayer *scroll_layer = context;
+  GPoint offset = scroll_layer->content.frame.origin;
+  offset.y += (click_recognizer_get_button_id(recognizer) == BUTTON_ID_UP) ? SIM_SCROLL_STEP : -SIM_SCROLL_STEP;
+  scroll_layer_set_content_offset(scroll_layer, offset, true);
+}
+//----- End scroll layer
+
+//----- Begin menu layer
+static uint16_t menu_num_sections(MenuLayer *menu_layer) {
+  return menu_layer->callbacks.get_num_sections ?
+         menu_layer->callbacks.get_num_sections(menu_layer, menu_layer->context) : 1;
+}
+
+static uint16_t menu_num_rows(MenuLayer *menu_layer, uint16_t section) {
+  return menu_layer->callbacks.get_num_rows(menu_layer, section, menu_layer->context);
+}
+
+static int16_t menu_cell_height(MenuLayer *menu_layer, MenuIndex *index) {
+  return menu_layer->callbacks.get_cell_height ?
+         menu_layer->callbacks.get_cell_height(menu_layer, index, menu_layer->context) : 44;
+}
+
+static int16_t menu_header_height(MenuLayer *menu_layer, uint16_t section) {
+  return menu_layer->callbacks.get_header_height ?
+         menu_layer->callbacks.get_header_height(menu_layer, section, menu_layer->context) : 0;
+}
+
+// Draw the rows that fit on screen from the selected one down, like a menu scrolled to it
+static void menu_layer_draw(MenuLayer *menu_layer) {
+  Layer cell;
+  int16_t y = 0;
+  int16_t height = menu_layer->layer.frame.size.h;
+  MenuIndex index = menu_layer->selected;
+
+  for (uint16_t section=index.section; section<menu_num_sections(menu_layer) && y<height; section++) {
+    uint16_t first_row = (section == index.section) ? index.row : 0;
+    int16_t header_height = menu_header_height(menu_layer, section);
+    if (first_row == 0 && header_height > 0 && menu_layer->callbacks.draw_header) {
+      layer_init(&cell, GRect(0, y, menu_layer->layer.frame.size.w, header_height), SIM_LAYER_PLAIN);
+      menu_layer->callbacks.draw_header(&context, &cell, section, menu_layer->context);
+      y += header_height;
+    }
+    for (uint16_t row=first_row; row<menu_num_rows(menu_layer, section) && y<height; row++) {
+      MenuIndex cell_index = MenuIndex(section, row);
+      int16_t cell_height = menu_cell_height(menu_layer, &cell_index);
+      layer_init(&cell, GRect(0, y, menu_layer->layer.frame.size.w, cell_height), SIM_LAYER_PLAIN);
+      menu_layer->callbacks.draw_row(&context, &cell, &cell_index, menu_layer->context);
+      y += cell_height;
+    }
+  }
+}
+
+MenuLayer *menu_layer_create(GRect frame) {
+  MenuLayer *menu_layer = calloc(1, sizeof(MenuLayer));
+  layer_init(&menu_layer->layer, frame, SIM_LAYER_MENU);
+  return menu_layer;
+}
+
+void menu_layer_destroy(MenuLayer *menu_layer) {
+  if (!menu_layer) { return; }
+  layer_remove_from_parent(&menu_layer->layer);
+  free(menu_layer);
+}
+
+Layer *menu_layer_get_layer(const MenuLayer *menu_layer) {
+  return (Layer *)&menu_layer->layer;
+}
+
+void menu_layer_set_callbacks(MenuLayer *menu_layer, void *callback_context, MenuLayerCallbacks callbacks) {
+  menu_layer->callbacks = callbacks;
+  menu_layer->context = callback_context;
+}
+
+void menu_layer_set_click_config_onto_window(MenuLayer *menu_layer, Window *window) {
+  window->menu_layer = menu_layer;
+}
+
+MenuIndex menu_layer_get_selected_index(const MenuLayer *menu_layer) {
+  return menu_layer->selected;
+}
+
+void menu_layer_set_selected_index(MenuLayer *menu_layer, MenuIndex index, MenuRowAlign scroll_align, bool animated) {
+  MenuIndex old_index = menu_layer->selected;
+  if (index.section >= menu_num_sections(menu_layer)) { return; }
+  if (index.row >= menu_num_rows(menu_layer, index.section)) { return; }
+  menu_layer->selected = index;
+  dirty = true;
+  if (menu_layer->callbacks.selection_changed &&
+      (old_index.section != index.section || old_index.row != index.row)) {
+    menu_layer->callbacks.selection_changed(menu_layer, index, old_index, menu_layer->context);
+  }
+}
+
+// Step to the previous or next row, crossing into neighbouring non-empty sections
+void menu_layer_set_selected_next(MenuLayer *menu_layer, bool up, MenuRowAlign scroll_align, bool animated) {
+  MenuIndex index = menu_layer->selected;
+  if (up) {
+    if (index.row > 0) {
+      index.row--;
+    } else {
+      while (index.section > 0) {
+        uint16_t rows = menu_num_rows(menu_layer, --index.section);
+        if (rows > 0) { index.row = rows-1; break; }
+      }
+    }
+  } else {
+    if (index.row+1 < menu_num_rows(menu_layer, index.section)) {
+      index.row++;
+    } else {
+      for (uint16_t section=index.section+1; section<menu_num_sections(menu_layer); section++) {
+        if (menu_num_rows(menu_layer, section) > 0) { index = MenuIndex(section, 0); break; }
+      }
+    }
+  }
+  menu_layer_set_selected_index(menu_layer, index, scroll_align, animated);
+}
+
+void menu_layer_reload_data(MenuLayer *menu_layer) {
+  uint16_t sections = menu_num_sections(menu_layer);
+  if (menu_layer->selected.section >= sections) {
+    menu_layer->selected = MenuIndex(sections ? sections-1 : 0, 0);
+  }
+  if (sections > 0) {
+    uint16_t rows = menu_num_rows(menu_layer, menu_layer->selected.section);
+    if (menu_layer->selected.row >= rows) { menu_layer->selected.row = rows ? rows-1 : 0; }
+  }
+  dirty = true;
+}
+
+void menu_cell_basic_draw(GContext *ctx, const Layer *cell_layer, const char *title, const char *subtitle, GBitmap *icon) {
+  if (title)    { graphics_draw_text(ctx, title, NULL, cell_layer->bounds, 0, 0, NULL); }
+  if (subtitle) { graphics_draw_text(ctx, subtitle, NULL, cell_layer->bounds, 0, 0, NULL); }
+  if (icon)     { graphics_draw_bitmap_in_rect(ctx, icon, cell_layer->bounds); }
+}
+
+void menu_cell_title_draw(GContext *ctx, const Layer *cell_layer, const char *title) {
+  graphics_draw_text(ctx, title, NULL, cell_layer->bounds, 0, 0, NULL);
+}
+
+void menu_cell_basic_header_draw(GContext *ctx, const Layer *cell_layer, const char *title) {
+  graphics_draw_text(ctx, title, NULL, cell_layer->bounds, 0, 0, NULL);
+}
+
+static void menu_click_handler(ClickRecognizerRef recognizer, void *context) {
+  MenuLayer *menu_layer = context;
+  switch (click_recognizer_get_button_id(recognizer)) {
+    case BUTTON_ID_UP:
+    case BUTTON_ID_DOWN:
+      menu_layer_set_selected_next(menu_layer, click_recognizer_get_button_id(recognizer) == BUTTON_ID_UP,
+                                   MenuRowAlignCenter, true);
+      break;
+    case BUTTON_ID_SELECT:
+      if (menu_layer->callbacks.select_click) {
+        menu_layer->callbacks.select_click(menu_layer, &menu_layer->selected, menu_layer->context);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static void menu_long_click_handler(ClickRecognizerRef recognizer, void *context) {
+  MenuLayer *menu_layer = context;
+  if (menu_layer->callbacks.select_long_click) {
+    menu_layer->callbacks.select_long_click(menu_layer, &menu_layer->selected, menu_layer->context);
+  } else if (menu_layer->callbacks.select_click) {
+    menu_layer->callbacks.select_click(menu_layer, &menu_layer->selected, menu_layer->context);
+  }
+}
+//----- End menu layer
+
+//----- Begin windows
+Window *window_create(void) {
+  Window *window = calloc(1, sizeof(Window));
+  layer_init(&window->root, GRect(0, 0, SIM_SCREEN_W, SIM_SCREEN_H-SIM_STATUS_BAR_H), SIM_LAYER_PLAIN);
+  window->root.window = window;
+  window->background_color = GColorWhite;
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (!window) { return; }
+  window_stack_remove(window, false);
+  free(window);
+}
+
+Layer *window_get_root_layer(const Window *window)                   { return (Layer *)&window->root; }
+void window_set_window_handlers(Window *window, WindowHandlers handlers) { window->handlers = handlers; }
+void window_set_background_color(Window *window, GColor background_color) { window->background_color = background_color; }
+bool window_is_loaded(Window *window)                                { return window->loaded; }
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider) {
+  window->click_config_provider = click_config_provider;
+  window->click_config_has_context = false;
+}
+
+void window_set_click_config_provider_with_context(Window *window, ClickConfigProvider click_config_provider, void *context) {
+  window->click_config_provider = click_config_provider;
+  window->click_config_context = context;
+  window->click_config_has_context = true;
+}
+
+void window_set_fullscreen(Window *window, bool enabled) {
+  window->fullscreen = enabled;
+  window->root.frame.size.h = enabled ? SIM_SCREEN_H : SIM_SCREEN_H-SIM_STATUS_BAR_H;
+  window->root.bounds.size.h = window->root.frame.size.h;
+}
+
+Window *window_stack_get_top_window(void) {
+  return (window_stack_size > 0) ? window_stack[window_stack_size-1] : NULL;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  Window *prev = window_stack_get_top_window();
+  if (window_stack_size >= SIM_MAX_WINDOWS) {
+    fprintf(stderr, "sim: window stack overflow\n");
+    abort();
+  }
+  if (prev && prev->handlers.disappear) { prev->handlers.disappear(prev); }
+  window_stack[window_stack_size++] = window;
+  sim_trace_printf("window push (%u on stack)", window_stack_size);
+  if (!window->loaded) {
+    window->loaded = true;
+    if (window->handlers.load) { window->handlers.load(window); }
+  }
+  if (window->handlers.appear) { window->handlers.appear(window); }
+  window_configure_clicks(window);
+  dirty = true;
+}
+
+// Take a window off the stack, unloading it like the firmware does
+static void window_stack_take(uint8_t i) {
+  Window *window = window_stack[i];
+  bool was_top = (i == window_stack_size-1);
+
+  if (was_top && window->handlers.disappear) { window->handlers.disappear(window); }
+  memmove(&window_stack[i], &window_stack[i+1], (window_stack_size-i-1)*sizeof(Window *));
+  window_stack_size--;
+  sim_trace_printf("window pop (%u on stack)", window_stack_size);
+  if (window->loaded) {
+    window->loaded = false;
+    if (window->handlers.unload) { window->handlers.unload(window); }
+  }
+  Window *top = window_stack_get_top_window();
+  if (was_top && top) {
+    if (top->handlers.appear) { top->handlers.appear(top); }
+    window_configure_clicks(top);
+  }
+  dirty = true;
+}
+
+Window *window_stack_pop(bool animated) {
+  Window *top = window_stack_get_top_window();
+  if (top) { window_stack_take(window_stack_size-1); }
+  return top;
+}
+
+bool window_stack_remove(Window *window, bool animated) {
+  for (uint8_t i=0; i<window_stack_size; i++) {
+    if (window_stack[i] == window) {
+      window_stack_take(i);
+      return true;
+    }
+  }
+  return false;
+}
+//----- End windows
+
+//----- Begin vibes, light and services
+void vibes_short_pulse(void)  { ui_stats.vibes++; sim_trace_printf("vibe short"); }
+void vibes_long_pulse(void)   { ui_stats.vibes++; sim_trace_printf("vibe long"); }
+void vibes_double_pulse(void) { ui_stats.vibes++; sim_trace_printf("vibe double"); }
+void vibes_cancel(void)       {}
+void light_enable_interaction(void) { sim_trace_printf("light"); }
+void light_enable(bool enable)      { sim_trace_printf("light %s", enable ? "on" : "off"); }
+
+void accel_tap_service_subscribe(AccelTapHandler handler) { accel_tap_handler = handler; }
+void accel_tap_service_unsubscribe(void)                  { accel_tap_handler = NULL; }
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) { tick_handler = handler; }
+void tick_timer_service_unsubscribe(void)                 { tick_handler = NULL; }
+bool bluetooth_connection_service_peek(void)              { return true; }
+
+void app_event_loop(void) {
+  if (event_loop) { event_loop(); }
+}
+//----- End vibes, light and services
+
+//----- Begin driver API
+void sim_set_event_loop(SimEventLoop loop) {
+  event_loop = loop;
+}
+
+void sim_set_trace(bool enable) {
+  trace = enable;
+}
+
+void sim_set_record(FILE *file) {
+  record = file;
+}
+
+// Draw the top window if anything changed since the last frame
+void sim_ui_flush(void) {
+  Window *top = window_stack_get_top_window();
+  if (!dirty || !top) { return; }
+  dirty = false;
+  ui_stats.renders++;
+  frame_text_len = 0;
+  layer_draw(&top->root);
+}
+
+// Whether one graphics_draw_text() call of the last frame drew exactly text
+bool sim_ui_drawn(const char *text) {
+  for (uint16_t i=0; i<frame_text_len; i+=strlen(&frame_text[i])+1) {
+    if (strcmp(&frame_text[i], text) == 0) { return true; }
+  }
+  return false;
+}
+
+// Press, hold and release a button, running the clock for hold_ms meanwhile.
+// Single clicks fire on release when a long click is also subscribed, else on press
+void sim_press(ButtonId button_id, uint32_t hold_ms) {
+  Window *window = window_stack_get_top_window();
+  SimClickRecognizer recognizer = {.button_id=button_id};
+  bool long_fired = false;
+
+  if (!window) { return; }
+  ClickConfig c = window->clicks[button_id];
+  sim_trace_printf("press %s %u ms",
+               (const char *[]){"back", "up", "select", "down"}[button_id], hold_ms);
+
+  // Back pops the window unless the app takes it over
+  if (button_id == BUTTON_ID_BACK && !c.single && !c.long_down && !c.raw_down) {
+    sim_advance_ms(hold_ms);
+    window_stack_pop(true);
+    sim_ui_flush();
+    return;
+  }
+
+  if (c.raw_down) { c.raw_down(&recognizer, c.raw_context ? c.raw_context : c.context); sim_ui_flush(); }
+  if (c.single && !c.long_down) { c.single(&recognizer, c.context); sim_ui_flush(); }
+  if (c.long_down && hold_ms >= c.long_delay_ms) {
+    sim_advance_ms(c.long_delay_ms);
+    c.long_down(&recognizer, c.context);
+    sim_ui_flush();
+    long_fired = true;
+    sim_advance_ms(hold_ms - c.long_delay_ms);
+  } else if (c.single && c.repeat_ms && !c.long_down && hold_ms > SIM_REPEAT_DELAY_MS) {
+    sim_advance_ms(SIM_REPEAT_DELAY_MS);
+    for (uint32_t t=SIM_REPEAT_DELAY_MS; t+c.repeat_ms <= hold_ms; t+=c.repeat_ms) {
+      c.single(&recognizer, c.context);
+      sim_ui_flush();
+      sim_advance_ms(c.repeat_ms);
+    }
+  } else {
+    sim_advance_ms(hold_ms);
+  }
+  if (long_fired && c.long_up) { c.long_up(&recognizer, c.context); }
+  if (!long_fired && c.single && c.long_down) { c.single(&recognizer, c.context); }
+  if (c.raw_up) { c.raw_up(&recognizer, c.raw_context ? c.raw_context : c.context); }
+  sim_ui_flush();
+}
+
+void sim_tap(AccelAxisType axis, int32_t direction) {
+  sim_trace_printf("tap axis %d direction %d", axis, direction);
+  if (accel_tap_handler) { accel_tap_handler(axis, direction); }
+  sim_ui_flush();
+}
+
+uint8_t sim_window_stack_size(void) {
+  return window_stack_size;
+}
+
+SimUiStats sim_ui_get_stats(void) {
+  return ui_stats;
+}
+//----- End driver API
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "pebble.h"
+#include "sim.h"
+#include "session_store.h"
+#include "export.h"
+#include "sync.h"
+#include "energy.h"
+#include "summary.h"
+#include "ghost.h"
+#include "training.h"
+
+int32_t   split_cs[NUM_LAP_MEMORY+1];
+Session_t session[NUM_LAP_MEMORY];
+time_t    save_time[NUM_LAP_MEMORY];
+uint8_t   session_index;
+bool      invert_color;
+
+int32_t get_lap_cs(Session_t s, uint8_t abs_lap_index) {
+  if (s.start_index == abs_lap_index) { return split_cs[abs_lap_index]; }
+  return split_cs[abs_lap_index] - split_cs[abs_lap_index-1];
+}
+
+SWTime get_lap_time(Session_t s, uint8_t abs_lap_index) {
+  return SWTime_from_centisecond(get_lap_cs(s, abs_lap_index));
+}
+
+// Same as stopwatch.c, except that a full memory refuses the session rather
+// than evicting, so the tools can fill it
+bool commit_session(const SWTime *splits, uint8_t num_splits) {
+  Session_t current = session[session_index];
+  if ((num_splits == 0) ||
+      (current.end_index + num_splits >= NUM_LAP_MEMORY) ||
+      (session_index >= NUM_LAP_MEMORY-1)) {
+    return false;
+  }
+  for (int i=current.end_index; i>=current.start_index; i--)
+    split_cs[i+num_splits] = split_cs[i];
+  for (int i=0; i<num_splits; i++)
+    split_cs[current.start_index+i] = SWTime_to_centisecond(splits[i]);
+
+  session[session_index].end_index = current.start_index + num_splits - 1;
+  save_time[session_index] = SIM_EPOCH_S + session_index*3600;
+  sync_session_created(session_index);
+  energy_session_inserted(session_index);
+  summary_session_saved(session_index);
+  training_session_saved(save_time[session_index], &summary_get(session_index)->summary);
+
+  session_index++;
+  session[session_index].start_index = current.start_index + num_splits;
+  session[session_index].end_index   = current.end_index + num_splits;
+  return true;
+}
+
+// Same as stopwatch.c
+void delete_session(uint8_t index) {
+  int shift_down = session[index].end_index - session[index].start_index + 1;
+
+  export_cancel();
+  sync_session_deleted(index);
+  energy_session_deleted(index);
+  training_session_deleted(save_time[index], &summary_get(index)->summary);
+  summary_session_deleted(index);
+  ghost_session_deleted(index);
+  for (uint16_t i=index+1; i<=session_index; i++) {
+    for (int src_index=session[i].start_index; src_index<=session[i].end_index; src_index++) {
+      split_cs[src_index - shift_down] = split_cs[src_index];
+    }
+    session[i-1].start_index = session[i].start_index - shift_down;
+    session[i-1].end_index   = session[i].end_index   - shift_down;
+    save_time[i-1] = save_time[i];
+  }
+  session_index--;
+}
+
+// Record and save one interval session with random laps; false if memory is full
+bool session_store_add(void) {
+  SWTime splits[12];
+  uint8_t num_laps = 1 + rand() % 12;
+  int32_t base = 6000 + rand() % 30000;
+  int32_t split = 0;
+
+  for (uint8_t i=0; i<num_laps; i++) {
+    split += base + (rand() % 1001) - 500;
+    splits[i] = SWTime_from_centisecond(split);
+  }
+  return commit_session(splits, num_laps);
+}
+
+// Fill the session memory with a realistic stretch of interval training, leaving lap_room laps free
+void session_store_fill(uint32_t seed, uint8_t lap_room) {
+  srand(seed);
+  session_index = 0;
+  session[0].start_index = session[0].end_index = 0;
+  split_cs[0] = 0;
+  while (session[session_index].start_index + lap_room < NUM_LAP_MEMORY && session_store_add()) {}
+}
\ No newline at end of file
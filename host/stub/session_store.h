@@ -0,0 +1,11 @@
+#ifndef SESSION_STORE_H
+#define SESSION_STORE_H
+#include "stopwatch.h"
+
+// Stand-in for the session memory normally owned by stopwatch.c, for host
+// tools that do not build the stopwatch window
+
+extern bool session_store_add(void);
+extern void session_store_fill(uint32_t, uint8_t);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,210 @@
+// Stand-in phone receiver for live lap telemetry
+//
+// Races a field of lanes through lanes.c, so every lap and save goes through
+// telemetry.c and the simulated AppMessage link, and measures the end-to-end
+// latency of each event from the button press to the phone. With -x a full
+// export runs back to back the whole time, to show telemetry cutting in; with
+// -d the phone drops out of range mid-race, so the queue fills and merges. With
+// -r each athlete runs that many sessions back to back, saving in between, so
+// a full queue holds laps of one lane from both sides of a save.
+//
+//   telemetry_receiver [-n lanes] [-k laps] [-r rounds] [-x] [-d outage_ms] [-l transport_loss_permille] [-a app_loss_permille] [-s seed] [-v]
+#include <getopt.h>
+#include "pebble.h"
+#include "sim.h"
+#include "comm.h"
+#include "export.h"
+#include "sync.h"
+#include "lanes.h"
+#include "telemetry.h"
+#include "session_store.h"
+
+#define LAP_BASE_MS    30000
+#define LAP_SPREAD_MS  4000
+#define MAX_ROUNDS     4
+#define MAX_EVENTS     (NUM_LANES*LANE_MAX_LAPS*MAX_ROUNDS)
+
+static uint8_t num_lanes = 8;
+static uint8_t num_laps = 6;
+static uint8_t num_rounds = 1;
+static bool busy_link;
+static uint32_t outage_ms;
+static SimLink link_config;
+static bool verbose;
+
+//----- Begin race driver
+static uint8_t laps_done[NUM_LANES];
+static uint8_t rounds_done[NUM_LANES];
+static int32_t lane_split_cs[NUM_LANES][MAX_ROUNDS][LANE_MAX_LAPS];
+static uint16_t laps_pushed;
+static uint16_t saves_pushed;
+static bool race_over;
+
+static void lap_timer_callback(void *data) {
+  uint8_t i = (uint8_t)(uintptr_t)data;
+
+  if (laps_done[i] < num_laps-1) {
+    lanes_lap(i);
+    lane_split_cs[i][rounds_done[i]][laps_done[i]++] = SWTime_to_centisecond(lanes_get(i)->split[lanes_get(i)->num_splits-1]);
+    laps_pushed++;
+    app_timer_register(LAP_BASE_MS + rand() % LAP_SPREAD_MS, lap_timer_callback, data);
+    return;
+  }
+  // Final lap: stop and save, which pushes the save event
+  lanes_stop(i);
+  lane_split_cs[i][rounds_done[i]][laps_done[i]++] = SWTime_to_centisecond(lanes_elapsed(i));
+  if (lanes_save(i)) { saves_pushed++; }
+
+  // Straight on to the next session
+  if (++rounds_done[i] < num_rounds) {
+    laps_done[i] = 0;
+    lanes_start(i);
+    app_timer_register(LAP_BASE_MS + rand() % LAP_SPREAD_MS, lap_timer_callback, data);
+  }
+}
+
+// Phone out of range: every message is lost until the outage ends
+static void outage_timer_callback(void *data) {
+  SimLink config = link_config;
+  if (data) {
+    config.transport_loss_permille = 1000;
+    app_timer_register(outage_ms, outage_timer_callback, NULL);
+  }
+  sim_link_configure(config);
+}
+
+// Keep an export going until the race is over
+static void export_timer_callback(void *data) {
+  if (race_over) { return; }
+  if (export_get_state() != EXPORT_STATE_SEND && export_get_state() != EXPORT_STATE_END) { export_start(0); }
+  app_timer_register(500, export_timer_callback, NULL);
+}
+//----- End race driver
+
+//----- Begin stand-in phone
+static bool seen[0x10000];
+static uint32_t latency_ms[MAX_EVENTS*2];
+static uint16_t num_latencies;
+static uint16_t laps_covered[NUM_LANES];
+static uint8_t lane_round[NUM_LANES];   // Saves of the lane received so far
+static uint16_t saves_received;
+static uint16_t split_mismatches;
+static uint16_t duplicates;
+static uint32_t telemetry_messages;
+
+static void phone_handler(DictionaryIterator *iter) {
+  Tuple *data = dict_find(iter, MSG_KEY_TELEMETRY);
+  uint32_t now = (uint32_t)(SIM_EPOCH_S*1000ULL + sim_now_ms());
+
+  if (!data) { return; }
+  telemetry_messages++;
+  for (uint16_t pos=0; pos+sizeof(TelemetryEvent) <= data->length; pos+=sizeof(TelemetryEvent)) {
+    const uint8_t *bytes = data->value->data;
+    TelemetryEvent e;
+    memcpy(&e, bytes+pos, sizeof(e));
+    if (seen[e.seq]) { duplicates++; continue; }
+    seen[e.seq] = true;
+    latency_ms[num_latencies++] = now - e.stamp_ms;
+
+    // A lane's events arrive in order, so its saves so far tell the session.
+    // A lap never covers more laps than its session had by then
+    int32_t *split_cs = lane_split_cs[e.lane][lane_round[e.lane]];
+    if (e.kind == TELEMETRY_KIND_LAP) {
+      laps_covered[e.lane] += e.laps_covered;
+      if (split_cs[e.lap] != e.split_cs || e.laps_covered > e.lap+1) { split_mismatches++; }
+    } else {
+      saves_received++;
+      lane_round[e.lane]++;
+      if (split_cs[e.lap-1] != e.split_cs) { split_mismatches++; }
+    }
+    if (verbose) {
+      printf("[%6llu] lane %u %s %u split %d covered %u latency %u ms\n", (unsigned long long)sim_now_ms(),
+             e.lane, (e.kind == TELEMETRY_KIND_LAP) ? "lap" : "save", e.lap, e.split_cs, e.laps_covered, now - e.stamp_ms);
+    }
+  }
+}
+//----- End stand-in phone
+
+static int compare_uint32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static uint32_t percentile(uint8_t p) {
+  return (num_latencies == 0) ? 0 : latency_ms[(num_latencies-1) * p / 100];
+}
+
+int main(int argc, char **argv) {
+  SimLink config = {.latency_ms={200, 25}, .send_timeout_ms=1000, .seed=1};
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:k:r:xd:l:a:s:v")) != -1) {
+    switch (opt) {
+      case 'n': num_lanes = atoi(optarg); break;
+      case 'k': num_laps = atoi(optarg); break;
+      case 'r': num_rounds = atoi(optarg); break;
+      case 'x': busy_link = true; break;
+      case 'd': outage_ms = atoi(optarg); break;
+      case 'l': config.transport_loss_permille = atoi(optarg); break;
+      case 'a': config.app_loss_permille = atoi(optarg); break;
+      case 's': config.seed = atoi(optarg); break;
+      case 'v': verbose = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-n lanes] [-k laps] [-r rounds] [-x] [-d outage_ms] [-l transport_loss_permille] [-a app_loss_permille] [-s seed] [-v]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (num_lanes < MIN_LANES || num_lanes > NUM_LANES || num_laps < 1 || num_laps > LANE_MAX_LAPS ||
+      num_rounds < 1 || num_rounds > MAX_ROUNDS) {
+    fprintf(stderr, "lanes must be %d..%d, laps 1..%d and rounds 1..%d\n", MIN_LANES, NUM_LANES, LANE_MAX_LAPS, MAX_ROUNDS);
+    return 2;
+  }
+
+  // Old sessions for the export to chew on, with room for the race
+  session_store_fill(config.seed, num_lanes*num_laps*num_rounds);
+  link_config = config;
+  sim_link_configure(config);
+  sim_phone_set_handler(phone_handler);
+  sync_init();
+  comm_init();
+  export_init();
+  telemetry_init();
+  lanes_init();
+  lanes_set_count(num_lanes);
+
+  // Mass start, then every athlete runs their own pace
+  lanes_start_all();
+  for (uint8_t i=0; i<num_lanes; i++) {
+    app_timer_register(LAP_BASE_MS + rand() % LAP_SPREAD_MS, lap_timer_callback, (void *)(uintptr_t)i);
+  }
+  if (busy_link) { export_timer_callback(NULL); }
+  if (outage_ms) { app_timer_register(LAP_BASE_MS/2, outage_timer_callback, (void *)1); }
+  sim_run_until_idle((uint64_t)num_rounds * num_laps * (LAP_BASE_MS+LAP_SPREAD_MS) + 1000);
+  race_over = true;
+  sim_run_until_idle(10*60*1000);
+
+  // Every lap must reach the phone, either itself or folded into a later lap of the lane
+  uint16_t covered = 0;
+  for (uint8_t i=0; i<num_lanes; i++) { covered += laps_covered[i]; }
+  bool ok = (covered + telemetry_get_dropped() == laps_pushed) &&
+            (saves_received == saves_pushed) &&
+            (split_mismatches == 0) &&
+            (telemetry_get_queued() == 0);
+
+  SimLinkStats stats = sim_link_get_stats();
+  qsort(latency_ms, num_latencies, sizeof(latency_ms[0]), compare_uint32);
+  printf("lanes=%u laps=%u saves=%u rounds=%u busy_link=%s outage_ms=%u\n", num_lanes, laps_pushed, saves_pushed, num_rounds, busy_link ? "yes" : "no", outage_ms);
+  printf("events delivered=%u duplicates=%u merged=%u dropped=%u messages=%u\n",
+         num_latencies, duplicates, telemetry_get_merged(), telemetry_get_dropped(), telemetry_messages);
+  printf("latency_ms p50=%u p95=%u p99=%u max=%u\n", percentile(50), percentile(95), percentile(99), percentile(100));
+  printf("link to_phone messages=%u transport_failures=%u app_drops=%u reduced_sniff_ms=%llu\n",
+         stats.messages_to_phone, stats.transport_failures, stats.app_drops, (unsigned long long)stats.reduced_sniff_ms);
+  printf("verify=%s\n", ok ? "ok" : "FAILED");
+
+  lanes_deinit();
+  telemetry_deinit();
+  export_deinit();
+  comm_deinit();
+  sync_deinit();
+  return ok ? 0 : 1;
+}
\ No newline at end of file
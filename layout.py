@@ -0,0 +1,156 @@
+#
+# Screen layout tables, generated at build time from layout.json
+#
+# Layout is described once, on the 144x168 design grid the app was drawn for,
+# and turned into const GRect tables for one platform. Larger screens get the
+# design centered; on round screens the rects reaching past the edge are
+# counted and reported, as those screens need a layout of their own.
+#
+#   python layout.py layout.json <platform> layout.auto.h
+#
+
+from __future__ import print_function
+
+import json
+import sys
+
+
+def load(json_path):
+    with open(json_path) as f:
+        return json.load(f)
+
+
+def place(rect, offset):
+    x, y, w, h = rect
+    return [x + offset[0], y + offset[1], w, h]
+
+
+def face_tables(face, fonts):
+    """Digit frames and font indexes for the main face, cells on a common bottom line"""
+    row_height = max(fonts[name]['height'] for name in face['cells'])
+    font_names = []
+    digits = []
+    digit_fonts = []
+    for row in range(face['rows']):
+        names = list(face['cells'])
+        for override in face.get('overrides', []):
+            if override['row'] == row:
+                names[override['cell']] = override['font']
+        x = 0
+        frames = []
+        indexes = []
+        for name in names:
+            font = fonts[name]
+            y = face['top'] + face['row_height']*row + row_height - font['height']
+            frames.append([x, y, font['width'], font['height']])
+            x += font['width']
+            if font['key'] not in font_names:
+                font_names.append(font['key'])
+            indexes.append(font_names.index(font['key']))
+        digits.append(frames)
+        digit_fonts.append(indexes)
+    label_x, label_y, label_w, label_h = face['label']
+    labels = [[label_x, label_y + face['row_height']*row, label_w, label_h] for row in range(face['rows'])]
+    return font_names, digits, digit_fonts, labels, face['guides']
+
+
+def entry_tables(entry, top):
+    """Digit and delimiter frames of a time entry row, and the focus boxes under its digits"""
+    cells = [[x, top, w, entry['height']] for x, w in entry['cells']]
+    focus = [[x, top + entry['focus_top'], w, entry['focus_height']] for x, w in entry['focus']]
+    return cells, focus
+
+
+def c_rect(rect):
+    return '{{%d, %d}, {%d, %d}}' % tuple(rect)
+
+
+def c_rects(rects, indent):
+    return ('{\n' + ',\n'.join(indent + '  ' + c_rect(r) for r in rects) + '\n' + indent + '}')
+
+
+def inside_round(rect, width, height):
+    cx, cy, r = width/2.0, height/2.0, min(width, height)/2.0
+    x, y, w, h = rect
+    corners = [(x, y), (x + w, y), (x, y + h), (x + w, y + h)]
+    return all((px - cx)**2 + (py - cy)**2 <= r*r for px, py in corners)
+
+
+def generate(json_path, platform, out_path):
+    layout = load(json_path)
+    if platform not in layout['platforms']:
+        raise ValueError('layout.json has no platform %s' % platform)
+    screen = layout['platforms'][platform]
+    design = layout['design']
+    offset = ((screen['width'] - design['width'])//2, (screen['height'] - design['height'])//2)
+
+    font_names, digits, digit_fonts, labels, guides = face_tables(layout['face'], layout['fonts'])
+    timer = layout['timer_config']
+    timer_entry, timer_focus = entry_tables(layout['time_entry'], timer['entry_top'])
+    preset = layout['preset_assistant']
+    preset_entry, preset_focus = entry_tables(layout['time_entry'], preset['entry_top'])
+    preset_focus += preset['focus']
+
+    digits = [[place(r, offset) for r in row] for row in digits]
+    tables = [
+        ('layout_face_label', [place(r, offset) for r in labels]),
+        ('layout_face_guide', [place(r, offset) for r in guides]),
+        ('layout_timer_config_entry', [place(r, offset) for r in timer_entry]),
+        ('layout_timer_config_focus', [place(r, offset) for r in timer_focus]),
+        ('layout_preset_entry', [place(r, offset) for r in preset_entry]),
+        ('layout_preset_focus', [place(r, offset) for r in preset_focus]),
+    ]
+    rects = [
+        ('layout_timer_config_header', place(timer['header'], offset)),
+        ('layout_preset_header', place(preset['header'], offset)),
+        ('layout_preset_segments', place(preset['segments'], offset)),
+        ('layout_preset_segments_footer', place(preset['segments_footer'], offset)),
+        ('layout_preset_step', place(preset['step'], offset)),
+        ('layout_preset_step_footer', place(preset['step_footer'], offset)),
+    ]
+
+    lines = [
+        '// Generated from layout.json by layout.py for %s. Do not edit' % platform,
+        '#ifndef LAYOUT_AUTO_H',
+        '#define LAYOUT_AUTO_H',
+        '#include "pebble.h"',
+        '',
+        '#define LAYOUT_PLATFORM "%s"' % platform,
+        '#define LAYOUT_SCREEN_W %d' % screen['width'],
+        '#define LAYOUT_SCREEN_H %d' % screen['height'],
+        '#define LAYOUT_ROUND    %d' % int(screen['round']),
+        '#define LAYOUT_FACE_FONTS %d' % len(font_names),
+        '',
+        'static const char *const layout_face_font_key[LAYOUT_FACE_FONTS] = {%s};' % ', '.join(font_names),
+        'static const uint8_t layout_face_font[%d][%d] = {%s};' % (
+            len(digit_fonts), len(digit_fonts[0]),
+            ', '.join('{' + ', '.join(str(i) for i in row) + '}' for row in digit_fonts)),
+        'static const GRect layout_face_digit[%d][%d] = {\n%s\n};' % (
+            len(digits), len(digits[0]), ',\n'.join('  ' + c_rects(row, '  ') for row in digits)),
+    ]
+    for name, table in tables:
+        lines.append('static const GRect %s[%d] = %s;' % (name, len(table), c_rects(table, '')))
+    for name, rect in rects:
+        lines.append('static const GRect %s = %s;' % (name, c_rect(rect)))
+    lines += ['', '#endif']
+
+    with open(out_path, 'w') as f:
+        f.write('\n'.join(lines))
+
+    if screen['round']:
+        every = [r for row in digits for r in row] + [r for _, t in tables for r in t] + [r for _, r in rects]
+        clipped = [r for r in every if not inside_round(r, screen['width'], screen['height'])]
+        if clipped:
+            print('layout.py: %s: %d of %d rects reach past the round screen' % (platform, len(clipped), len(every)),
+                  file=sys.stderr)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 4:
+        print('usage: %s layout.json <platform> layout.auto.h' % sys.argv[0], file=sys.stderr)
+        sys.exit(2)
+    try:
+        generate(sys.argv[1], sys.argv[2], sys.argv[3])
+    except (IOError, KeyError, ValueError) as e:
+        print('layout.py: %s' % e, file=sys.stderr)
+        sys.exit(1)
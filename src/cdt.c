@@ -1,81 +1,358 @@
 #include "pebble.h"
 #include "cdt.h"
+#include "energy.h"
+#include "session_codec.h"
+
+#define CDT_LEGACY_LENGTH 50
 
 static cdt_t cdt;
 
-// Set/get lap
-void cdt_set_lap(uint8_t i, SWTime time) {
-  cdt.lap[i] = time;
+// Layout of KEY_CDT_PLAN. Only the used blocks are persisted, so a plan costs
+// the same whatever its length
+typedef struct CDTRecord {
+  SWTime next_split;
+  SWTime display;
+  bool enable;
+  bool repeat;
+  bool overflow;
+  uint16_t length;
+  uint32_t index;
+  uint8_t num_blocks;
+  CDTBlock_t block[CDT_MAX_BLOCKS];
+} __attribute__((__packed__)) CDTRecord_t;
+
+// Layout of KEY_CDT before plans were made of blocks
+typedef struct CDTLegacy {
+  SWTime lap[CDT_LEGACY_LENGTH];
+  SWTime next_split;
+  SWTime display;
+  bool enable;
+  bool repeat;
+  bool overflow;
+  uint8_t length;
+  uint8_t index;
+} __attribute__((__packed__)) CDTLegacy_t;
+
+//----- Begin plan arithmetic
+// Sum of the first k segments of a block, wide enough for a block that would
+// not fit in a plan
+static int64_t block_sum(const CDTBlock_t *b, uint16_t k) {
+  return (int64_t)k*b->first_cs + (int64_t)b->step_cs*k*(k-1)/2;
+}
+
+static int32_t plan_total(void) {
+  int32_t total = 0;
+  for (uint8_t i=0; i<cdt.num_blocks; i++) {
+    total += block_sum(&cdt.block[i], cdt.block[i].count);
+  }
+  return total;
+}
+
+// Add a block at the end of a block list, folding it into the last block when
+// the two make one arithmetic run. False if the list is full.
+static bool blocks_push(CDTBlock_t *blocks, uint8_t *num_blocks, CDTBlock_t b) {
+  if (b.count == 0) { return true; }
+  if (*num_blocks > 0) {
+    CDTBlock_t *last = &blocks[*num_blocks-1];
+    int32_t step = (last->count > 1) ? last->step_cs :
+                   (b.count > 1)     ? b.step_cs : (b.first_cs - last->first_cs);
+    if ((step >= INT16_MIN) && (step <= INT16_MAX) &&
+        (b.count == 1 || b.step_cs == step) &&
+        (b.first_cs == last->first_cs + last->count*step)) {
+      last->step_cs = (int16_t)step;
+      last->count += b.count;
+      return true;
+    }
+  }
+  if (*num_blocks >= CDT_MAX_BLOCKS) { return false; }
+  blocks[(*num_blocks)++] = b;
+  return true;
+}
+//----- End plan arithmetic
+
+// Length of segment i, zero past the end of the plan
+SWTime cdt_get_lap(uint16_t i) {
+  for (uint8_t b=0; b<cdt.num_blocks; b++) {
+    if (i < cdt.block[b].count) {
+      return SWTime_from_centisecond(cdt.block[b].first_cs + i*cdt.block[b].step_cs);
+    }
+    i -= cdt.block[b].count;
+  }
+  return (SWTime){0, 0, 0, 0};
+}
+
+// Target split at the end of segment n-1. Single mode stops at the end of the
+// plan, repeat mode goes round it again.
+static int32_t plan_split(uint32_t n) {
+  int32_t split = 0;
+
+  if (cdt.length == 0) { return 0; }
+  if (!cdt.repeat && n > cdt.length) { n = cdt.length; }
+  if (n >= cdt.length) {
+    split = (int32_t)(n / cdt.length) * plan_total();
+    n %= cdt.length;
+  }
+  for (uint8_t b=0; b<cdt.num_blocks && n>0; b++) {
+    uint16_t k = (n < cdt.block[b].count) ? n : cdt.block[b].count;
+    split += block_sum(&cdt.block[b], k);
+    n -= k;
+  }
+  return split;
 }
 
-SWTime cdt_get_lap(uint8_t i) {
-  return cdt.lap[i];
+SWTime cdt_get_split(uint32_t n) {
+  return SWTime_from_centisecond(plan_split(n));
 }
 
+// Add segments to the end of the plan. False, and the plan is left as it was,
+// if a segment would be negative or the plan too long or too fragmented.
+bool cdt_append_block(CDTBlock_t b) {
+  if (b.count == 0) { return true; }
+  if (b.first_cs < 0 || b.first_cs + (int32_t)(b.count-1)*b.step_cs < 0) { return false; }
+  if (cdt.length + b.count > CDT_MAX_SEGMENTS) { return false; }
+  if ((int64_t)plan_total() + block_sum(&b, b.count) > CDT_MAX_TOTAL_CS) { return false; }
+  if (!blocks_push(cdt.block, &cdt.num_blocks, b)) { return false; }
+  cdt.length += b.count;
+  return true;
+}
+
+// Edit segment i, or add one when i is the plan length. Adding a zero segment
+// does nothing. Editing splits the segment's block in up to three.
+bool cdt_set_lap(uint16_t i, SWTime time) {
+  CDTBlock_t blocks[CDT_MAX_BLOCKS];
+  uint8_t num_blocks = 0;
+  int32_t cs = SWTime_to_centisecond(time);
+  int32_t old_cs = SWTime_to_centisecond(cdt_get_lap(i));
+  bool found = false;
+  bool ok = true;
+
+  if (i > cdt.length) { return false; }
+  if (i == cdt.length) {
+    return (cs == 0) ? true : cdt_append_block((CDTBlock_t){.first_cs=cs, .step_cs=0, .count=1});
+  }
+  if (cs == old_cs) { return true; }
+  if ((int64_t)plan_total() - old_cs + cs > CDT_MAX_TOTAL_CS) { return false; }
+
+  for (uint8_t b=0; b<cdt.num_blocks && ok; b++) {
+    CDTBlock_t block = cdt.block[b];
+    if (found || i >= block.count) {
+      ok = blocks_push(blocks, &num_blocks, block);
+      if (!found) { i -= block.count; }
+      continue;
+    }
+    ok = blocks_push(blocks, &num_blocks, (CDTBlock_t){block.first_cs, block.step_cs, i}) &&
+         blocks_push(blocks, &num_blocks, (CDTBlock_t){cs, 0, 1}) &&
+         blocks_push(blocks, &num_blocks, (CDTBlock_t){block.first_cs + (i+1)*block.step_cs,
+                                                       block.step_cs, block.count-i-1});
+    found = true;
+  }
+  if (!ok) { return false; }
+
+  memcpy(cdt.block, blocks, num_blocks*sizeof(CDTBlock_t));
+  cdt.num_blocks = num_blocks;
+  return true;
+}
+
+//----- Begin coded plans
+// A whole plan as the phone sends it (MSG_KEY_PLAN), with the varints of
+// session_codec.h:
+//   uint8   flags, CDT_CODE_REPEAT
+//   per block: varint count, svarint step_cs, svarint first_cs less where the
+//   block before would have gone on (its first_cs + count*step_cs)
+// so a plan that carries on smoothly from block to block codes small.
+
+// Length of the current plan coded into buf, 0 if it does not fit in cap
+uint16_t cdt_encode(uint8_t *buf, uint16_t cap) {
+  CodecWriter w = {.buf=buf, .cap=cap, .len=0};
+  int32_t next_cs = 0;
+
+  if (cap < 1) { return 0; }
+  buf[w.len++] = cdt.repeat ? CDT_CODE_REPEAT : 0;
+  for (uint8_t b=0; b<cdt.num_blocks; b++) {
+    const CDTBlock_t *block = &cdt.block[b];
+    if (!codec_put_varint(&w, block->count) || !codec_put_svarint(&w, block->step_cs) ||
+        !codec_put_svarint(&w, block->first_cs - next_cs)) {
+      return 0;
+    }
+    next_cs = block->first_cs + block->count*block->step_cs;
+  }
+  return w.len;
+}
+
+// Replace the plan with a coded one and start it from the top, see cdt_resume()
+// for a run under way. False, and the plan is left as it was, if it is
+// malformed or more than the timer can hold.
+bool cdt_decode(const uint8_t *buf, uint16_t len) {
+  CodecReader r = {.buf=buf, .len=len, .pos=1};
+  cdt_t old = cdt;
+  int32_t next_cs = 0;
+
+  if (len < 1) { return false; }
+  cdt_reset_all();
+  while (r.pos < r.len) {
+    uint32_t count;
+    int32_t step_cs, offset_cs;
+    if (!codec_get_varint(&r, &count) || !codec_get_svarint(&r, &step_cs) || !codec_get_svarint(&r, &offset_cs) ||
+        count == 0 || count > CDT_MAX_SEGMENTS || step_cs < INT16_MIN || step_cs > INT16_MAX ||
+        (int64_t)next_cs + offset_cs < 0 || (int64_t)next_cs + offset_cs > CDT_MAX_TOTAL_CS ||
+        !cdt_append_block((CDTBlock_t){.first_cs=next_cs+offset_cs, .step_cs=step_cs, .count=count})) {
+      cdt = old;
+      return false;
+    }
+    next_cs += offset_cs + (int32_t)count*step_cs;
+  }
+  if (cdt.length == 0) {
+    cdt = old;
+    return false;
+  }
+  cdt.repeat = (buf[0] & CDT_CODE_REPEAT) != 0;
+  cdt.enable = true;
+  cdt_reset();
+  return true;
+}
+//----- End coded plans
+
 cdt_t *cdt_get(void) {
   return &cdt;
 }
 
+// Carry an explicit segment array over from before plans were made of blocks
+static void cdt_migrate(void) {
+  CDTLegacy_t legacy;
+
+  persist_read_data(KEY_CDT, &legacy, sizeof(legacy));
+  cdt_reset_all();
+  cdt.next_split = legacy.next_split;
+  cdt.display = legacy.display;
+  cdt.enable = legacy.enable;
+  cdt.repeat = legacy.repeat;
+  cdt.overflow = legacy.overflow;
+  cdt.index = legacy.index;
+  for (uint8_t i=0; i<legacy.length && i<CDT_LEGACY_LENGTH; i++) {
+    if (!cdt_append_block((CDTBlock_t){SWTime_to_centisecond(legacy.lap[i]), 0, 1})) { break; }
+  }
+  persist_delete(KEY_CDT);
+}
+
+static void cdt_read(void) {
+  CDTRecord_t r;
+
+  persist_read_data(KEY_CDT_PLAN, &r, sizeof(r));
+  if (r.num_blocks > CDT_MAX_BLOCKS) {
+    cdt_reset_all();
+    return;
+  }
+  cdt.next_split = r.next_split;
+  cdt.display = r.display;
+  cdt.enable = r.enable;
+  cdt.repeat = r.repeat;
+  cdt.overflow = r.overflow;
+  cdt.length = r.length;
+  cdt.index = r.index;
+  cdt.num_blocks = r.num_blocks;
+  memcpy(cdt.block, r.block, r.num_blocks*sizeof(CDTBlock_t));
+}
+
 void cdt_init(void) {
-  if (persist_exists(KEY_CDT)) {
-    persist_read_data(KEY_CDT, &cdt, sizeof(cdt));
+  if (persist_exists(KEY_CDT_PLAN)) {
+    cdt_read();
+  } else if (persist_exists(KEY_CDT)) {
+    cdt_migrate();
   } else {
     cdt_reset_all();
   }
 }
 
 void cdt_deinit(void) {
-  persist_write_data(KEY_CDT, &cdt, sizeof(cdt));
+  CDTRecord_t r = {.next_split=cdt.next_split, .display=cdt.display,
+                   .enable=cdt.enable, .repeat=cdt.repeat, .overflow=cdt.overflow,
+                   .length=cdt.length, .index=cdt.index, .num_blocks=cdt.num_blocks};
+
+  memcpy(r.block, cdt.block, cdt.num_blocks*sizeof(CDTBlock_t));
+  energy_count(ENERGY_PERSIST_WRITE, 1);
+  persist_write_data(KEY_CDT_PLAN, &r, sizeof(r)-(CDT_MAX_BLOCKS-cdt.num_blocks)*sizeof(CDTBlock_t));
 }
 
 // Call during stopwatch reset or save
 void cdt_reset(void) {
   cdt.index = 0;
-  cdt.next_split = cdt.lap[cdt.index];
+  cdt.next_split = cdt_get_lap(0);
   cdt.overflow = false;
 }
 
 // "Zero" all settings
 void cdt_reset_all(void) {
-  for (int i=0; i < CDT_MAX_LENGTH; i++) {
-    cdt.lap[i] = (SWTime){0, 0, 0, 0};
-  }
+  cdt.num_blocks = 0;
   cdt.next_split = cdt.display = (SWTime){0, 0, 0, 0};
   cdt.enable = cdt.repeat = false;
   cdt.length = cdt.index = 0;
 }
 
+// Move index to the first segment still running at elapsed_cs. Splits only
+// grow with the index, so it is a binary search however far behind the plan is.
+static void cdt_seek(int32_t elapsed_cs) {
+  uint32_t lo = cdt.index+1;
+  uint32_t hi;
+
+  if (!cdt.repeat) {
+    if (lo >= cdt.length || plan_split(cdt.length) < elapsed_cs) {
+      cdt.index = cdt.length;
+      cdt.next_split = cdt_get_split(cdt.length);
+      cdt.overflow = true;
+      return;
+    }
+    hi = cdt.length-1;
+  } else {
+    int32_t total = plan_total();
+    // A plan of zero-length segments never catches up
+    if (total == 0) {
+      cdt.overflow = true;
+      return;
+    }
+    hi = (uint32_t)(elapsed_cs/total + 1) * cdt.length;
+  }
+
+  while (lo < hi) {
+    uint32_t mid = lo + (hi-lo)/2;
+    if (plan_split(mid+1) >= elapsed_cs) {
+      hi = mid;
+    } else {
+      lo = mid+1;
+    }
+  }
+  cdt.index = lo;
+  cdt.next_split = cdt_get_split(lo+1);
+}
+
+// Pick the plan up sw_elapsed into a run, on the segment running then and
+// without the buzz of the segments passed. From the top at 0
+void cdt_resume(SWTime sw_elapsed) {
+  int32_t elapsed_cs = SWTime_to_centisecond(sw_elapsed);
+
+  cdt_reset();
+  if (cdt.length > 0 && SWTime_to_centisecond(cdt.next_split) < elapsed_cs) { cdt_seek(elapsed_cs); }
+}
+
 void cdt_update(SWTime sw_elapsed) {
   // Preclude if disabled
   if (cdt.enable == false) { return; }
-  
-  // Invoke vibration alert
+
+  // Invoke vibration alert, then move on to the segment now running: in single
+  // mode that may be past the end of the plan
   if (SWTime_compare(cdt.next_split, sw_elapsed) == -1 && cdt.overflow == false) {
     // Call buzzer
+    energy_count(ENERGY_VIBE, 1);
     vibes_double_pulse();
+    cdt_seek(SWTime_to_centisecond(sw_elapsed));
   }
 
-  // Increment cdt_index until overflow condition detected (only in single mode)
-  // or cdt.next_split is greater than sw_elapsed
-  while (!cdt.overflow && (SWTime_compare(cdt.next_split, sw_elapsed)==-1)) {
-    cdt.index++;
-    
-    // Exit condition for single mode
-    if (!cdt.repeat && (cdt.index >= cdt.length)) {
-      cdt.overflow = true;
-      break;
-    }
-    
-    cdt.next_split = SWTime_add(cdt.next_split, cdt.lap[cdt.index%cdt.length]);
-  }
-  
   // Calculate displayed timer
   cdt.display = cdt.overflow ?
                 SWTime_subtract(sw_elapsed, cdt.next_split) :
                 SWTime_subtract(cdt.next_split, sw_elapsed);
-  
+
   // Prevent displaying over 9:59:59.99
   if (cdt.display.hour >= 10) {
     cdt.display = (SWTime){.hour=9, .minute=59, .second=59, .centisecond=99};
   }
-}
+}
\ No newline at end of file
@@ -2,29 +2,48 @@
 #define CDT_H
 #include "swtime.h"
 
-#define CDT_MAX_LENGTH 50
-#define KEY_CDT           240
+#define CDT_MAX_BLOCKS    24
+#define CDT_MAX_SEGMENTS  999
+#define CDT_MAX_TOTAL_CS  35640000  // 99:00:00.00
+#define KEY_CDT           240       // Old explicit segment array, migrated on launch
+#define KEY_CDT_PLAN      241
+#define CDT_CODE_REPEAT   0x01      // Flag in the first byte of a coded plan
 
+// A run of count segments, the first one first_cs long and each following one
+// step_cs longer (positive split) or shorter (negative split). An even split is
+// a single block with step_cs 0, and a hand-edited segment is a block of one.
+typedef struct CDTBlock {
+  int32_t first_cs;
+  int16_t step_cs;
+  uint16_t count;
+} CDTBlock_t;
+
+// Naturally aligned for the per-tick paths, widest fields first. The packed
+// form persisted under KEY_CDT_PLAN is kept in cdt.c.
 typedef struct CDT {
-  SWTime lap[CDT_MAX_LENGTH];
-  SWTime next_split;
-  SWTime display;
+  CDTBlock_t block[CDT_MAX_BLOCKS];
+  uint32_t index;      // Current segment, counting on through repeats
+  uint16_t length;     // Segments in the plan
+  uint8_t num_blocks;
   bool enable;
   bool repeat;
   bool overflow;
-  uint8_t length;
-  uint8_t index;
-} __attribute__((__packed__)) cdt_t;
+  SWTime next_split;
+  SWTime display;
+} cdt_t;
 
-extern void cdt_set_lap(uint8_t, SWTime);
-extern SWTime cdt_get_lap(uint8_t);
+extern bool cdt_set_lap(uint16_t, SWTime);
+extern SWTime cdt_get_lap(uint16_t);
+extern SWTime cdt_get_split(uint32_t);
+extern bool cdt_append_block(CDTBlock_t);
+extern uint16_t cdt_encode(uint8_t *, uint16_t);
+extern bool cdt_decode(const uint8_t *, uint16_t);
 extern cdt_t *cdt_get(void);
-extern void cdt_set_length(uint8_t);
-extern uint8_t cdt_get_length(void);
 
 extern void cdt_init(void);
 extern void cdt_deinit(void);
 extern void cdt_update(SWTime);
+extern void cdt_resume(SWTime);
 extern void cdt_reset();
 extern void cdt_reset_all();
 
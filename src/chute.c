@@ -0,0 +1,266 @@
+#include "pebble.h"
+#include "chute.h"
+#include "session_codec.h"
+#include "workq.h"
+#include "energy.h"
+
+static Chute_t chute;
+
+// Presses from ring_tail to ring_head are not stored yet. Both count on and
+// wrap together, CHUTE_RING_SIZE divides the wrap
+static uint32_t ring[CHUTE_RING_SIZE];
+static uint16_t ring_head;
+static uint16_t ring_tail;
+
+// The persisted data key being filled, as last written
+static uint8_t block[PERSIST_DATA_MAX_LENGTH];
+static bool store_posted;
+static AppTimer *flush_timer;
+
+// Data keys past CHUTE_NUM_KEYS, and the finish time and count the chute had
+// reached as it moved on to them
+static uint8_t *ram_key[CHUTE_NUM_RAM_KEYS];
+static uint16_t ram_key_len[CHUTE_NUM_RAM_KEYS];
+static uint16_t ram_base_stored;
+static uint32_t ram_base_ms;
+
+static uint16_t ring_count(void) {
+  return (uint16_t)(ring_head - ring_tail);
+}
+
+// Buffer data key k is built in, allocated as the chute reaches a RAM key.
+// NULL past the last key, or if there is no memory left for it
+static uint8_t *key_buffer(uint8_t k) {
+  if (k < CHUTE_NUM_KEYS) { return block; }
+  if (k >= CHUTE_NUM_BLOCKS) { return NULL; }
+  if (ram_key[k-CHUTE_NUM_KEYS] == NULL) { ram_key[k-CHUTE_NUM_KEYS] = malloc(PERSIST_DATA_MAX_LENGTH); }
+  return ram_key[k-CHUTE_NUM_KEYS];
+}
+
+static void free_ram_keys(void) {
+  for (uint8_t k=0; k<CHUTE_NUM_RAM_KEYS; k++) {
+    free(ram_key[k]);
+    ram_key[k] = NULL;
+    ram_key_len[k] = 0;
+  }
+}
+
+// The state as persisted. The RAM keys do not outlive the app, so their finish
+// times are written as not kept, and a chute relaunched running goes on from
+// the last persisted one
+static void write_state(void) {
+  Chute_t saved = chute;
+
+  if (chute.key >= CHUTE_NUM_KEYS) {
+    saved.num_lost += chute.num_stored - ram_base_stored;
+    saved.num_stored = ram_base_stored;
+    saved.last_stored_ms = ram_base_ms;
+    saved.key = CHUTE_NUM_KEYS;
+    saved.key_len = 0;
+  }
+  persist_write_data(KEY_CHUTE_STATE, &saved, sizeof(saved));
+}
+
+// Gaps from the last stored finisher into the data key being filled, moving on
+// to the next key when it is full. Only the persisted keys that changed are
+// written, the RAM keys are filled in place
+static void store_pending(void) {
+  CodecWriter w = {key_buffer(chute.key), PERSIST_DATA_MAX_LENGTH, chute.key_len};
+  uint8_t writes = 1;
+  bool grown = false;
+
+  while (ring_tail != ring_head) {
+    if (w.buf == NULL) {
+      chute.num_lost += ring_count();
+      ring_tail = ring_head;
+      break;
+    }
+    // A clock set back mid-race stores a zero gap
+    uint32_t t = ring[ring_tail % CHUTE_RING_SIZE];
+    uint32_t gap = (t > chute.last_stored_ms) ? t - chute.last_stored_ms : 0;
+    if (!codec_put_varint(&w, gap)) {
+      if (chute.key < CHUTE_NUM_KEYS) {
+        persist_write_data(KEY_CHUTE_DATA+chute.key, block, w.len);
+        writes++;
+      } else {
+        ram_key_len[chute.key-CHUTE_NUM_KEYS] = w.len;
+      }
+      chute.key++;
+      if (chute.key == CHUTE_NUM_KEYS) {
+        ram_base_stored = chute.num_stored;
+        ram_base_ms = chute.last_stored_ms;
+      }
+      w = (CodecWriter){key_buffer(chute.key), PERSIST_DATA_MAX_LENGTH, 0};
+      grown = false;
+      continue;
+    }
+    grown = true;
+    chute.last_stored_ms += gap;
+    chute.num_stored++;
+    ring_tail++;
+  }
+  if (grown && chute.key < CHUTE_NUM_KEYS) {
+    persist_write_data(KEY_CHUTE_DATA+chute.key, block, w.len);
+    writes++;
+  }
+  chute.key_len = w.len;
+  write_state();
+  energy_count(ENERGY_PERSIST_WRITE, writes);
+}
+
+static void store_job(uint32_t arg) {
+  store_posted = false;
+  store_pending();
+}
+
+static void post_store(void) {
+  if (store_posted) { return; }
+  store_posted = true;
+  workq_post(WORKQ_PRIORITY_BOOKKEEPING, store_job, 0);
+}
+
+static void flush_timer_callback(void *data) {
+  flush_timer = NULL;
+  if (ring_count() > 0) { post_store(); }
+}
+
+const Chute_t *chute_get(void) {
+  return &chute;
+}
+
+// Every press, stored or not
+uint16_t chute_get_count(void) {
+  return chute.num_stored + chute.num_lost + ring_count();
+}
+
+// Finish times stored past the persist budget, which only an export keeps
+uint16_t chute_get_unsaved(void) {
+  return (chute.key >= CHUTE_NUM_KEYS) ? chute.num_stored - ram_base_stored : 0;
+}
+
+uint32_t chute_elapsed_ms(void) {
+  time_t s;
+  uint16_t ms;
+  int32_t elapsed;
+
+  if (chute.state != CHUTE_STATE_RUN) { return chute.recent_ms[0]; }
+  time_ms(&s, &ms);
+  elapsed = (int32_t)(s - chute.time_start.s)*1000 + (int32_t)ms - (int32_t)chute.time_start.ms;
+  return (elapsed > 0) ? (uint32_t)elapsed : 0;
+}
+
+// Store what is pending now. Return the number of data keys in use
+uint8_t chute_store(void) {
+  if (ring_count() > 0) { store_pending(); }
+  if (chute.key >= CHUTE_NUM_BLOCKS) { return CHUTE_NUM_BLOCKS; }
+  return chute.key + (chute.key_len > 0);
+}
+
+// Copy data key k, up to PERSIST_DATA_MAX_LENGTH bytes of varint gaps, into
+// data. Return its length
+uint16_t chute_read_key(uint8_t k, uint8_t *data) {
+  if (k > chute.key || k >= CHUTE_NUM_BLOCKS) { return 0; }
+  if (k == chute.key) {
+    uint8_t *buf = (k < CHUTE_NUM_KEYS) ? block : ram_key[k-CHUTE_NUM_KEYS];
+    if (buf == NULL) { return 0; }
+    memcpy(data, buf, chute.key_len);
+    return chute.key_len;
+  }
+  if (k >= CHUTE_NUM_KEYS) {
+    if (ram_key[k-CHUTE_NUM_KEYS] == NULL) { return 0; }
+    memcpy(data, ram_key[k-CHUTE_NUM_KEYS], ram_key_len[k-CHUTE_NUM_KEYS]);
+    return ram_key_len[k-CHUTE_NUM_KEYS];
+  }
+  int len = persist_read_data(KEY_CHUTE_DATA+k, data, PERSIST_DATA_MAX_LENGTH);
+  return (len > 0) ? len : 0;
+}
+
+// Decode up to max stored finish times, oldest first, storing what is pending
+// first. Return the number read
+uint16_t chute_read(uint32_t *out, uint16_t max) {
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+  uint32_t t = 0;
+  uint32_t gap;
+  uint16_t n = 0;
+  uint8_t num_keys = chute_store();
+
+  for (uint8_t k=0; k<num_keys && n<max; k++) {
+    CodecReader r = {data, chute_read_key(k, data), 0};
+    while (n < max && codec_get_varint(&r, &gap)) {
+      t += gap;
+      out[n++] = t;
+    }
+  }
+  return n;
+}
+
+void chute_start(void) {
+  if (chute.state != CHUTE_STATE_IDLE) { return; }
+  time_ms(&chute.time_start.s, &chute.time_start.ms);
+  chute.state = CHUTE_STATE_RUN;
+}
+
+// Called straight from the button handler, so it only takes the time. Storing
+// is left to the work queue a batch at a time
+void chute_record(void) {
+  if (chute.state != CHUTE_STATE_RUN) { return; }
+  uint32_t t = chute_elapsed_ms();
+
+  // Storage fell a whole ring behind: store now rather than lose a press
+  if (ring_count() >= CHUTE_RING_SIZE) { store_pending(); }
+  ring[ring_head++ % CHUTE_RING_SIZE] = t;
+  for (uint8_t i=CHUTE_NUM_RECENT-1; i>0; i--) { chute.recent_ms[i] = chute.recent_ms[i-1]; }
+  chute.recent_ms[0] = t;
+
+  if (ring_count() >= CHUTE_BATCH) {
+    post_store();
+  } else if (flush_timer == NULL) {
+    flush_timer = app_timer_register(CHUTE_FLUSH_MS, flush_timer_callback, NULL);
+  }
+}
+
+void chute_stop(void) {
+  if (chute.state != CHUTE_STATE_RUN) { return; }
+  chute.state = CHUTE_STATE_STOP;
+  post_store();
+}
+
+// Throw away a stopped chute and the data keys it used
+void chute_clear(void) {
+  if (chute.state == CHUTE_STATE_RUN) { return; }
+  for (uint8_t k=0; k<=chute.key && k<CHUTE_NUM_KEYS; k++) {
+    persist_delete(KEY_CHUTE_DATA+k);
+  }
+  free_ram_keys();
+  ring_tail = ring_head;
+  chute = (Chute_t){.time_start = {0, 0}, .state = CHUTE_STATE_IDLE};
+  persist_write_data(KEY_CHUTE_STATE, &chute, sizeof(chute));
+  energy_count(ENERGY_PERSIST_WRITE, 1);
+}
+
+void chute_init(void) {
+  ring_head = ring_tail = 0;
+  store_posted = false;
+  flush_timer = NULL;
+  if (persist_exists(KEY_CHUTE_STATE)) {
+    persist_read_data(KEY_CHUTE_STATE, &chute, sizeof(chute));
+    if (chute.key < CHUTE_NUM_KEYS && chute.key_len > 0) {
+      persist_read_data(KEY_CHUTE_DATA+chute.key, block, sizeof(block));
+    }
+  } else {
+    chute = (Chute_t){.time_start = {0, 0}, .state = CHUTE_STATE_IDLE};
+  }
+  // Nothing past the persisted keys outlives the app, see write_state()
+  ram_base_stored = chute.num_stored;
+  ram_base_ms = chute.last_stored_ms;
+}
+
+// Call after the work queue is flushed. An idle chute was written when it changed
+void chute_deinit(void) {
+  if (flush_timer) {
+    app_timer_cancel(flush_timer);
+    flush_timer = NULL;
+  }
+  if (ring_count() > 0 || chute.state != CHUTE_STATE_IDLE) { store_pending(); }
+  free_ram_keys();
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#ifndef CHUTE_H
+#define CHUTE_H
+#include "stopwatch.h"
+#include "store_format.h"
+
+#define CHUTE_RING_SIZE   64    // Presses waiting to be stored, power of two
+#define CHUTE_BATCH       16    // Presses stored together
+#define CHUTE_FLUSH_MS    3000  // A part batch is stored this long after it starts
+#define CHUTE_NUM_RECENT  3
+
+// Persist data keys, CHUTE_NUM_KEYS of them from KEY_CHUTE_DATA. As many as fit
+// the chute's budget next to its state: 5 today, about 640 finishers 0.13 to
+// 16 s apart, more when they come closer
+#define CHUTE_NUM_KEYS  ((PERSIST_BUDGET_CHUTE - sizeof(Chute_t)) / PERSIST_DATA_MAX_LENGTH)
+#define KEY_CHUTE_STATE 360
+#define KEY_CHUTE_DATA  361
+
+// Data keys past the persist budget, held in RAM as the chute reaches them and
+// sent to the phone with the rest (chute_export.h), but gone when the app exits.
+// With them about 2170 finishers 0.13 to 16 s apart are kept, 4350 closer
+#define CHUTE_NUM_RAM_KEYS 12
+#define CHUTE_NUM_BLOCKS   (CHUTE_NUM_KEYS + CHUTE_NUM_RAM_KEYS)
+
+enum chute_state_e {CHUTE_STATE_IDLE,
+                    CHUTE_STATE_RUN,
+                    CHUTE_STATE_STOP};
+
+// Finish-line timing: one press per finisher, many a second at times. Finish
+// times are ms from the chute start, stored as varint gaps from the finisher
+// before, so a busy chute costs one or two bytes a finisher
+typedef struct Chute {
+  WatchTimeRecord_t time_start;
+  uint8_t state;
+  uint16_t num_stored;       // Finish times in the data keys
+  uint16_t num_lost;         // Pressed after the data keys filled up, or held in RAM at exit
+  uint32_t last_stored_ms;
+  uint8_t key;               // Data key being filled
+  uint16_t key_len;          // Bytes used in it
+  uint32_t recent_ms[CHUTE_NUM_RECENT];   // Newest first
+} __attribute__((__packed__)) Chute_t;
+
+extern const Chute_t *chute_get(void);
+extern uint16_t chute_get_count(void);
+extern uint16_t chute_get_unsaved(void);
+extern uint32_t chute_elapsed_ms(void);
+extern uint8_t chute_store(void);
+extern uint16_t chute_read_key(uint8_t, uint8_t *);
+extern uint16_t chute_read(uint32_t *, uint16_t);
+
+extern void chute_start(void);
+extern void chute_record(void);
+extern void chute_stop(void);
+extern void chute_clear(void);
+
+extern void chute_init(void);
+extern void chute_deinit(void);
+
+#endif
\ No newline at end of file
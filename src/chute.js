@@ -0,0 +1,75 @@
+// Finish chute receiver
+//
+// The watch sends the chute one data key a message (see chute_export.h): the
+// key's index in CHUTE_SEQ and its varint gaps in ms in CHUTE_DATA. The last
+// message holds CHUTE_END, the number of finish times sent. A key missing or
+// a count that does not add up asks for the whole chute again.
+
+var CHUTE_MAX_REQUESTS = 3;
+
+var chuteNextSeq = 0;
+var chuteBytes = [];
+var chuteRequests = 0;
+
+function chuteDecode(bytes) {
+  var times = [];
+  var t = 0;
+  var gap = 0;
+  var shift = 0;
+  for (var i = 0; i < bytes.length; i++) {
+    gap += (bytes[i] & 0x7F) * Math.pow(2, shift);
+    shift += 7;
+    if (!(bytes[i] & 0x80)) {
+      t += gap;
+      times.push(t);
+      gap = 0;
+      shift = 0;
+    }
+  }
+  return times;
+}
+
+function chuteRequest() {
+  chuteNextSeq = 0;
+  chuteBytes = [];
+  if (++chuteRequests > CHUTE_MAX_REQUESTS) {
+    console.log('Chute: giving up after ' + CHUTE_MAX_REQUESTS + ' requests');
+    return;
+  }
+  Pebble.sendAppMessage({ CHUTE_REQUEST: 1 }, null, function() {
+    console.log('Chute: failed to send the request');
+  });
+}
+
+Pebble.addEventListener('appmessage', function(e) {
+  var p = e.payload;
+  if (p.CHUTE_SEQ === undefined && p.CHUTE_END === undefined) { return; }
+
+  if (p.CHUTE_SEQ !== undefined) {
+    if (p.CHUTE_SEQ === 0) {
+      chuteNextSeq = 0;
+      chuteBytes = [];
+    }
+    if (p.CHUTE_SEQ !== chuteNextSeq) {
+      chuteRequest();
+      return;
+    }
+    chuteBytes = chuteBytes.concat(p.CHUTE_DATA);
+    chuteNextSeq++;
+  } else {
+    chuteBytes = [];
+  }
+
+  if (p.CHUTE_END !== undefined) {
+    var times = chuteDecode(chuteBytes);
+    if (times.length !== p.CHUTE_END) {
+      chuteRequest();
+      return;
+    }
+    chuteRequests = 0;
+    chuteNextSeq = 0;
+    chuteBytes = [];
+    localStorage.setItem('chute', JSON.stringify(times));
+    console.log('Chute: stored ' + times.length + ' finish times');
+  }
+});
\ No newline at end of file
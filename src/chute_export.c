@@ -0,0 +1,149 @@
+#include "pebble.h"
+#include "chute_export.h"
+#include "chute.h"
+#include "comm.h"
+#include "workq.h"
+
+static uint8_t state;
+static bool start_posted;
+static uint8_t num_keys;        // Data keys in use as the export started
+static uint8_t next_key;        // Next data key to send
+static uint16_t num_sent;       // Finish times in the keys the phone has
+static uint16_t num_in_flight;  // Finish times in the key in the outbox
+static bool sending;
+static bool stale;              // The message in the outbox is from an export called off
+static uint8_t retries;
+static uint8_t data[PERSIST_DATA_MAX_LENGTH];
+static AppTimer *retry_timer;
+
+static void pump(void);
+
+static void finish(uint8_t final_state) {
+  if (retry_timer) { app_timer_cancel(retry_timer); retry_timer = NULL; }
+  stale = sending;
+  comm_set_fast_link(COMM_OWNER_CHUTE, false);
+  state = final_state;
+}
+
+static void retry_timer_callback(void *data) {
+  retry_timer = NULL;
+  pump();
+}
+
+static void schedule_retry(void) {
+  if (++retries > CHUTE_EXPORT_MAX_RETRIES) {
+    finish(CHUTE_EXPORT_STATE_FAILED);
+    return;
+  }
+  if (!retry_timer) { retry_timer = app_timer_register(CHUTE_EXPORT_RETRY_MS, retry_timer_callback, NULL); }
+}
+
+// One varint ends at each byte without its continuation bit
+static uint16_t count_times(const uint8_t *buf, uint16_t len) {
+  uint16_t n = 0;
+  for (uint16_t i=0; i<len; i++) { n += !(buf[i] & 0x80); }
+  return n;
+}
+
+// Send the next data key if the outbox is free. A key is read as it is sent,
+// so the one being filled goes with the finish times stored by then
+static void pump(void) {
+  DictionaryIterator *iter;
+  uint16_t len = 0;
+
+  if (state != CHUTE_EXPORT_STATE_SEND || sending || retry_timer) { return; }
+  // Outbox is busy: comm calls back through the ready handler
+  if (!comm_outbox_begin(COMM_OWNER_CHUTE, &iter)) { return; }
+
+  if (next_key < num_keys) {
+    len = chute_read_key(next_key, data);
+    dict_write_uint8(iter, MSG_KEY_CHUTE_SEQ, next_key);
+    dict_write_data(iter, MSG_KEY_CHUTE_DATA, data, len);
+  }
+  num_in_flight = count_times(data, len);
+  if (next_key+1 >= num_keys) { dict_write_uint16(iter, MSG_KEY_CHUTE_END, num_sent+num_in_flight); }
+  dict_write_end(iter);
+
+  sending = true;
+  if (!comm_outbox_send()) {
+    sending = false;
+    schedule_retry();
+  }
+}
+
+//----- Begin AppMessage handlers
+static void sent_handler(void) {
+  sending = false;
+  if (stale) {
+    stale = false;
+    pump();
+    return;
+  }
+  if (state != CHUTE_EXPORT_STATE_SEND) { return; }
+  num_sent += num_in_flight;
+  retries = 0;
+  if (++next_key >= num_keys) {
+    finish(CHUTE_EXPORT_STATE_DONE);
+    return;
+  }
+  pump();
+}
+
+static void failed_handler(AppMessageResult reason) {
+  sending = false;
+  if (stale) {
+    stale = false;
+    pump();
+    return;
+  }
+  if (state == CHUTE_EXPORT_STATE_SEND) { schedule_retry(); }
+}
+
+static void received_handler(DictionaryIterator *iter) {
+  if (dict_find(iter, MSG_KEY_CHUTE_REQUEST)) { chute_export_start(); }
+}
+//----- End AppMessage handlers
+
+// Runs after the chute's own store job, so the presses still in its ring go too
+static void start_job(uint32_t arg) {
+  start_posted = false;
+  num_keys = chute_store();
+  next_key = 0;
+  num_sent = 0;
+  retries = 0;
+  state = CHUTE_EXPORT_STATE_SEND;
+  comm_set_fast_link(COMM_OWNER_CHUTE, true);
+  pump();
+}
+
+// Send every finish time stored. An export under way goes on as it is
+void chute_export_start(void) {
+  if (state == CHUTE_EXPORT_STATE_SEND || start_posted) { return; }
+  start_posted = true;
+  workq_post(WORKQ_PRIORITY_BACKGROUND, start_job, 0);
+}
+
+// Before the chute is cleared: the keys are read as they are sent
+void chute_export_cancel(void) {
+  if (state == CHUTE_EXPORT_STATE_SEND) { finish(CHUTE_EXPORT_STATE_IDLE); }
+}
+
+uint8_t chute_export_get_state(void) {
+  return state;
+}
+
+void chute_export_init(void) {
+  state = CHUTE_EXPORT_STATE_IDLE;
+  start_posted = false;
+  sending = stale = false;
+  comm_register(COMM_OWNER_CHUTE, (CommHandlers){
+    .ready = pump,
+    .received = received_handler,
+    .sent = sent_handler,
+    .failed = failed_handler,
+  });
+}
+
+void chute_export_deinit(void) {
+  chute_export_cancel();
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef CHUTE_EXPORT_H
+#define CHUTE_EXPORT_H
+
+#define CHUTE_EXPORT_MAX_RETRIES 5
+#define CHUTE_EXPORT_RETRY_MS    500
+
+// The finish chute sent to the phone, one data key a message as chute.h stores
+// it: CHUTE_SEQ the key's index and CHUTE_DATA its varint gaps. The last
+// message also holds CHUTE_END, the number of finish times sent. Started when
+// the chute is stopped or the phone sends CHUTE_REQUEST; the phone asks again
+// if the count does not add up
+enum chute_export_state_e {CHUTE_EXPORT_STATE_IDLE,
+                           CHUTE_EXPORT_STATE_SEND,
+                           CHUTE_EXPORT_STATE_DONE,
+                           CHUTE_EXPORT_STATE_FAILED};
+
+extern void chute_export_start(void);
+extern void chute_export_cancel(void);
+extern uint8_t chute_export_get_state(void);
+
+extern void chute_export_init(void);
+extern void chute_export_deinit(void);
+
+#endif
\ No newline at end of file
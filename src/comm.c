@@ -0,0 +1,112 @@
+#include "pebble.h"
+#include "comm.h"
+
+static CommHandlers handlers[COMM_OWNER_SIZE];
+static uint8_t outbox_owner;       // Owner of the message in flight, COMM_OWNER_NONE if free
+static uint8_t outbox_waiting;     // Bitmask of owners turned away while the outbox was busy
+static uint8_t fast_link_request;  // Bitmask of owners asking for a reduced sniff interval
+static uint16_t outbox_size;
+static AppTimer *ready_timer;
+
+// Hand the free outbox to waiting owners, highest priority first
+static void notify_ready(void) {
+  for (uint8_t i=0; i<COMM_OWNER_SIZE && outbox_owner == COMM_OWNER_NONE; i++) {
+    if (!(outbox_waiting & (1 << i))) { continue; }
+    outbox_waiting &= ~(1 << i);
+    if (handlers[i].ready) { handlers[i].ready(); }
+  }
+}
+
+static void ready_timer_callback(void *data) {
+  ready_timer = NULL;
+  notify_ready();
+}
+
+static void inbox_received_handler(DictionaryIterator *iter, void *context) {
+  for (uint8_t i=0; i<COMM_OWNER_SIZE; i++) {
+    if (handlers[i].received) { handlers[i].received(iter); }
+  }
+}
+
+// Waiting owners go before the owner that just finished, so a busy owner
+// cannot hold the outbox for more than one message at a time
+static void outbox_sent_handler(DictionaryIterator *iter, void *context) {
+  uint8_t owner = outbox_owner;
+  outbox_owner = COMM_OWNER_NONE;
+  notify_ready();
+  if (handlers[owner].sent) { handlers[owner].sent(); }
+}
+
+static void outbox_failed_handler(DictionaryIterator *iter, AppMessageResult reason, void *context) {
+  uint8_t owner = outbox_owner;
+  outbox_owner = COMM_OWNER_NONE;
+  notify_ready();
+  if (handlers[owner].failed) { handlers[owner].failed(reason); }
+}
+
+void comm_register(uint8_t owner, CommHandlers owner_handlers) {
+  handlers[owner] = owner_handlers;
+}
+
+// Return false if another message is in flight; only one message may be in the outbox.
+// The owner's ready handler is then called once the outbox is free
+bool comm_outbox_begin(uint8_t owner, DictionaryIterator **iter) {
+  if (outbox_owner != COMM_OWNER_NONE) {
+    outbox_waiting |= (1 << owner);
+    return false;
+  }
+  if (app_message_outbox_begin(iter) != APP_MSG_OK) {
+    outbox_waiting |= (1 << owner);
+    if (!ready_timer) { ready_timer = app_timer_register(COMM_RETRY_MS, ready_timer_callback, NULL); }
+    return false;
+  }
+  outbox_owner = owner;
+  return true;
+}
+
+bool comm_outbox_send(void) {
+  if (app_message_outbox_send() != APP_MSG_OK) {
+    outbox_owner = COMM_OWNER_NONE;
+    return false;
+  }
+  return true;
+}
+
+// Largest byte array that fits next to num_tuples other tuples holding tuple_bytes of values
+uint16_t comm_outbox_payload_size(uint8_t num_tuples, uint16_t tuple_bytes) {
+  // Same as dict_calc_buffer_size(): 1 byte header, 7 bytes per tuple header
+  return outbox_size - (1 + 7*(num_tuples+1) + tuple_bytes);
+}
+
+// Keep the radio in reduced sniff mode only while some owner is transferring
+void comm_set_fast_link(uint8_t owner, bool enable) {
+  uint8_t prev_request = fast_link_request;
+  if (enable) {
+    fast_link_request |= (1 << owner);
+  } else {
+    fast_link_request &= ~(1 << owner);
+  }
+  if ((prev_request == 0) != (fast_link_request == 0)) {
+    app_comm_set_sniff_interval((fast_link_request != 0) ? SNIFF_INTERVAL_REDUCED : SNIFF_INTERVAL_NORMAL);
+  }
+}
+
+void comm_init(void) {
+  outbox_owner = COMM_OWNER_NONE;
+  outbox_waiting = 0;
+  fast_link_request = 0;
+  app_message_register_inbox_received(inbox_received_handler);
+  app_message_register_outbox_sent(outbox_sent_handler);
+  app_message_register_outbox_failed(outbox_failed_handler);
+
+  // Never ask for more than the platform can give
+  outbox_size = (app_message_outbox_size_maximum() < COMM_OUTBOX_SIZE) ?
+                app_message_outbox_size_maximum() : COMM_OUTBOX_SIZE;
+  app_message_open(COMM_INBOX_SIZE, outbox_size);
+}
+
+void comm_deinit(void) {
+  if (ready_timer) { app_timer_cancel(ready_timer); ready_timer = NULL; }
+  if (fast_link_request != 0) { app_comm_set_sniff_interval(SNIFF_INTERVAL_NORMAL); }
+  app_message_deregister_callbacks();
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef COMM_H
+#define COMM_H
+
+#define COMM_INBOX_SIZE  APP_MESSAGE_INBOX_SIZE_MINIMUM
+#define COMM_OUTBOX_SIZE APP_MESSAGE_OUTBOX_SIZE_MINIMUM
+#define COMM_RETRY_MS    100   // Poll interval when the outbox cannot be opened
+
+// AppMessage keys, must match "appKeys" in appinfo.json
+#define MSG_KEY_EXPORT_REQUEST 1
+#define MSG_KEY_EXPORT_SEQ     2
+#define MSG_KEY_EXPORT_DATA    3
+#define MSG_KEY_EXPORT_END     4
+#define MSG_KEY_EXPORT_ACK     5
+#define MSG_KEY_EXPORT_NACK    6
+#define MSG_KEY_SYNC_REQUEST    7
+#define MSG_KEY_SYNC_REVISION   8
+#define MSG_KEY_SYNC_FULL       9
+#define MSG_KEY_SYNC_TOMBSTONES 10
+#define MSG_KEY_TELEMETRY         11
+#define MSG_KEY_TELEMETRY_DROPPED 12
+#define MSG_KEY_PLAN              13
+#define MSG_KEY_CHUTE_REQUEST 14
+#define MSG_KEY_CHUTE_SEQ     15
+#define MSG_KEY_CHUTE_DATA    16
+#define MSG_KEY_CHUTE_END     17
+
+// Modules sharing the AppMessage outbox, highest priority first
+enum comm_owner_e {COMM_OWNER_NONE,
+                   COMM_OWNER_TELEMETRY,
+                   COMM_OWNER_EXPORT,
+                   COMM_OWNER_CHUTE,
+                   COMM_OWNER_PLAN,     // Receives only
+                   COMM_OWNER_SIZE};
+
+typedef struct CommHandlers {
+  void (*ready)(void);  // Outbox is free again after comm_outbox_begin() returned false
+  void (*received)(DictionaryIterator *);
+  void (*sent)(void);
+  void (*failed)(AppMessageResult);
+} CommHandlers;
+
+extern void comm_register(uint8_t, CommHandlers);
+extern bool comm_outbox_begin(uint8_t, DictionaryIterator **);
+extern bool comm_outbox_send(void);
+extern uint16_t comm_outbox_payload_size(uint8_t, uint16_t);
+extern void comm_set_fast_link(uint8_t, bool);
+
+extern void comm_init(void);
+extern void comm_deinit(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "pebble.h"
+#include "energy.h"
+
+SessionEnergy_t session_energy[NUM_LAP_MEMORY];
+
+// Work is only charged to the session in progress once it has started. Persist
+// writes while idle come from saving, so they go to the session saved last
+static bool active;
+static uint8_t saved_index = ENERGY_NONE;
+
+static uint16_t add_u16(uint16_t a, uint16_t b) {
+  return (a > 0xFFFF - b) ? 0xFFFF : a + b;
+}
+
+static uint8_t add_u8(uint8_t a, uint16_t b) {
+  return (b > 0xFF - a) ? 0xFF : a + b;
+}
+
+void energy_set_active(bool enable) {
+  active = enable;
+}
+
+// Session i was saved: the idle-time writes that follow, up to the next save, are its
+void energy_session_saved(uint8_t i) {
+  saved_index = i;
+}
+
+void energy_count(uint8_t counter, uint16_t n) {
+  if (!active && (counter != ENERGY_PERSIST_WRITE || saved_index == ENERGY_NONE)) { return; }
+  SessionEnergy_t *e = &session_energy[active ? session_index : saved_index];
+
+  switch (counter) {
+    case ENERGY_WAKEUP:
+      e->wakeups = add_u16(e->wakeups, n);
+      break;
+    case ENERGY_REDRAW:
+      e->redraws = add_u16(e->redraws, n);
+      break;
+    case ENERGY_TEXT_DRAW:
+      e->text_draws = (e->text_draws > 0xFFFFFFFF - n) ? 0xFFFFFFFF : e->text_draws + n;
+      break;
+    case ENERGY_PERSIST_WRITE:
+      e->persist_writes = add_u8(e->persist_writes, n);
+      break;
+    case ENERGY_VIBE:
+      e->vibes = add_u8(e->vibes, n);
+      break;
+  }
+}
+
+// A finished session was put in at i, in front of the session in progress
+void energy_session_inserted(uint8_t i) {
+  for (uint8_t j=NUM_LAP_MEMORY-1; j>i; j--) {
+    session_energy[j] = session_energy[j-1];
+  }
+  session_energy[i] = (SessionEnergy_t){0, 0, 0, 0, 0};
+  if (saved_index != ENERGY_NONE && saved_index >= i) { saved_index++; }
+}
+
+// Shift down, same as session[]
+void energy_session_deleted(uint8_t i) {
+  for (uint8_t j=i; j<NUM_LAP_MEMORY-1; j++) {
+    session_energy[j] = session_energy[j+1];
+  }
+  session_energy[NUM_LAP_MEMORY-1] = (SessionEnergy_t){0, 0, 0, 0, 0};
+  if (saved_index == i) {
+    saved_index = ENERGY_NONE;
+  } else if (saved_index != ENERGY_NONE && saved_index > i) {
+    saved_index--;
+  }
+}
+
+void energy_session_reset(uint8_t i) {
+  session_energy[i] = (SessionEnergy_t){0, 0, 0, 0, 0};
+}
+
+void energy_init(void) {
+  uint8_t *data = (uint8_t *)session_energy;
+  size_t key_size = ENERGY_SESSIONS_PER_KEY*sizeof(SessionEnergy_t);
+
+  memset(session_energy, 0, sizeof(session_energy));
+  saved_index = ENERGY_NONE;
+  for (uint8_t k=0; k<ENERGY_NUM_KEYS; k++) {
+    size_t offset = k*key_size;
+    size_t size = (sizeof(session_energy)-offset < key_size) ? sizeof(session_energy)-offset : key_size;
+    if (persist_exists(KEY_SESSION_ENERGY+k)) {
+      persist_read_data(KEY_SESSION_ENERGY+k, data+offset, size);
+    }
+  }
+}
+
+// Call last, after the other modules' writes have been counted
+void energy_deinit(void) {
+  uint8_t *data = (uint8_t *)session_energy;
+  size_t key_size = ENERGY_SESSIONS_PER_KEY*sizeof(SessionEnergy_t);
+
+  energy_count(ENERGY_PERSIST_WRITE, ENERGY_NUM_KEYS);
+  for (uint8_t k=0; k<ENERGY_NUM_KEYS; k++) {
+    size_t offset = k*key_size;
+    size_t size = (sizeof(session_energy)-offset < key_size) ? sizeof(session_energy)-offset : key_size;
+    persist_write_data(KEY_SESSION_ENERGY+k, data+offset, size);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+#include "stopwatch.h"
+
+// Persist data keys, ENERGY_NUM_KEYS of them from KEY_SESSION_ENERGY
+#define KEY_SESSION_ENERGY 320
+#define ENERGY_NONE        0xFF   // No session saved since launch
+
+enum energy_counter_e {ENERGY_WAKEUP,
+                       ENERGY_REDRAW,
+                       ENERGY_TEXT_DRAW,
+                       ENERGY_PERSIST_WRITE,
+                       ENERGY_VIBE,
+                       ENERGY_SIZE};
+
+// Work done on the watch while each session was in progress, parallel to session[].
+// Counters saturate rather than wrap
+typedef struct SessionEnergy {
+  uint16_t wakeups;         // Stopwatch ticks
+  uint16_t redraws;         // Watchface and warning layer redraws
+  uint32_t text_draws;      // graphics_draw_text() calls from those redraws
+  uint8_t persist_writes;
+  uint8_t vibes;
+} __attribute__((__packed__)) SessionEnergy_t;
+
+#define ENERGY_SESSIONS_PER_KEY (PERSIST_DATA_MAX_LENGTH / sizeof(SessionEnergy_t))
+#define ENERGY_NUM_KEYS         ((NUM_LAP_MEMORY + ENERGY_SESSIONS_PER_KEY - 1) / ENERGY_SESSIONS_PER_KEY)
+
+extern SessionEnergy_t session_energy[NUM_LAP_MEMORY];
+
+extern void energy_set_active(bool);
+extern void energy_count(uint8_t, uint16_t);
+extern void energy_session_saved(uint8_t);
+extern void energy_session_inserted(uint8_t);
+extern void energy_session_deleted(uint8_t);
+extern void energy_session_reset(uint8_t);
+
+extern void energy_init(void);
+extern void energy_deinit(void);
+
+#endif
\ No newline at end of file
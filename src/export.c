@@ -0,0 +1,312 @@
+#include "pebble.h"
+#include "export.h"
+#include "comm.h"
+#include "stopwatch.h"
+#include "session_codec.h"
+#include "sync.h"
+
+#define EXPORT_SEQ_UNKNOWN 0xFFFF
+#define EXPORT_SLOTS       (EXPORT_WINDOW+1)
+#define EXPORT_END_TUPLES  4     // END, revision, full flag and tombstones
+
+// Position in the session memory where a packet starts
+typedef struct ExportCursor {
+  uint8_t session;
+  uint8_t lap;
+} ExportCursor;
+
+static uint8_t state;
+static uint8_t num_sessions;        // Saved sessions at the time the export started
+static uint16_t since;              // Only sessions changed after this revision are sent, 0 for all
+static uint16_t revision;           // Store revision at the time the export started
+static uint8_t tombstones[SYNC_MAX_TOMBSTONES*3];  // Varint ids of sessions deleted after since
+static uint8_t tombstones_len;
+static uint16_t seq_base;           // Oldest packet not yet acknowledged by the phone
+static uint16_t seq_next;           // Next packet to transmit
+static uint16_t seq_end;            // One past the last data packet
+static uint16_t seq_sending;        // Packet in the outbox
+static bool sending;
+static ExportCursor cursor[EXPORT_SLOTS];  // Start of packet seq at [seq % EXPORT_SLOTS]
+static uint8_t retries;
+
+static uint8_t *payload;
+static uint16_t payload_size;
+
+static AppTimer *retry_timer;
+static AppTimer *ack_timer;
+static void (*status_handler)(void);
+
+static void pump(void);
+
+static void notify_status(void) {
+  if (status_handler) { status_handler(); }
+}
+
+static void cancel_timers(void) {
+  if (retry_timer) { app_timer_cancel(retry_timer); retry_timer = NULL; }
+  if (ack_timer)   { app_timer_cancel(ack_timer);   ack_timer = NULL; }
+}
+
+static void finish(uint8_t final_state) {
+  cancel_timers();
+  free(payload);
+  payload = NULL;
+  comm_set_fast_link(COMM_OWNER_EXPORT, false);
+  state = final_state;
+  notify_status();
+}
+
+// First session at or after i that changed after since
+static uint8_t next_session(uint8_t i) {
+  while (i < num_sessions && session_rev[i].rev <= since) { i++; }
+  return i;
+}
+
+// Fill buf with as many laps as fit, starting at and advancing *c
+static uint16_t pack_packet(ExportCursor *c, uint8_t *buf, uint16_t cap) {
+  CodecWriter w = {.buf=buf, .cap=cap, .len=0};
+
+  while (c->session < num_sessions) {
+    Session_t s = session[c->session];
+    uint8_t total_laps = s.end_index - s.start_index + 1;
+    CodecChunk chunk = {.session=session_rev[c->session].id,
+                        .first_lap=c->lap,
+                        .total_laps=total_laps,
+                        .save_time=(uint32_t)save_time[c->session]};
+    uint16_t len = w.len;
+
+    if (!codec_chunk_begin(&w, &chunk)) { break; }
+    while ((c->lap < total_laps) &&
+           codec_chunk_put_lap(&w, &chunk, get_lap_cs(s, s.start_index+c->lap))) {
+      c->lap++;
+    }
+    if (chunk.num_laps == 0) {
+      // Not even one lap fits, drop the empty chunk header
+      w.len = len;
+      break;
+    }
+    if (c->lap < total_laps) {
+      // Packet is full, unless the chunk only ran out of lap count
+      if (chunk.num_laps < CODEC_CHUNK_MAX_LAPS) { break; }
+      continue;
+    }
+    c->session = next_session(c->session+1);
+    c->lap = 0;
+  }
+  return w.len;
+}
+
+static void retry_timer_callback(void *data) {
+  retry_timer = NULL;
+  pump();
+}
+
+static void schedule_retry(void) {
+  if (++retries > EXPORT_MAX_RETRIES) {
+    finish(EXPORT_STATE_FAILED);
+    return;
+  }
+  if (!retry_timer) { retry_timer = app_timer_register(EXPORT_RETRY_MS, retry_timer_callback, NULL); }
+}
+
+// No acknowledgement in time: go back to the oldest unacknowledged packet
+static void ack_timer_callback(void *data) {
+  ack_timer = NULL;
+  if (state != EXPORT_STATE_SEND || seq_next == seq_base) { return; }
+  seq_next = seq_base;
+  schedule_retry();
+}
+
+static void restart_ack_timer(void) {
+  if (ack_timer) { app_timer_cancel(ack_timer); }
+  ack_timer = (seq_next != seq_base) ? app_timer_register(EXPORT_ACK_TIMEOUT_MS, ack_timer_callback, NULL) : NULL;
+}
+
+// Send the next packet if the outbox is free and the window allows
+static void pump(void) {
+  DictionaryIterator *iter;
+
+  if (sending || retry_timer) { return; }
+  if (state == EXPORT_STATE_SEND) {
+    if (seq_end != EXPORT_SEQ_UNKNOWN && seq_base >= seq_end) {
+      state = EXPORT_STATE_END;
+    } else if ((seq_next - seq_base >= EXPORT_WINDOW) ||
+               (seq_end != EXPORT_SEQ_UNKNOWN && seq_next >= seq_end)) {
+      // Window full or everything sent: wait for acknowledgement
+      return;
+    }
+  }
+  if (state != EXPORT_STATE_SEND && state != EXPORT_STATE_END) { return; }
+
+  // Outbox is busy with another owner: comm calls back through the ready handler
+  if (!comm_outbox_begin(COMM_OWNER_EXPORT, &iter)) { return; }
+
+  if (state == EXPORT_STATE_END) {
+    dict_write_uint16(iter, MSG_KEY_EXPORT_END, seq_end);
+    dict_write_uint16(iter, MSG_KEY_SYNC_REVISION, revision);
+    dict_write_uint8(iter, MSG_KEY_SYNC_FULL, (since == 0) ? 1 : 0);
+    if (tombstones_len > 0) { dict_write_data(iter, MSG_KEY_SYNC_TOMBSTONES, tombstones, tombstones_len); }
+  } else {
+    ExportCursor c = cursor[seq_next % EXPORT_SLOTS];
+    uint16_t len = pack_packet(&c, payload, payload_size);
+    if (c.session >= num_sessions && seq_end == EXPORT_SEQ_UNKNOWN) {
+      seq_end = seq_next+1;
+    }
+    cursor[(seq_next+1) % EXPORT_SLOTS] = c;
+    dict_write_uint16(iter, MSG_KEY_EXPORT_SEQ, seq_next);
+    dict_write_data(iter, MSG_KEY_EXPORT_DATA, payload, len);
+  }
+  dict_write_end(iter);
+
+  seq_sending = seq_next;
+  sending = true;
+  if (!comm_outbox_send()) {
+    sending = false;
+    schedule_retry();
+  }
+}
+
+//----- Begin AppMessage handlers
+static void sent_handler(void) {
+  sending = false;
+  switch (state) {
+    case EXPORT_STATE_SEND:
+      if (seq_sending == seq_next) { seq_next++; }
+      if (!ack_timer) { restart_ack_timer(); }
+      pump();
+      break;
+    case EXPORT_STATE_END:
+      finish(EXPORT_STATE_DONE);
+      break;
+  }
+}
+
+static void failed_handler(AppMessageResult reason) {
+  sending = false;
+  if (state == EXPORT_STATE_SEND || state == EXPORT_STATE_END) { schedule_retry(); }
+}
+
+static void received_handler(DictionaryIterator *iter) {
+  Tuple *tuple;
+
+  if (dict_find(iter, MSG_KEY_EXPORT_REQUEST)) {
+    export_start(0);
+    return;
+  }
+  if ((tuple = dict_find(iter, MSG_KEY_SYNC_REQUEST))) {
+    export_start(tuple->value->uint16);
+    return;
+  }
+  if (state != EXPORT_STATE_SEND) { return; }
+
+  // Cumulative acknowledgement: the phone has every packet before ack
+  if ((tuple = dict_find(iter, MSG_KEY_EXPORT_ACK))) {
+    uint16_t ack = tuple->value->uint16;
+    if (ack > seq_base && ack <= seq_next) {
+      seq_base = ack;
+      retries = 0;
+      restart_ack_timer();
+      notify_status();
+      pump();
+    }
+  }
+
+  // Negative acknowledgement: the phone is missing nack, resend from there
+  if ((tuple = dict_find(iter, MSG_KEY_EXPORT_NACK))) {
+    uint16_t nack = tuple->value->uint16;
+    if (nack >= seq_base && nack < seq_next) {
+      seq_base = nack;
+      seq_next = nack;
+      restart_ack_timer();
+      schedule_retry();
+    }
+  }
+}
+//----- End AppMessage handlers
+
+// Encode the tombstones for the END message, false if they do not fit
+static bool pack_tombstones(void) {
+  uint16_t ids[SYNC_MAX_TOMBSTONES];
+  uint8_t num_ids = sync_get_tombstones(since, ids, SYNC_MAX_TOMBSTONES);
+  uint16_t cap = comm_outbox_payload_size(EXPORT_END_TUPLES-1, 2*sizeof(uint16_t)+sizeof(uint8_t));
+  CodecWriter w = {.buf=tombstones, .cap=(cap < sizeof(tombstones)) ? cap : sizeof(tombstones), .len=0};
+
+  for (uint8_t i=0; i<num_ids; i++) {
+    if (!codec_put_varint(&w, ids[i])) { return false; }
+  }
+  tombstones_len = w.len;
+  return true;
+}
+
+// Send the sessions created or changed after since_revision, and the ids of those deleted
+// Falls back to a full export when the tombstones since then are no longer all known
+void export_start(uint16_t since_revision) {
+  if (state == EXPORT_STATE_SEND || state == EXPORT_STATE_END) { return; }
+
+  // Only the saved sessions are exported, the session in progress is not
+  num_sessions = session_index;
+  revision = sync_get_revision();
+  since = (since_revision > revision || !sync_is_complete_since(since_revision)) ? 0 : since_revision;
+  if (since != 0 && !pack_tombstones()) { since = 0; }
+  if (since == 0) { tombstones_len = 0; }
+
+  payload_size = comm_outbox_payload_size(1, sizeof(uint16_t));
+  payload = malloc(payload_size);
+  if (!payload) {
+    state = EXPORT_STATE_FAILED;
+    notify_status();
+    return;
+  }
+
+  seq_base = seq_next = 0;
+  cursor[0] = (ExportCursor){next_session(0), 0};
+  seq_end = (cursor[0].session >= num_sessions) ? 0 : EXPORT_SEQ_UNKNOWN;
+  retries = 0;
+  sending = false;
+  state = EXPORT_STATE_SEND;
+
+  comm_set_fast_link(COMM_OWNER_EXPORT, true);
+  notify_status();
+  pump();
+}
+
+void export_cancel(void) {
+  if (state == EXPORT_STATE_SEND || state == EXPORT_STATE_END) { finish(EXPORT_STATE_IDLE); }
+}
+
+uint8_t export_get_state(void) {
+  return state;
+}
+
+// Percentage of laps acknowledged by the phone
+uint8_t export_get_progress(void) {
+  uint16_t total_laps = 0;
+  uint16_t acked_laps = 0;
+  ExportCursor c = cursor[seq_base % EXPORT_SLOTS];
+
+  if (state == EXPORT_STATE_DONE || state == EXPORT_STATE_END) { return 100; }
+  for (uint8_t i=next_session(0); i<num_sessions; i=next_session(i+1)) {
+    uint8_t laps = session[i].end_index - session[i].start_index + 1;
+    total_laps += laps;
+    acked_laps += (i < c.session) ? laps : (i == c.session) ? c.lap : 0;
+  }
+  return (total_laps == 0) ? 0 : (uint8_t)(acked_laps * 100 / total_laps);
+}
+
+void export_set_status_handler(void (*handler)(void)) {
+  status_handler = handler;
+}
+
+void export_init(void) {
+  state = EXPORT_STATE_IDLE;
+  comm_register(COMM_OWNER_EXPORT, (CommHandlers){
+    .ready = pump,
+    .received = received_handler,
+    .sent = sent_handler,
+    .failed = failed_handler,
+  });
+}
+
+void export_deinit(void) {
+  export_cancel();
+}
\ No newline at end of file
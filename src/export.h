@@ -0,0 +1,24 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#define EXPORT_WINDOW         4     // Packets sent but not yet acknowledged by the phone
+#define EXPORT_MAX_RETRIES    5
+#define EXPORT_RETRY_MS       250
+#define EXPORT_ACK_TIMEOUT_MS 3000
+
+enum export_state_e {EXPORT_STATE_IDLE,
+                     EXPORT_STATE_SEND,
+                     EXPORT_STATE_END,
+                     EXPORT_STATE_DONE,
+                     EXPORT_STATE_FAILED};
+
+extern void export_start(uint16_t);
+extern void export_cancel(void);
+extern uint8_t export_get_state(void);
+extern uint8_t export_get_progress(void);
+extern void export_set_status_handler(void (*)(void));
+
+extern void export_init(void);
+extern void export_deinit(void);
+
+#endif
\ No newline at end of file
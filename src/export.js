@@ -0,0 +1,122 @@
+// Session export receiver
+//
+// Decodes the packets sent by export.c (see session_codec.h for the layout),
+// acknowledges them cumulatively and asks for a resend from the first gap.
+// Sessions are kept by id; on start-up only changes since the last stored
+// revision are requested (see sync.h).
+
+var exportNextSeq = 0;
+var exportNackedSeq = -1;
+var exportSessions = {};
+
+function exportReadVarint(bytes, r) {
+  var value = 0;
+  var shift = 0;
+  var b;
+  do {
+    b = bytes[r.pos++];
+    value += (b & 0x7F) * Math.pow(2, shift);
+    shift += 7;
+  } while (b & 0x80);
+  return value;
+}
+
+function exportReadSvarint(bytes, r) {
+  var zigzag = exportReadVarint(bytes, r);
+  return (zigzag % 2) ? -(zigzag + 1) / 2 : zigzag / 2;
+}
+
+function exportDecodePacket(bytes) {
+  var r = { pos: 0 };
+  while (r.pos < bytes.length) {
+    var id = exportReadVarint(bytes, r);
+    var firstLap = bytes[r.pos++];
+    var numLaps = bytes[r.pos++];
+    var s = exportSessions[id];
+    if (firstLap === 0) {
+      s = exportSessions[id] = {
+        saveTime: exportReadVarint(bytes, r),
+        totalLaps: bytes[r.pos++],
+        laps: []
+      };
+    }
+    var prev = 0;
+    for (var i = 0; i < numLaps; i++) {
+      prev += exportReadSvarint(bytes, r);
+      s.laps[firstLap + i] = prev;
+    }
+  }
+}
+
+function exportSend(dict) {
+  Pebble.sendAppMessage(dict, null, function() {
+    console.log('Export: failed to send ' + JSON.stringify(dict));
+  });
+}
+
+function exportLoad() {
+  var stored = localStorage.getItem('sessions');
+  var sessions = stored ? JSON.parse(stored) : {};
+  // Lists stored before sync have no ids to merge against
+  return (sessions instanceof Array) ? {} : sessions;
+}
+
+function exportStore(p) {
+  var sessions = p.SYNC_FULL ? {} : exportLoad();
+  var id;
+  for (id in exportSessions) {
+    sessions[id] = exportSessions[id];
+  }
+  if (p.SYNC_TOMBSTONES !== undefined) {
+    var r = { pos: 0 };
+    while (r.pos < p.SYNC_TOMBSTONES.length) {
+      delete sessions[exportReadVarint(p.SYNC_TOMBSTONES, r)];
+    }
+  }
+  localStorage.setItem('sessions', JSON.stringify(sessions));
+  localStorage.setItem('syncRevision', p.SYNC_REVISION);
+  console.log('Export: stored ' + Object.keys(sessions).length + ' sessions at revision ' + p.SYNC_REVISION);
+}
+
+Pebble.addEventListener('ready', function() {
+  var stored = localStorage.getItem('sessions');
+  var revision = parseInt(localStorage.getItem('syncRevision'), 10) || 0;
+  if (stored === null || JSON.parse(stored) instanceof Array) {
+    // Nothing to build on: ask for everything
+    revision = 0;
+  }
+  exportSend({ SYNC_REQUEST: revision });
+});
+
+Pebble.addEventListener('appmessage', function(e) {
+  var p = e.payload;
+
+  if (p.EXPORT_SEQ !== undefined) {
+    if (p.EXPORT_SEQ === 0 && exportNextSeq !== 0) {
+      // A new export started
+      exportNextSeq = 0;
+      exportSessions = {};
+    }
+    if (p.EXPORT_SEQ === exportNextSeq) {
+      exportDecodePacket(p.EXPORT_DATA);
+      exportNextSeq++;
+      exportSend({ EXPORT_ACK: exportNextSeq });
+    } else if (p.EXPORT_SEQ > exportNextSeq) {
+      // Gap: ask once per gap for a resend
+      if (exportNackedSeq !== exportNextSeq) {
+        exportNackedSeq = exportNextSeq;
+        exportSend({ EXPORT_NACK: exportNextSeq });
+      }
+    } else {
+      // Duplicate: the ack was lost
+      exportSend({ EXPORT_ACK: exportNextSeq });
+    }
+  }
+
+  if (p.EXPORT_END !== undefined && p.EXPORT_END === exportNextSeq) {
+    exportStore(p);
+    exportSessions = {};
+    exportNextSeq = 0;
+    exportNackedSeq = -1;
+  }
+});
\ No newline at end of file
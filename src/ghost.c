@@ -0,0 +1,76 @@
+#include "pebble.h"
+#include "ghost.h"
+#include "energy.h"
+
+// The saved session raced against, or GHOST_NONE
+static uint8_t ghost_session;
+
+// Its splits in centiseconds, laid out when a run starts so a tick is one lookup
+static int32_t ghost_split_cs[NUM_LAP_MEMORY];
+static uint8_t ghost_num_splits;
+
+// A run is under way, from its start until it is reset or saved
+static bool running;
+
+bool ghost_is_active(void) {
+  return ghost_num_splits > 0;
+}
+
+uint8_t ghost_get_session(void) {
+  return ghost_session;
+}
+
+// Race against saved session i from the next run on, GHOST_NONE for no ghost
+void ghost_set_session(uint8_t i) {
+  ghost_session = (i < session_index) ? i : GHOST_NONE;
+  ghost_prepare();
+}
+
+// Call as a run starts: copies the ghost's splits out of the lap memory, which
+// moves as sessions are saved and deleted
+void ghost_prepare(void) {
+  ghost_num_splits = 0;
+  if (ghost_session == GHOST_NONE) { return; }
+
+  Session_t s = session[ghost_session];
+  for (uint8_t i=s.start_index; i<=s.end_index; i++) {
+    ghost_split_cs[ghost_num_splits++] = split_cs[i];
+  }
+}
+
+void ghost_set_running(bool enable) {
+  running = enable;
+}
+
+// Ahead (negative) or behind the ghost at lap (0-based) with elapsed_cs on the
+// clock. Past the ghost's last lap it is measured against the ghost's finish
+int32_t ghost_delta_cs(uint8_t lap, int32_t elapsed_cs) {
+  if (ghost_num_splits == 0) { return 0; }
+  return elapsed_cs - ghost_split_cs[(lap < ghost_num_splits) ? lap : ghost_num_splits-1];
+}
+
+// Follow the ghost as sessions shift down. Call before session_index is
+// decremented. A run already under way keeps the splits it started with,
+// otherwise a deleted ghost is gone from the face at once
+void ghost_session_deleted(uint8_t i) {
+  if (ghost_session == GHOST_NONE || i > ghost_session) { return; }
+  if (i < ghost_session) {
+    ghost_session--;
+    return;
+  }
+  ghost_session = GHOST_NONE;
+  if (!running) { ghost_num_splits = 0; }
+}
+
+// Call after the session memory is read
+void ghost_init(void) {
+  running = false;
+  ghost_session = persist_exists(KEY_GHOST) ? persist_read_int(KEY_GHOST) : GHOST_NONE;
+  if (ghost_session >= session_index) { ghost_session = GHOST_NONE; }
+  ghost_prepare();
+}
+
+void ghost_deinit(void) {
+  energy_count(ENERGY_PERSIST_WRITE, 1);
+  persist_write_int(KEY_GHOST, ghost_session);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef GHOST_H
+#define GHOST_H
+#include "stopwatch.h"
+
+#define GHOST_NONE 0xFF
+
+// Persist data keys
+#define KEY_GHOST 380
+
+extern bool ghost_is_active(void);
+extern uint8_t ghost_get_session(void);
+extern void ghost_set_session(uint8_t);
+extern void ghost_prepare(void);
+extern void ghost_set_running(bool);
+extern int32_t ghost_delta_cs(uint8_t, int32_t);
+extern void ghost_session_deleted(uint8_t);
+
+extern void ghost_init(void);
+extern void ghost_deinit(void);
+
+#endif
\ No newline at end of file
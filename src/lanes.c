@@ -0,0 +1,142 @@
+#include "pebble.h"
+#include "lanes.h"
+#include "telemetry.h"
+#include "energy.h"
+
+static Lane_t lanes[NUM_LANES];
+static uint8_t lane_count;
+
+// Shared tick source: real time is sampled once per tick for all lanes
+static WatchTime_t time_now;
+
+Lane_t *lanes_get(uint8_t i) {
+  return &lanes[i];
+}
+
+uint8_t lanes_get_count(void) {
+  return lane_count;
+}
+
+void lanes_set_count(uint8_t count) {
+  lane_count = (count < lanes_get_min_count()) ? lanes_get_min_count() :
+               (count > NUM_LANES) ? NUM_LANES : count;
+}
+
+// Hidden lanes must be idle, so the lane count cannot drop below the last busy lane
+uint8_t lanes_get_min_count(void) {
+  uint8_t min_count = MIN_LANES;
+  for (uint8_t i=MIN_LANES; i<NUM_LANES; i++) {
+    if (lanes[i].state != LANE_STATE_IDLE) { min_count = i+1; }
+  }
+  return min_count;
+}
+
+// Elapsed real time of a lane as of the last lanes_tick()
+static WatchTime_t elapsed_watchtime(Lane_t *lane) {
+  int s =  (int)lane->time_offset.s;
+  int ms = (int)lane->time_offset.ms;
+
+  if (lane->state == LANE_STATE_RUN) {
+    s  += (int)time_now.s  - (int)lane->time_start.s;
+    ms += (int)time_now.ms - (int)lane->time_start.ms;
+
+    // Borrow from s, carry over to s
+    while (ms < 0) { ms += 1000; s--; }
+    while (ms >= 1000) { ms -= 1000; s++; }
+  }
+  return (WatchTime_t){(time_t)s, (uint16_t)ms};
+}
+
+SWTime lanes_elapsed(uint8_t i) {
+  WatchTime_t elapsed = elapsed_watchtime(&lanes[i]);
+  return (SWTime){.hour        = (signed int)elapsed.s / 3600,
+                  .minute      = ((signed int)elapsed.s % 3600) / 60,
+                  .second      = (signed int)elapsed.s % 60,
+                  .centisecond = (signed int)elapsed.ms / 10};
+}
+
+// Called once per shared tick, regardless of the number of running lanes
+void lanes_tick(void) {
+  time_ms(&time_now.s, &time_now.ms);
+}
+
+void lanes_start(uint8_t i) {
+  Lane_t *lane = &lanes[i];
+  if (lane->state == LANE_STATE_RUN) { return; }
+  lanes_tick();
+  lane->time_start = store_pack_watchtime(time_now);
+  lane->state = LANE_STATE_RUN;
+}
+
+// Mass start: every idle lane shares the same start timestamp
+void lanes_start_all(void) {
+  lanes_tick();
+  for (uint8_t i=0; i<lane_count; i++) {
+    if (lanes[i].state != LANE_STATE_IDLE) { continue; }
+    lanes[i].time_start = store_pack_watchtime(time_now);
+    lanes[i].state = LANE_STATE_RUN;
+  }
+}
+
+// Return false if the lap memory of the lane is full
+bool lanes_lap(uint8_t i) {
+  Lane_t *lane = &lanes[i];
+  if (lane->state != LANE_STATE_RUN) { return false; }
+  if (lane->num_splits >= LANE_MAX_LAPS-1) { return false; }
+  lanes_tick();
+  lane->split[lane->num_splits] = lanes_elapsed(i);
+  telemetry_lap(i, lane->num_splits, lane->split[lane->num_splits], telemetry_stamp_now());
+  lane->num_splits++;
+  return true;
+}
+
+void lanes_stop(uint8_t i) {
+  Lane_t *lane = &lanes[i];
+  if (lane->state != LANE_STATE_RUN) { return; }
+  lanes_tick();
+  lane->time_offset = store_pack_watchtime(elapsed_watchtime(lane));
+  lane->state = LANE_STATE_STOP;
+}
+
+// Move a stopped lane into the session memory, return false if memory is full
+bool lanes_save(uint8_t i) {
+  Lane_t *lane = &lanes[i];
+  if (lane->state != LANE_STATE_STOP) { return false; }
+
+  // Final split goes into the reserved last slot
+  lane->split[lane->num_splits] = lanes_elapsed(i);
+  if (!commit_session(lane->split, lane->num_splits+1)) { return false; }
+  telemetry_save(i, lane->num_splits+1, lane->split[lane->num_splits], telemetry_stamp_now());
+
+  lanes_reset(i);
+  return true;
+}
+
+void lanes_reset(uint8_t i) {
+  lanes[i] = (Lane_t){
+    .time_start  = {0, 0},
+    .time_offset = {0, 0},
+    .num_splits  = 0,
+    .state       = LANE_STATE_IDLE,
+  };
+}
+
+void lanes_init(void) {
+  for (uint8_t i=0; i<NUM_LANES; i++) {
+    if (persist_exists(KEY_LANE_BASE+i)) {
+      persist_read_data(KEY_LANE_BASE+i, &lanes[i], sizeof(lanes[i]));
+    } else {
+      lanes_reset(i);
+    }
+  }
+  lane_count = persist_exists(KEY_LANE_COUNT) ? persist_read_int(KEY_LANE_COUNT) : 4;
+  lanes_set_count(lane_count);
+}
+
+void lanes_deinit(void) {
+  energy_count(ENERGY_PERSIST_WRITE, NUM_LANES+1);
+  for (uint8_t i=0; i<NUM_LANES; i++) {
+    persist_write_data(KEY_LANE_BASE+i, &lanes[i], sizeof(lanes[i]));
+  }
+  persist_write_int(KEY_LANE_COUNT, lane_count);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef LANES_H
+#define LANES_H
+#include "swtime.h"
+#include "stopwatch.h"
+#include "store_format.h"
+
+#define NUM_LANES      8
+#define MIN_LANES      2
+#define LANE_MAX_LAPS  20
+
+// Persist data keys (KEY_LANE_BASE+0 .. KEY_LANE_BASE+NUM_LANES-1)
+#define KEY_LANE_COUNT 280
+#define KEY_LANE_BASE  281
+
+enum lane_state_e {LANE_STATE_IDLE,
+                   LANE_STATE_RUN,
+                   LANE_STATE_STOP};
+
+// One independent stopwatch ("lane") in multi-athlete mode
+typedef struct Lane {
+  WatchTimeRecord_t time_start;
+  WatchTimeRecord_t time_offset;
+  SWTime split[LANE_MAX_LAPS];  // Recorded splits, the last slot is reserved for the final split
+  uint8_t num_splits;
+  uint8_t state;
+} __attribute__((__packed__)) Lane_t;
+
+extern Lane_t *lanes_get(uint8_t);
+extern uint8_t lanes_get_count(void);
+extern void lanes_set_count(uint8_t);
+extern uint8_t lanes_get_min_count(void);
+
+extern SWTime lanes_elapsed(uint8_t);
+extern void lanes_tick(void);
+
+extern void lanes_start(uint8_t);
+extern void lanes_start_all(void);
+extern bool lanes_lap(uint8_t);
+extern void lanes_stop(uint8_t);
+extern bool lanes_save(uint8_t);
+extern void lanes_reset(uint8_t);
+
+extern void lanes_init(void);
+extern void lanes_deinit(void);
+
+#endif
\ No newline at end of file
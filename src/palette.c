@@ -0,0 +1,16 @@
+#include "pebble.h"
+#include "palette.h"
+#include "stopwatch.h"
+
+static const Palette_t palette_regular  = {GColorBlack, GColorWhite, GCompOpAssign};
+static const Palette_t palette_inverted = {GColorWhite, GColorBlack, GCompOpAssignInverted};
+
+const Palette_t *palette_get(void) {
+  return invert_color ? &palette_inverted : &palette_regular;
+}
+
+// Text layers draw over the window background rather than a box of their own
+void palette_apply_text_layer(TextLayer *text_layer) {
+  text_layer_set_text_color(text_layer, palette_get()->foreground);
+  text_layer_set_background_color(text_layer, GColorClear);
+}
\ No newline at end of file
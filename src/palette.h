@@ -0,0 +1,16 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+#include "pebble.h"
+
+// Colors for the current scheme, picked at draw time instead of inverting the
+// finished frame, so inverted costs the same as regular
+typedef struct Palette {
+  GColor foreground;   // Text and outlines
+  GColor background;   // Window and box fills
+  GCompOp bitmap_op;   // Guide icons are stored black on white
+} Palette_t;
+
+extern const Palette_t *palette_get(void);
+extern void palette_apply_text_layer(TextLayer *);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+// Pacer plan sender
+//
+// Passes a plan fitted off the watch (host/pacer) on to it. The configuration
+// page returns the plan as the hex that pacer prints, already coded the way
+// cdt_decode() reads it (cdt.c).
+
+function planSend(hex) {
+  var bytes = [];
+  for (var i = 0; i + 1 < hex.length; i += 2) {
+    bytes.push(parseInt(hex.substr(i, 2), 16));
+  }
+  Pebble.sendAppMessage({ PLAN: bytes }, function() {
+    console.log('Plan: sent ' + bytes.length + ' bytes');
+  }, function() {
+    console.log('Plan: failed to send');
+  });
+}
+
+Pebble.addEventListener('webviewclosed', function(e) {
+  var config;
+  try {
+    config = JSON.parse(decodeURIComponent(e.response));
+  } catch (err) {
+    return;
+  }
+  if (config && typeof config.plan === 'string' && /^([0-9a-f]{2})+$/i.test(config.plan)) {
+    planSend(config.plan);
+  }
+});
\ No newline at end of file
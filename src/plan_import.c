@@ -0,0 +1,27 @@
+#include "pebble.h"
+#include "plan_import.h"
+#include "cdt.h"
+#include "stopwatch.h"
+#include "comm.h"
+#include "energy.h"
+
+// One pulse for a plan taken, two for one refused. A plan taken mid-run picks
+// up at the lap being run, not the first
+static void received_handler(DictionaryIterator *iter) {
+  Tuple *tuple = dict_find(iter, MSG_KEY_PLAN);
+
+  if (!tuple) { return; }
+  energy_count(ENERGY_VIBE, 1);
+  if (tuple->type == TUPLE_BYTE_ARRAY && cdt_decode(tuple->value->data, tuple->length)) {
+    cdt_resume(get_elapsed_time());
+    vibes_short_pulse();
+  } else {
+    vibes_double_pulse();
+  }
+}
+
+void plan_import_init(void) {
+  comm_register(COMM_OWNER_PLAN, (CommHandlers){
+    .received = received_handler,
+  });
+}
\ No newline at end of file
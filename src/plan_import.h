@@ -0,0 +1,13 @@
+#ifndef PLAN_IMPORT_H
+#define PLAN_IMPORT_H
+#include "comm.h"
+
+// Pacer plans sent from the phone, coded as cdt_encode() codes them (cdt.c).
+// A plan arriving mid-session takes over at the next tick from the time run.
+
+// Same as dict_calc_buffer_size() for one byte array: 1 byte header, 7 bytes per tuple header
+#define PLAN_IMPORT_MAX_BYTES (COMM_INBOX_SIZE - 1 - 7)
+
+extern void plan_import_init(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "pebble.h"
+#include "probe.h"
+
+#ifdef PROBE_ENABLE
+// Bucket i holds durations up to bucket_limit_ms[i], the last one everything longer
+static const uint16_t bucket_limit_ms[PROBE_NUM_BUCKETS] = {0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 0xFFFF};
+static const char *probe_name[PROBE_SIZE] = {"Tick", "Watchface", "Record Lap", "Menu Draw", "Work Queue"};
+
+typedef struct Probe {
+  uint32_t count;
+  uint16_t max_ms;
+  uint16_t bucket[PROBE_NUM_BUCKETS];
+} Probe;
+
+static Probe probe[PROBE_SIZE];
+
+static uint32_t now_ms(void) {
+  time_t s;
+  uint16_t ms = time_ms(&s, NULL);
+  return (uint32_t)s*1000 + ms;
+}
+
+ProbeScope probe_begin(uint8_t p) {
+  return (ProbeScope){.probe=p, .start_ms=now_ms()};
+}
+
+void probe_end(ProbeScope *scope) {
+  Probe *pr = &probe[scope->probe];
+  uint32_t elapsed = now_ms() - scope->start_ms;
+  uint8_t i = 0;
+
+  while (elapsed > bucket_limit_ms[i]) { i++; }
+  // Halve every bucket rather than let one wrap, keeping the shape
+  if (pr->bucket[i] == 0xFFFF) {
+    for (uint8_t j=0; j<PROBE_NUM_BUCKETS; j++) { pr->bucket[j] /= 2; }
+  }
+  pr->bucket[i]++;
+  pr->count++;
+  if (elapsed > pr->max_ms) { pr->max_ms = (elapsed > 0xFFFF) ? 0xFFFF : elapsed; }
+}
+
+static uint16_t percentile(Probe *pr, uint8_t pct) {
+  uint32_t total = 0, seen = 0;
+  for (uint8_t i=0; i<PROBE_NUM_BUCKETS; i++) { total += pr->bucket[i]; }
+  for (uint8_t i=0; i<PROBE_NUM_BUCKETS; i++) {
+    seen += pr->bucket[i];
+    if (seen*100 >= total*pct) {
+      return (bucket_limit_ms[i] < pr->max_ms) ? bucket_limit_ms[i] : pr->max_ms;
+    }
+  }
+  return pr->max_ms;
+}
+
+const char *probe_get_name(uint8_t p) {
+  return probe_name[p];
+}
+
+ProbeStats probe_get_stats(uint8_t p) {
+  Probe *pr = &probe[p];
+  if (pr->count == 0) { return (ProbeStats){0, 0, 0, 0}; }
+  return (ProbeStats){
+    .count = pr->count,
+    .p50_ms = percentile(pr, 50),
+    .p99_ms = percentile(pr, 99),
+    .max_ms = pr->max_ms,
+  };
+}
+
+void probe_log_dump(void) {
+  for (uint8_t p=0; p<PROBE_SIZE; p++) {
+    ProbeStats s = probe_get_stats(p);
+    APP_LOG(APP_LOG_LEVEL_INFO, "probe %s count=%u p50=%u p99=%u max=%u ms",
+            probe_name[p], (unsigned)s.count, s.p50_ms, s.p99_ms, s.max_ms);
+    for (uint8_t i=0; i<PROBE_NUM_BUCKETS; i++) {
+      if (probe[p].bucket[i] == 0) { continue; }
+      APP_LOG(APP_LOG_LEVEL_INFO, "probe %s <=%u ms: %u", probe_name[p], bucket_limit_ms[i], probe[p].bucket[i]);
+    }
+  }
+}
+
+void probe_reset(void) {
+  memset(probe, 0, sizeof(probe));
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef PROBE_H
+#define PROBE_H
+#include "pebble.h"
+
+// Hot-path timing probes, built only with PROBE_ENABLE defined (see wscript).
+// PROBE_SCOPE(p) at the top of a function times it to its closing brace, any
+// return included; without PROBE_ENABLE it expands to nothing.
+
+#define PROBE_NUM_BUCKETS 12
+
+enum probe_e {PROBE_TIMER_CALLBACK,
+              PROBE_WATCHFACE_UPDATE,
+              PROBE_RECORD_LAP,
+              PROBE_MENU_DRAW,
+              PROBE_WORKQ_SLICE,
+              PROBE_SIZE};
+
+typedef struct ProbeStats {
+  uint32_t count;
+  uint16_t p50_ms;    // Upper bound of the bucket holding the percentile
+  uint16_t p99_ms;
+  uint16_t max_ms;
+} ProbeStats;
+
+#ifdef PROBE_ENABLE
+typedef struct ProbeScope {
+  uint8_t probe;
+  uint32_t start_ms;
+} ProbeScope;
+
+extern ProbeScope probe_begin(uint8_t);
+extern void probe_end(ProbeScope *);
+extern const char *probe_get_name(uint8_t);
+extern ProbeStats probe_get_stats(uint8_t);
+extern void probe_log_dump(void);
+extern void probe_reset(void);
+
+#define PROBE_SCOPE(p) ProbeScope probe_scope __attribute__((cleanup(probe_end))) = probe_begin(p)
+#else
+#define PROBE_SCOPE(p)
+#endif
+
+#endif
\ No newline at end of file
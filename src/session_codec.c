@@ -0,0 +1,99 @@
+#include "session_codec.h"
+
+// LEB128-style unsigned varint: 7 bits per byte, MSB set if more bytes follow
+bool codec_put_varint(CodecWriter *w, uint32_t value) {
+  uint16_t len = w->len;
+  do {
+    if (len >= w->cap) { return false; }
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    w->buf[len++] = byte | ((value != 0) ? 0x80 : 0);
+  } while (value != 0);
+  w->len = len;
+  return true;
+}
+
+// Zigzag mapping keeps small negative deltas small: 0,-1,1,-2,... -> 0,1,2,3,...
+bool codec_put_svarint(CodecWriter *w, int32_t value) {
+  return codec_put_varint(w, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+bool codec_get_varint(CodecReader *r, uint32_t *value) {
+  uint32_t result = 0;
+  for (uint8_t shift=0; shift < 7*CODEC_VARINT_MAX; shift += 7) {
+    if (r->pos >= r->len) { return false; }
+    uint8_t byte = r->buf[r->pos++];
+    result |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool codec_get_svarint(CodecReader *r, int32_t *value) {
+  uint32_t zigzag;
+  if (!codec_get_varint(r, &zigzag)) { return false; }
+  *value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+  return true;
+}
+
+// Write a chunk header; chunk->num_laps is patched in as laps are added
+// On failure the writer is left untouched
+bool codec_chunk_begin(CodecWriter *w, CodecChunk *chunk) {
+  uint16_t len = w->len;
+  chunk->num_laps = 0;
+  chunk->prev_lap = 0;
+
+  if (!codec_put_varint(w, chunk->session) || (w->len+2 > w->cap)) {
+    w->len = len;
+    return false;
+  }
+  w->buf[w->len++] = chunk->first_lap;
+  chunk->num_laps_pos = w->len;
+  w->buf[w->len++] = 0;
+
+  if (chunk->first_lap == 0) {
+    if (!codec_put_varint(w, chunk->save_time) || (w->len+1 > w->cap)) {
+      w->len = len;
+      return false;
+    }
+    w->buf[w->len++] = chunk->total_laps;
+  }
+  return true;
+}
+
+// Return false (writer untouched) if the lap does not fit
+bool codec_chunk_put_lap(CodecWriter *w, CodecChunk *chunk, int32_t lap) {
+  if (chunk->num_laps >= CODEC_CHUNK_MAX_LAPS) { return false; }
+  if (!codec_put_svarint(w, lap - chunk->prev_lap)) { return false; }
+  chunk->prev_lap = lap;
+  w->buf[chunk->num_laps_pos] = ++chunk->num_laps;
+  return true;
+}
+
+bool codec_chunk_read(CodecReader *r, CodecChunk *chunk) {
+  uint32_t value;
+  if (!codec_get_varint(r, &value)) { return false; }
+  chunk->session = (uint16_t)value;
+  if (r->pos+2 > r->len) { return false; }
+  chunk->first_lap = r->buf[r->pos++];
+  chunk->num_laps  = r->buf[r->pos++];
+  chunk->prev_lap  = 0;
+
+  if (chunk->first_lap == 0) {
+    if (!codec_get_varint(r, &chunk->save_time)) { return false; }
+    if (r->pos+1 > r->len) { return false; }
+    chunk->total_laps = r->buf[r->pos++];
+  }
+  return true;
+}
+
+bool codec_chunk_get_lap(CodecReader *r, CodecChunk *chunk, int32_t *lap) {
+  int32_t delta;
+  if (!codec_get_svarint(r, &delta)) { return false; }
+  chunk->prev_lap += delta;
+  *lap = chunk->prev_lap;
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef SESSION_CODEC_H
+#define SESSION_CODEC_H
+#include <stdint.h>
+#include <stdbool.h>
+
+// Compact binary encoding of sessions for transfer off the watch
+//
+// A packet is a sequence of self-contained chunks, so any packet can be decoded
+// (or retransmitted) on its own:
+//   varint  session id (see sync.h)
+//   uint8   first lap in this chunk (0-based)
+//   uint8   number of laps in this chunk
+//   [first lap == 0 only] varint save time, uint8 total laps in session
+//   svarint lap time minus previous lap time (centiseconds), per lap
+// The first lap of every chunk is delta-coded against zero.
+
+#define CODEC_VARINT_MAX 5
+#define CODEC_CHUNK_MAX_LAPS 255
+
+typedef struct CodecWriter {
+  uint8_t *buf;
+  uint16_t cap;
+  uint16_t len;
+} CodecWriter;
+
+typedef struct CodecReader {
+  const uint8_t *buf;
+  uint16_t len;
+  uint16_t pos;
+} CodecReader;
+
+typedef struct CodecChunk {
+  uint16_t session;
+  uint8_t first_lap;
+  uint8_t num_laps;
+  uint8_t total_laps;   // Valid only if first_lap == 0
+  uint32_t save_time;   // Valid only if first_lap == 0
+  uint16_t num_laps_pos;
+  int32_t prev_lap;
+} CodecChunk;
+
+extern bool codec_put_varint(CodecWriter *, uint32_t);
+extern bool codec_put_svarint(CodecWriter *, int32_t);
+extern bool codec_get_varint(CodecReader *, uint32_t *);
+extern bool codec_get_svarint(CodecReader *, int32_t *);
+
+extern bool codec_chunk_begin(CodecWriter *, CodecChunk *);
+extern bool codec_chunk_put_lap(CodecWriter *, CodecChunk *, int32_t);
+extern bool codec_chunk_read(CodecReader *, CodecChunk *);
+extern bool codec_chunk_get_lap(CodecReader *, CodecChunk *, int32_t *);
+
+#endif
\ No newline at end of file
@@ -3,6 +3,23 @@
 #include "cdt.h"
 #include "ui_instant_recall.h"
 #include "ui_main_menu.h"
+#include "lanes.h"
+#include "chute.h"
+#include "chute_export.h"
+#include "comm.h"
+#include "export.h"
+#include "plan_import.h"
+#include "sync.h"
+#include "telemetry.h"
+#include "probe.h"
+#include "energy.h"
+#include "workq.h"
+#include "palette.h"
+#include "summary.h"
+#include "ghost.h"
+#include "training.h"
+#include "store_format.h"
+#include "layout.auto.h"
 
 // Enums
 enum enum_sw_state {SW_STATE_IDLE,
@@ -18,11 +35,10 @@ enum warning_flag_e {WARNING_FLAG_IDLE,
                      WARNING_FLAG_LAP};
 
 // Typedefs
+// Frames and fonts are in the const layout tables (layout.auto.h)
 typedef struct WatchfaceDigit {
-  GRect frame;
-  GFont font;
   char str[2];
-} __attribute__((__packed__)) WatchfaceDigit_t;
+} WatchfaceDigit_t;
 
 // Time components
 typedef struct Stopwatch {
@@ -31,7 +47,16 @@ typedef struct Stopwatch {
   WatchTime_t time_start;
   WatchTime_t time_offset;
   uint8_t sw_state;
-} __attribute__((__packed__)) Stopwatch_t;
+} Stopwatch_t;
+
+// Stopwatch_t as stored under KEY_STOPWATCH
+typedef struct StopwatchRecord {
+  WatchTimeRecord_t time_elapsed;
+  WatchTimeRecord_t time_current;
+  WatchTimeRecord_t time_start;
+  WatchTimeRecord_t time_offset;
+  uint8_t sw_state;
+} __attribute__((__packed__)) StopwatchRecord_t;
 
 // Helper function declaration
 static void window_load(Window *);
@@ -39,6 +64,7 @@ static void window_appear(Window *);
 static void window_disappear(Window *);
 static void window_unload(Window *);
 static void move_to_state(uint8_t);
+static void glance_wake(signed int);
 static void update_display_guide(uint8_t);
 
 static Window *window;
@@ -50,7 +76,7 @@ static char text_header[3][11];
 // Main watch face
 static Layer *layer_watchface;
 static WatchfaceDigit_t watchface_digit[NUM_ROWS][NUM_DIGITS];
-static WatchfaceDigit_t watchface_delimiter[NUM_ROWS][NUM_DELIMITERS];
+static GFont watchface_font[LAYOUT_FACE_FONTS];
 static char watchface_row_text[NUM_ROWS][9];
 
 // Guide bitmap on the right side
@@ -67,37 +93,199 @@ static GBitmap *gbitmap_view;
 static Layer *layer_warning;
 static char *warning_font_key;
 static char warning_str_title[7];
-static char warning_str_value[28];
-static char warning_str_name[16];
+static char warning_str_value[40];
+static char warning_str_name[24];
 static uint8_t warning_flag;
 static signed int ms_to_clear_warning;
 
-// Color inversion layer
-static InverterLayer *inverter_layer;
-
 static AppTimer *timer;
 static Stopwatch_t stopwatch;
 
+// Glance mode: whole seconds at 1 Hz while running and nobody is looking
+static bool glance;
+static signed int ms_to_glance;
+
 // Displayed stopwatch time, and lap memory
 static SWTime sw_elapsed = {0, 0, 0, 0};
 
 // Lap memory-related components
-SWTime    split_memory[NUM_LAP_MEMORY+1]; // +1 to be extra safe
+int32_t   split_cs[NUM_LAP_MEMORY+1]; // +1 to be extra safe
 Session_t session[NUM_LAP_MEMORY];
 time_t    save_time[NUM_LAP_MEMORY];
 uint8_t   session_index;
+static uint64_t session_pinned;  // Bit i set when saved session i is kept from eviction
+static uint8_t  saves_pending;   // Newest saved sessions whose bookkeeping is still queued
 
 // 0 for white background, 1 for black background
 bool invert_color;
 
+int32_t get_lap_cs(Session_t s, uint8_t abs_lap_index) {
+  if (s.start_index == abs_lap_index) { return split_cs[abs_lap_index]; }
+  return split_cs[abs_lap_index] - split_cs[abs_lap_index-1];
+}
+
 SWTime get_lap_time(Session_t s, uint8_t abs_lap_index) {
-  SWTime lap_time = (SWTime){0,0,0,0};
-  if (s.start_index == abs_lap_index) {
-    lap_time = split_memory[abs_lap_index];
+  return SWTime_from_centisecond(get_lap_cs(s, abs_lap_index));
+}
+
+// Elapsed time of the run as of the last tick, zero before the start
+SWTime get_elapsed_time(void) {
+  return SWTime_from_centisecond((int32_t)stopwatch.time_elapsed.s*100 + stopwatch.time_elapsed.ms/10);
+}
+
+bool session_is_pinned(uint8_t i) {
+  return (session_pinned >> i) & 1;
+}
+
+// False, and nothing changes, if the pinned sessions would take more than
+// MAX_PINNED_LAPS of the lap memory
+bool session_set_pinned(uint8_t i, bool pinned) {
+  if (pinned && !session_is_pinned(i)) {
+    uint8_t laps = session[i].end_index - session[i].start_index + 1;
+    for (uint8_t j=0; j<session_index; j++) {
+      if (session_is_pinned(j)) { laps += session[j].end_index - session[j].start_index + 1; }
+    }
+    if (laps > MAX_PINNED_LAPS) { return false; }
+  }
+  session_pinned = pinned ? (session_pinned | (1ULL << i)) : (session_pinned & ~(1ULL << i));
+  return true;
+}
+
+// Take a saved session out and shift the later ones down, including the session
+// in progress. An eviction only makes room: the phone keeps its copy and the
+// training log keeps the work done. The shift is linear, at most NUM_LAP_MEMORY
+// splits and sessions and the parallel arrays of the modules below, and an
+// eviction runs it from the work queue, never from a lap or save press
+static void remove_session(uint8_t index, bool evict) {
+  int shift_down = session[index].end_index - session[index].start_index + 1;
+
+  // An export in flight walks the session memory by index
+  export_cancel();
+  if (evict) {
+    sync_session_evicted(index);
   } else {
-    lap_time = SWTime_subtract(split_memory[abs_lap_index], split_memory[abs_lap_index-1]);
+    sync_session_deleted(index);
+    training_session_deleted(save_time[index], &summary_get(index)->summary);
   }
-  return lap_time;
+  energy_session_deleted(index);
+  summary_session_deleted(index);
+  ghost_session_deleted(index);
+  for (uint16_t i=index+1; i<=session_index; i++) {
+    for (int src_index=session[i].start_index; src_index<=session[i].end_index; src_index++) {
+      int dst_index = src_index - shift_down;
+      split_cs[dst_index] = split_cs[src_index];
+    }
+    session[i-1].start_index = session[i].start_index - shift_down;
+    session[i-1].end_index   = session[i].end_index   - shift_down;
+    save_time[i-1] = save_time[i];
+  }
+  session_pinned = (session_pinned & ((1ULL << index) - 1)) | ((session_pinned >> (index+1)) << index);
+
+  session_index--;
+}
+
+// Remove a saved session at the user's request. Jobs still waiting on the
+// queue were posted with the indexes as they are now
+void delete_session(uint8_t index) {
+  workq_flush();
+  remove_session(index, false);
+}
+
+// Oldest saved session that is not pinned, session_index if there is none. A
+// session saved with its bookkeeping still queued is not one to evict yet
+static uint8_t oldest_unpinned_session(void) {
+  uint8_t i = 0;
+  while ((i < session_index-saves_pending) && session_is_pinned(i)) { i++; }
+  return (i < session_index-saves_pending) ? i : session_index;
+}
+
+static bool evict_oldest_session(void) {
+  uint8_t i = oldest_unpinned_session();
+  if (i >= session_index) { return false; }
+  remove_session(i, true);
+  return true;
+}
+
+// Merge the first two laps of the session in progress, keeping its later splits
+static bool fold_first_lap(void) {
+  Session_t *s = &session[session_index];
+  if (s->end_index - s->start_index < 2) { return false; }
+  for (uint8_t i=s->start_index; i<s->end_index; i++) {
+    split_cs[i] = split_cs[i+1];
+  }
+  s->end_index--;
+  return true;
+}
+
+static bool lap_memory_full(void) {
+  return session[session_index].end_index >= NUM_LAP_MEMORY-1;
+}
+
+// Fewer than LAP_HEADROOM free splits left ahead of a run, or no free session
+// slot for the next save. Idle, the splits wait for the run, so a session just
+// saved is not evicted to make room for a run that may not come
+static bool lap_memory_low(void) {
+  return ((stopwatch.sw_state != SW_STATE_IDLE) &&
+          (session[session_index].end_index >= NUM_LAP_MEMORY-1-LAP_HEADROOM)) ||
+         (session_index >= NUM_LAP_MEMORY-1);
+}
+
+// Free splits for the session in progress and a free slot to save it in,
+// made as a run starts, laps into the last LAP_HEADROOM splits or a save takes
+// the last slot, rather than by the press that needs them. Saved sessions go,
+// oldest first and pinned ones excepted. Run from the work queue after the
+// jobs posted before it, so the shifts never pull an index from under them
+static bool room_posted;
+
+static void make_room_job(uint32_t arg) {
+  room_posted = false;
+  while (lap_memory_low() && evict_oldest_session()) {}
+}
+
+// Evicting, and the sync, energy, summary and ghost bookkeeping that follows,
+// is left to the work queue so a lap or save press only takes what is reserved
+static void reserve_lap_slot(void) {
+  if (room_posted || !lap_memory_low() || oldest_unpinned_session() >= session_index) { return; }
+  room_posted = true;
+  workq_post(WORKQ_PRIORITY_BOOKKEEPING, make_room_job, 0);
+}
+
+// A free session slot for the session saved next. The eviction after each save
+// keeps one, unless only pinned sessions are left
+static bool can_save(void) {
+  return (session[session_index].end_index < NUM_LAP_MEMORY) && (session_index < NUM_LAP_MEMORY-1);
+}
+
+// Insert a finished session in front of the session in progress, evicting
+// saved sessions to make room. Return false if there is no room even so.
+bool commit_session(const SWTime *splits, uint8_t num_splits) {
+  if (num_splits == 0) { return false; }
+  // The session in progress moves up, settle the jobs posted for it first
+  workq_flush();
+  while ((session[session_index].end_index + num_splits >= NUM_LAP_MEMORY) ||
+         (session_index >= NUM_LAP_MEMORY-1)) {
+    if (!evict_oldest_session()) { return false; }
+  }
+  Session_t current = session[session_index];
+
+  // Shift the session in progress up, then fill the gap
+  for (int i=current.end_index; i>=current.start_index; i--)
+    split_cs[i+num_splits] = split_cs[i];
+  for (int i=0; i<num_splits; i++)
+    split_cs[current.start_index+i] = SWTime_to_centisecond(splits[i]);
+
+  session[session_index].end_index = current.start_index + num_splits - 1;
+  save_time[session_index] = time(NULL);
+  sync_session_created(session_index);
+  energy_session_inserted(session_index);
+  energy_session_saved(session_index);
+  summary_session_saved(session_index);
+  training_session_saved(save_time[session_index], &summary_get(session_index)->summary);
+
+  session_index++;
+  session[session_index].start_index = current.start_index + num_splits;
+  session[session_index].end_index   = current.end_index + num_splits;
+  return true;
 }
 
 // Short-hand for setting warning text layer
@@ -151,90 +339,153 @@ static void update_time(void) {
   sw_elapsed.second      = (signed int)stopwatch.time_elapsed.s % 60;
   sw_elapsed.centisecond = (signed int)stopwatch.time_elapsed.ms / 10;
   
-  // split_memory at session[session_index].end_index is displayed as current split time
-  split_memory[session[session_index].end_index] = sw_elapsed;
+  // The split at session[session_index].end_index is displayed as current split time
+  split_cs[session[session_index].end_index] = (int32_t)stopwatch.time_elapsed.s*100 + stopwatch.time_elapsed.ms/10;
   
   // Update countdown timer
   cdt_update(sw_elapsed);
 }
 
-// Short-hand to record a lap
-static void record_lap() {
-  char substr[11];
+// "+h:mm:ss", "+m:ss" or "+s" line of the lap overlay, ahead of a target when minus
+static void format_lap_delta(char *str, size_t size, bool minus, SWTime delta) {
+  if (delta.hour > 0) {
+    snprintf(str, size, "%s%d:%02d:%02d\n", minus ? "-" : "+", delta.hour, delta.minute, delta.second);
+  } else if (delta.minute > 0) {
+    snprintf(str, size, "%s%d:%02d\n", minus ? "-" : "+", delta.minute, delta.second);
+  } else {
+    snprintf(str, size, "%s%d\n", minus ? "-" : "+", delta.second);
+  }
+}
+
+// Format the lap overlay for the lap that ended at abs_lap_index. Skipped if a
+// later lap or a stop got in first, the overlay would be stale
+static void show_lap(uint32_t abs_lap_index) {
+  char substr[12];
   cdt_t *cdt = cdt_get();
+  
+  if ((stopwatch.sw_state != SW_STATE_LAP_RECORD) ||
+      (abs_lap_index != (uint32_t)session[session_index].end_index-1)) { return; }
+  
+  uint8_t prev_abs_lap_index = abs_lap_index;
+  uint8_t prev_rel_lap_index = prev_abs_lap_index - session[session_index].start_index;
+  SWTime prev_split_time = SWTime_from_centisecond(split_cs[prev_abs_lap_index]);
+  SWTime prev_lap_time = get_lap_time(session[session_index], prev_abs_lap_index);
+  
+  // Header message
+  snprintf(warning_str_title, sizeof(warning_str_title),
+           "LAP %d\n", prev_rel_lap_index+1);
+  
+  strcpy(warning_str_value, "");
+  strcpy(warning_str_name, "");
+
+  // Offset from the ghost's split at the same lap
+  if (ghost_is_active()) {
+    int32_t ghost_delta = ghost_delta_cs(prev_rel_lap_index, SWTime_to_centisecond(prev_split_time));
+    format_lap_delta(substr, sizeof(substr), ghost_delta < 0,
+                     SWTime_from_centisecond((ghost_delta < 0) ? -ghost_delta : ghost_delta));
+    strcat(warning_str_value, substr);
+    strcat(warning_str_name, "Ghost\n");
+  }
+
+  // Calculate target split at previous timer index
+  if (cdt->enable) {
+    // Single mode holds at the end of the plan, repeat mode loops over it
+    SWTime prev_cdt_target_split = cdt_get_split(prev_rel_lap_index+1);
+    SWTime cdt_delta = (SWTime){0, 0, 0, 0};
+    bool cdt_delta_minus = false;
+    cdt_delta_minus = (SWTime_compare(prev_split_time, prev_cdt_target_split) == -1);
+    cdt_delta = cdt_delta_minus ? 
+                SWTime_subtract(prev_cdt_target_split, prev_split_time) : 
+                SWTime_subtract(prev_split_time, prev_cdt_target_split);
+  
+    // Offset from target timer split
+    format_lap_delta(substr, sizeof(substr), cdt_delta_minus, cdt_delta);
+    strcat(warning_str_value, substr);
+    strcat(warning_str_name, "Timer\n");
+  }
+  strcat(warning_str_name, "Split\nLap");
+  
+  // Display split time
+  if (prev_split_time.hour > 0)
+    snprintf(substr, sizeof(substr), "%d:%02d:%02d\n", prev_split_time.hour, prev_split_time.minute, prev_split_time.second);
+  else
+    snprintf(substr, sizeof(substr), "%d:%02d\n", prev_split_time.minute, prev_split_time.second);
+  strcat(warning_str_value, substr);
+  
+  // Display lap time
+  if (prev_lap_time.hour > 0)
+    snprintf(substr, sizeof(substr), "%d:%02d:%02d\n", prev_lap_time.hour, prev_lap_time.minute, prev_lap_time.second);
+  else
+    snprintf(substr, sizeof(substr), "%d:%02d\n", prev_lap_time.minute, prev_lap_time.second);
+  strcat(warning_str_value, substr);
+  
+  // Push temporary warning message
+  set_warning_lap(FONT_KEY_GOTHIC_24_BOLD);
+}
+
+// Telemetry for the phone, taken when the button went down and sent from the
+// work queue. The events wait here rather than as indexes into the session
+// memory, which an eviction or a delete may shift before the job runs. Each
+// job sends the oldest event: a job run at once from a full ring still keeps
+// them in order. Room for a full BACKGROUND ring and the job being posted
+typedef struct StreamEvent {
+  uint8_t kind;         // TELEMETRY_KIND_LAP or TELEMETRY_KIND_SAVE
+  uint8_t lap;          // Relative lap index, or lap count of a save
+  int32_t split_cs;
+  uint32_t stamp_ms;
+} StreamEvent;
+
+#define STREAM_QUEUE_SIZE (WORKQ_RING_SIZE+1)
+
+static StreamEvent stream_queue[STREAM_QUEUE_SIZE];
+static uint8_t stream_head;
+static uint8_t stream_count;
+
+static void stream_job(uint32_t arg) {
+  if (stream_count == 0) { return; }
+  StreamEvent e = stream_queue[stream_head];
+  stream_head = (stream_head+1) % STREAM_QUEUE_SIZE;
+  stream_count--;
+  if (e.kind == TELEMETRY_KIND_LAP) {
+    telemetry_lap(TELEMETRY_LANE_MAIN, e.lap, SWTime_from_centisecond(e.split_cs), e.stamp_ms);
+  } else {
+    telemetry_save(TELEMETRY_LANE_MAIN, e.lap, SWTime_from_centisecond(e.split_cs), e.stamp_ms);
+  }
+}
+
+static void post_stream(uint8_t kind, uint8_t lap, int32_t split_cs, uint32_t stamp_ms) {
+  stream_queue[(stream_head+stream_count) % STREAM_QUEUE_SIZE] = (StreamEvent){kind, lap, split_cs, stamp_ms};
+  stream_count++;
+  workq_post(WORKQ_PRIORITY_BACKGROUND, stream_job, 0);
+}
+
+// Short-hand to record a lap: only the timestamp is taken here, the overlay
+// and the telemetry follow from the work queue so a quick next lap press is
+// not held up by them
+static void record_lap() {
+  PROBE_SCOPE(PROBE_RECORD_LAP);
 
   update_time();
+  uint32_t stamp_ms = telemetry_stamp_now();
+  // The eviction keeps LAP_HEADROOM splits free ahead of the press, which never
+  // waits on it. A press that finds none, with only pinned sessions left or
+  // faster than the queue, merges the first laps of this session instead, so
+  // a lap can always be recorded
+  if (lap_memory_full()) { fold_first_lap(); }
   if (session[session_index].end_index<NUM_LAP_MEMORY-1) {
     session[session_index].end_index++;
     
     uint8_t prev_abs_lap_index = session[session_index].end_index - 1;
     uint8_t prev_rel_lap_index = prev_abs_lap_index - session[session_index].start_index;
-
-    // Push temporary lap record message
-    SWTime prev_split_time = split_memory[prev_abs_lap_index];
-    SWTime prev_lap_time = get_lap_time(session[session_index], prev_abs_lap_index);
-    
-    // Header message
-    snprintf(warning_str_title, sizeof(warning_str_title),
-             "LAP %d\n", prev_rel_lap_index+1);
-    
-    // Calculate target split at previous timer index
-    if (cdt->enable) {
-      SWTime prev_cdt_target_split = (SWTime){0, 0, 0, 0};
-      SWTime cdt_delta = (SWTime){0, 0, 0, 0};
-      bool cdt_delta_minus = false;
-      cdt_t *cdt = cdt_get();
-      
-      for (uint8_t i = 0; i<=prev_rel_lap_index; i++) {
-        // Break condition for single mode: iterator i at cdt_length or higher
-        if (!cdt->repeat && (i >= cdt->length)) { break; }
-        
-        // Below formula looks strange first, but it considers loop-over in repeat mode
-        prev_cdt_target_split = SWTime_add(prev_cdt_target_split, cdt_get_lap(i%cdt->length));
-      }
-      cdt_delta_minus = (SWTime_compare(prev_split_time, prev_cdt_target_split) == -1);
-      cdt_delta = cdt_delta_minus ? 
-                  SWTime_subtract(prev_cdt_target_split, prev_split_time) : 
-                  SWTime_subtract(prev_split_time, prev_cdt_target_split);
-    
-      // Offset from target timer split
-      if (cdt_delta.hour > 0) {
-        snprintf(substr, sizeof(substr), "%d:%02d:%02d\n",
-                 cdt_delta.hour, cdt_delta.minute, cdt_delta.second);
-      } else if (cdt_delta.minute > 0) {
-        snprintf(substr, sizeof(substr), "%d:%02d\n", cdt_delta.minute, cdt_delta.second);
-      } else {
-        snprintf(substr, sizeof(substr), "%d\n", cdt_delta.second);
-      }
-      strcpy(warning_str_value, cdt_delta_minus ? "-" : "+");
-      strcat(warning_str_value, substr);
-      strcpy(warning_str_name, "Timer\nSplit\nLap");
-    } else {
-      strcpy(warning_str_value,  "");
-      strcpy(warning_str_name, "Split\nLap");
-    }
-    
-    // Display split time
-    if (prev_split_time.hour > 0)
-      snprintf(substr, sizeof(substr), "%d:%02d:%02d\n", prev_split_time.hour, prev_split_time.minute, prev_split_time.second);
-    else
-      snprintf(substr, sizeof(substr), "%d:%02d\n", prev_split_time.minute, prev_split_time.second);
-    strcat(warning_str_value, substr);
-    
-    // Display lap time
-    if (prev_lap_time.hour > 0)
-      snprintf(substr, sizeof(substr), "%d:%02d:%02d\n", prev_lap_time.hour, prev_lap_time.minute, prev_lap_time.second);
-    else
-      snprintf(substr, sizeof(substr), "%d:%02d\n", prev_lap_time.minute, prev_lap_time.second);
-    strcat(warning_str_value, substr);
-    
-    // Push temporary warning message
-    set_warning_lap(FONT_KEY_GOTHIC_24_BOLD);
+    workq_post(WORKQ_PRIORITY_UI, show_lap, prev_abs_lap_index);
+    post_stream(TELEMETRY_KIND_LAP, prev_rel_lap_index, split_cs[prev_abs_lap_index], stamp_ms);
     ms_to_clear_warning = 5000;
+    reserve_lap_slot();
   } else {
-    // Push temporary warning message
+    // Only if the lap memory was pinned full before pinning had its limit
     set_warning_text(FONT_KEY_GOTHIC_24_BOLD, "OUT\nOF\nMEMORY");
     ms_to_clear_warning = 5000;
+    energy_count(ENERGY_VIBE, 1);
     vibes_short_pulse();
   }
 }
@@ -247,16 +498,20 @@ static void stop_sw() {
 }
 
 static void layer_watchface_update_callback(Layer *layer, GContext *ctx) {
-  graphics_context_set_text_color(ctx, GColorBlack);
+  PROBE_SCOPE(PROBE_WATCHFACE_UPDATE);
+  energy_count(ENERGY_REDRAW, 1);
+  energy_count(ENERGY_TEXT_DRAW, NUM_ROWS*NUM_DIGITS);
+  graphics_context_set_text_color(ctx, palette_get()->foreground);
   for (int i=0; i<NUM_ROWS; i++) {
     for (int j=0; j<NUM_DIGITS; j++) {
-      graphics_draw_text(ctx, watchface_digit[i][j].str, watchface_digit[i][j].font, watchface_digit[i][j].frame,
+      graphics_draw_text(ctx, watchface_digit[i][j].str, watchface_font[layout_face_font[i][j]], layout_face_digit[i][j],
                          GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
     }
   }
 }
 
 static void layer_warning_update_callback(Layer *layer, GContext *ctx) {
+  const Palette_t *palette = palette_get();
   GRect frame = layer_get_frame(layer);
   GSize content_size[3];
   GRect resized_text[3], resized_box;
@@ -265,6 +520,8 @@ static void layer_warning_update_callback(Layer *layer, GContext *ctx) {
     case WARNING_FLAG_IDLE: 
       return;
     case WARNING_FLAG_MESSAGE:
+      energy_count(ENERGY_REDRAW, 1);
+      energy_count(ENERGY_TEXT_DRAW, 1);
       content_size[0] = graphics_text_layout_get_content_size(
                           warning_str_value, fonts_get_system_font(warning_font_key), frame,
                           GTextOverflowModeWordWrap, GTextAlignmentCenter);
@@ -274,17 +531,19 @@ static void layer_warning_update_callback(Layer *layer, GContext *ctx) {
                            resized_text[0].size.w+14, resized_text[0].size.h+10);
 
       // Draw bounding box
-      graphics_context_set_fill_color(ctx, GColorWhite);
+      graphics_context_set_fill_color(ctx, palette->background);
       graphics_fill_rect(ctx, resized_box, 0, GCornerNone);
-      graphics_context_set_stroke_color(ctx, GColorBlack);
+      graphics_context_set_stroke_color(ctx, palette->foreground);
       graphics_draw_rect(ctx, resized_box);
   
       // Draw text
-      graphics_context_set_text_color(ctx, GColorBlack);
+      graphics_context_set_text_color(ctx, palette->foreground);
       graphics_draw_text(ctx, warning_str_value, fonts_get_system_font(warning_font_key), resized_text[0],
                          GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
       break;
     case WARNING_FLAG_LAP:
+      energy_count(ENERGY_REDRAW, 1);
+      energy_count(ENERGY_TEXT_DRAW, 3);
       // Get width from title, short, large content
       content_size[0] = graphics_text_layout_get_content_size(
                           warning_str_title, fonts_get_system_font(warning_font_key), frame,
@@ -314,13 +573,13 @@ static void layer_warning_update_callback(Layer *layer, GContext *ctx) {
                            resized_text[0].size.h + resized_text[1].size.h + 10);
     
       // Draw bounding box
-      graphics_context_set_fill_color(ctx, GColorWhite);
+      graphics_context_set_fill_color(ctx, palette->background);
       graphics_fill_rect(ctx, resized_box, 0, GCornerNone);
-      graphics_context_set_stroke_color(ctx, GColorBlack);
+      graphics_context_set_stroke_color(ctx, palette->foreground);
       graphics_draw_rect(ctx, resized_box);
   
       // Draw text
-      graphics_context_set_text_color(ctx, GColorBlack);
+      graphics_context_set_text_color(ctx, palette->foreground);
       graphics_draw_text(ctx, warning_str_title, fonts_get_system_font(warning_font_key), resized_text[0],
                          GTextOverflowModeWordWrap, GTextAlignmentCenter, NULL);
       graphics_draw_text(ctx, warning_str_name, fonts_get_system_font(warning_font_key), resized_text[1],
@@ -333,6 +592,9 @@ static void layer_warning_update_callback(Layer *layer, GContext *ctx) {
 
 void move_to_state(uint8_t state) {
   stopwatch.sw_state = state;
+  if (state != SW_STATE_RUN) { glance_wake(GLANCE_IDLE_MS); }
+  energy_set_active(state != SW_STATE_IDLE);
+  ghost_set_running(state != SW_STATE_IDLE);
   update_display_guide(state);
 }
 
@@ -362,22 +624,41 @@ void update_display_guide(uint8_t state) {
   layer_set_hidden(bitmap_layer_get_layer(bitmap_layer[2]), (state==SW_STATE_IDLE) ? true : false);
 }
 
+// Glance mode shows a row's whole seconds only
+static void hide_centisecond(uint8_t row) {
+  strcpy(watchface_digit[row][5].str, "");
+  strcpy(watchface_digit[row][6].str, "");
+  strcpy(watchface_digit[row][7].str, "");
+}
+
+// Signed h:mm:ss, held at 9:59:59
+static void display_signed_row(uint8_t row, bool plus, SWTime t) {
+  if (t.hour >= 10) {
+    t = (SWTime){.hour=9, .minute=59, .second=59, .centisecond=99};
+  }
+  snprintf(watchface_digit[row][0].str, 2, plus ? "+" : "-");
+  snprintf(watchface_digit[row][1].str, 2, "%d", t.hour%10);
+  snprintf(watchface_digit[row][3].str, 2, "%d", t.minute/10);
+  snprintf(watchface_digit[row][4].str, 2, "%d", t.minute%10);
+  snprintf(watchface_digit[row][6].str, 2, "%d", t.second/10);
+  snprintf(watchface_digit[row][7].str, 2, "%d", t.second%10);
+}
+
 // Update displayed text
 static void update_display(void) {
   uint8_t row;
   cdt_t *cdt = cdt_get();
+  uint8_t rel_lap_index = session[session_index].end_index-session[session_index].start_index;
   
-  // 1st row: display cdt time
+  // 1st row: display the ghost's lead or cdt time
   row = 0;
   strcpy(watchface_digit[row][2].str, ":");
   strcpy(watchface_digit[row][5].str, ":");
-  if (cdt->enable) {
-    snprintf(watchface_digit[row][0].str, 2, (cdt->overflow==true) ? "+" : "-");
-    snprintf(watchface_digit[row][1].str, 2, "%d", cdt->display.hour%10);
-    snprintf(watchface_digit[row][3].str, 2, "%d", cdt->display.minute/10);
-    snprintf(watchface_digit[row][4].str, 2, "%d", cdt->display.minute%10);
-    snprintf(watchface_digit[row][6].str, 2, "%d", cdt->display.second/10);
-    snprintf(watchface_digit[row][7].str, 2, "%d", cdt->display.second%10);
+  if (ghost_is_active()) {
+    int32_t ghost_delta = ghost_delta_cs(rel_lap_index, SWTime_to_centisecond(sw_elapsed));
+    display_signed_row(row, ghost_delta >= 0, SWTime_from_centisecond((ghost_delta < 0) ? -ghost_delta : ghost_delta));
+  } else if (cdt->enable) {
+    display_signed_row(row, cdt->overflow, cdt->display);
   } else {
     strcpy(watchface_digit[row][0].str, " ");
     strcpy(watchface_digit[row][1].str, "-");
@@ -393,22 +674,23 @@ static void update_display(void) {
     snprintf(watchface_digit[row][0].str, 2, "%d", sw_elapsed.hour/10);
     if (sw_elapsed.hour<10) strcpy(watchface_digit[row][0].str, "");
     snprintf(watchface_digit[row][1].str, 2, "%d", sw_elapsed.hour%10);
-    strcpy(watchface_delimiter[row][2].str, ":");
+    strcpy(watchface_digit[row][2].str, ":");
     snprintf(watchface_digit[row][3].str, 2, "%d", sw_elapsed.minute/10);
     snprintf(watchface_digit[row][4].str, 2, "%d", sw_elapsed.minute%10);
-    strcpy(watchface_delimiter[row][5].str, ":");
+    strcpy(watchface_digit[row][5].str, ":");
     snprintf(watchface_digit[row][6].str, 2, "%d", sw_elapsed.second/10);
     snprintf(watchface_digit[row][7].str, 2, "%d", sw_elapsed.second%10);
   } else {
     if (sw_elapsed.minute<10) strcpy(watchface_digit[row][0].str, "");
     else snprintf(watchface_digit[row][0].str, 2, "%d", sw_elapsed.minute/10);
     snprintf(watchface_digit[row][1].str, 2, "%d", sw_elapsed.minute%10);
-    strcpy(watchface_delimiter[row][2].str, ":");
+    strcpy(watchface_digit[row][2].str, ":");
     snprintf(watchface_digit[row][3].str, 2, "%d", sw_elapsed.second/10);
     snprintf(watchface_digit[row][4].str, 2, "%d", sw_elapsed.second%10);
-        strcpy(watchface_delimiter[row][5].str, ".");
+    strcpy(watchface_digit[row][5].str, ".");
     snprintf(watchface_digit[row][6].str, 2, "%d", sw_elapsed.centisecond/10);
     snprintf(watchface_digit[row][7].str, 2, "%d", sw_elapsed.centisecond%10);
+    if (glance) { hide_centisecond(row); }
   }
   
   // 3rd row: display lap time
@@ -418,10 +700,10 @@ static void update_display(void) {
     if (lap_time.hour<10) strcpy(watchface_digit[row][0].str, "");
     else snprintf(watchface_digit[row][0].str, 2, "%d", lap_time.hour/10);
     snprintf(watchface_digit[row][1].str, 2, "%d", lap_time.hour%10);
-    strcpy(watchface_delimiter[row][2].str, ":");
+    strcpy(watchface_digit[row][2].str, ":");
     snprintf(watchface_digit[row][3].str, 2, "%d", lap_time.minute/10);
     snprintf(watchface_digit[row][4].str, 2, "%d", lap_time.minute%10);
-    strcpy(watchface_delimiter[row][5].str, ":");
+    strcpy(watchface_digit[row][5].str, ":");
     snprintf(watchface_digit[row][6].str, 2, "%d", lap_time.second/10);
     snprintf(watchface_digit[row][7].str, 2, "%d", lap_time.second%10);
   } else {
@@ -434,23 +716,64 @@ static void update_display(void) {
     strcpy(watchface_digit[row][5].str, ".");
     snprintf(watchface_digit[row][6].str, 2, "%d", lap_time.centisecond/10);
     snprintf(watchface_digit[row][7].str, 2, "%d", lap_time.centisecond%10);
+    if (glance) { hide_centisecond(row); }
   }
   
   // No need to mark the layer dirty - text_layer_set_text will take care of that
   //layer_mark_dirty(layer_watchface);
-  snprintf(text_header[0], sizeof(text_header[0]), "TIMER %d", (cdt->repeat) ? ((cdt->index)%(cdt->length))+1 : (cdt->index)+1);
+  if (ghost_is_active()) {
+    snprintf(text_header[0], sizeof(text_header[0]), "GHOST %d", rel_lap_index+1);
+  } else {
+    snprintf(text_header[0], sizeof(text_header[0]), "TIMER %d",
+             (cdt->repeat && cdt->length) ? (int)((cdt->index)%(cdt->length))+1 : (int)(cdt->index)+1);
+  }
   text_layer_set_text(text_layer_label[0], text_header[0]);
   snprintf(text_header[1], sizeof(text_header[1]), "SESSION %d", session_index+1);
   text_layer_set_text(text_layer_label[1], text_header[1]);
-  snprintf(text_header[2], sizeof(text_header[2]), "LAP %d",
-           session[session_index].end_index-session[session_index].start_index+1);
+  snprintf(text_header[2], sizeof(text_header[2]), "LAP %d", rel_lap_index+1);
   text_layer_set_text(text_layer_label[2], text_header[2]);
 }
 
-// Called every SW_STEP_MS ms
+// Leave glance mode, and stay out of it for at least ms
+static void glance_wake(signed int ms) {
+  if (ms_to_glance < ms) { ms_to_glance = ms; }
+  if (glance) {
+    glance = false;
+    // Redraw at full rate right away rather than at the next whole second
+    app_timer_reschedule(timer, 0);
+  }
+}
+
+// In glance mode, wake up as the elapsed time turns the next whole second, or
+// as the countdown timer reaches its split if that comes first so the alert is
+// not late
+static uint32_t glance_step_ms(void) {
+  cdt_t *cdt = cdt_get();
+  int32_t ms = SW_STEP_MS_GLANCE - stopwatch.time_elapsed.ms;
+  
+  if (cdt->enable && !cdt->overflow) {
+    int32_t ms_to_split = (SWTime_to_centisecond(cdt->next_split) - SWTime_to_centisecond(sw_elapsed))*10 + 10;
+    if (ms_to_split < ms) { ms = ms_to_split; }
+  }
+  return (ms > 0) ? ms : 1;
+}
+
+static void tap_handler(AccelAxisType axis, int32_t direction) {
+  glance_wake(GLANCE_WAKE_MS);
+}
+
+// Called every SW_STEP_MS_SHORT ms, or every SW_STEP_MS_GLANCE ms in glance mode
 static void timer_callback(void *data) {
+  PROBE_SCOPE(PROBE_TIMER_CALLBACK);
+  energy_count(ENERGY_WAKEUP, 1);
   // Update time and display
   update_time();
+  
+  // Count down to glance mode while running without input
+  if ((stopwatch.sw_state == SW_STATE_RUN) && !glance) {
+    ms_to_glance -= SW_STEP_MS_SHORT;
+    glance = (ms_to_glance <= 0);
+  }
   update_display();
   
   if (stopwatch.sw_state == SW_STATE_LAP_RECORD) {
@@ -462,7 +785,7 @@ static void timer_callback(void *data) {
   }
   
   // Restart timer
-  timer = app_timer_register(SW_STEP_MS_SHORT, timer_callback, NULL);
+  timer = app_timer_register(glance ? glance_step_ms() : SW_STEP_MS_SHORT, timer_callback, NULL);
 }
 
 //----- Begin window load/unload
@@ -477,21 +800,21 @@ static void window_load(Window *window) {
   
   // Set up text_layers for NUM_ROWS rows, NUM_DIGITS digits
   for (int row=0; row < NUM_ROWS; row++) {
-    text_layer_label[row] = text_layer_create(GRect(2, 2+ROW_HEIGHT*row, 60, 14));
+    text_layer_label[row] = text_layer_create(layout_face_label[row]);
     text_layer_set_text_alignment(text_layer_label[row], GTextAlignmentLeft);
     layer_add_child(window_layer, text_layer_get_layer(text_layer_label[row]));
   }
 
   // Add bitmap layers
-  bitmap_layer[0] = bitmap_layer_create(GRect(133, 2, 9, 40));
+  bitmap_layer[0] = bitmap_layer_create(layout_face_guide[0]);
   bitmap_layer_set_alignment(bitmap_layer[0], GAlignTop);
   layer_add_child(window_layer, bitmap_layer_get_layer(bitmap_layer[0]));
   
-  bitmap_layer[1] = bitmap_layer_create(GRect(133, 55, 9, 40));
+  bitmap_layer[1] = bitmap_layer_create(layout_face_guide[1]);
   bitmap_layer_set_alignment(bitmap_layer[1], GAlignCenter);
   layer_add_child(window_layer, bitmap_layer_get_layer(bitmap_layer[1]));
   
-  bitmap_layer[2] = bitmap_layer_create(GRect(133, 109, 9, 40));
+  bitmap_layer[2] = bitmap_layer_create(layout_face_guide[2]);
   bitmap_layer_set_alignment(bitmap_layer[2], GAlignBottom);
   layer_add_child(window_layer, bitmap_layer_get_layer(bitmap_layer[2]));
   
@@ -499,10 +822,6 @@ static void window_load(Window *window) {
   layer_warning = layer_create(frame);
   layer_set_update_proc(layer_warning, layer_warning_update_callback);
   layer_add_child(window_layer, layer_warning);
-  
-  // Add inverter layer
-  inverter_layer = inverter_layer_create(frame);
-  layer_add_child(window_layer, inverter_layer_get_layer(inverter_layer));
 }
 
 static void window_appear(Window *window) {
@@ -516,11 +835,23 @@ static void window_appear(Window *window) {
   gbitmap_view  = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_VIEW);
   
   update_display_guide(stopwatch.sw_state);
-  layer_set_hidden(inverter_layer_get_layer(inverter_layer), invert_color ? 0 : 1);
+  
+  // The color scheme may have changed in the menu
+  const Palette_t *palette = palette_get();
+  window_set_background_color(window, palette->background);
+  for (int row=0; row < NUM_ROWS; row++) {
+    palette_apply_text_layer(text_layer_label[row]);
+  }
+  for (int i=0; i < NUM_GUIDES; i++) {
+    bitmap_layer_set_compositing_mode(bitmap_layer[i], palette->bitmap_op);
+  }
+  glance = false;
+  ms_to_glance = GLANCE_IDLE_MS;
   update_time();
   update_display();
   
   timer = app_timer_register(SW_STEP_MS_SHORT, timer_callback, NULL);
+  accel_tap_service_subscribe(tap_handler);
 }
 
 static void window_disappear(Window *window) {
@@ -533,6 +864,7 @@ static void window_disappear(Window *window) {
   gbitmap_destroy(gbitmap_reset);
   gbitmap_destroy(gbitmap_view);
   
+  accel_tap_service_unsubscribe();
   app_timer_cancel(timer);
 }
 
@@ -544,7 +876,6 @@ static void window_unload(Window *window) {
   for (int i=0; i < NUM_GUIDES; i++)
      bitmap_layer_destroy(bitmap_layer[i]);
   layer_destroy(layer_warning);
-  inverter_layer_destroy(inverter_layer);
 }
 //----- End window load/unload
 
@@ -554,8 +885,10 @@ static void single_click_handler(ClickRecognizerRef recognizer, void *context) {
   switch (stopwatch.sw_state) {
     case SW_STATE_IDLE:
       if (button_id == BUTTON_ID_UP) {
+        ghost_prepare();
         time_ms(&stopwatch.time_start.s, &stopwatch.time_start.ms);
         move_to_state(SW_STATE_RUN);
+        reserve_lap_slot();
       } else if (button_id == BUTTON_ID_SELECT) {
         ui_main_menu_spawn();
       }
@@ -591,10 +924,11 @@ static void single_click_handler(ClickRecognizerRef recognizer, void *context) {
 
 static void raw_click_down_handler (ClickRecognizerRef recognizer, void *context) {  
   int button_id = click_recognizer_get_button_id(recognizer);
+  glance_wake(GLANCE_IDLE_MS);
   switch (stopwatch.sw_state) {
     case SW_STATE_STOP:
       if (button_id == BUTTON_ID_DOWN) {
-        if ((session[session_index].end_index<NUM_LAP_MEMORY) && (session_index<NUM_LAP_MEMORY-1))
+        if (can_save())
           set_warning_text(FONT_KEY_BITHAM_30_BLACK, "HOLD\nTO\nSAVE");
         else
           set_warning_text(FONT_KEY_BITHAM_30_BLACK, "HOLD\nTO\nRESET");
@@ -623,25 +957,50 @@ static void raw_click_up_handler (ClickRecognizerRef recognizer, void *context)
   }
 }
 
+// Deferred parts of saving a session, for the oldest of the saves pending. An
+// eviction run in between shifts it down, so it is found from session_index
+// as the job runs rather than passed in
+static void bookkeep_saved_session(uint32_t arg) {
+  uint8_t i = session_index - saves_pending;
+  saves_pending--;
+  sync_session_created(i);
+  summary_session_saved(i);
+  training_session_saved(save_time[i], &summary_get(i)->summary);
+  // The session may now be evicted, if the store is still short of room
+  reserve_lap_slot();
+}
+
 static void long_click_down_handler(ClickRecognizerRef recognizer, void *context) {
   int button_id = click_recognizer_get_button_id(recognizer);
   switch (stopwatch.sw_state) {
     case SW_STATE_SAVE_CONFIRM:
       if (button_id != BUTTON_ID_DOWN) break;
+      uint32_t stamp_ms = telemetry_stamp_now();
       // Reset sw time
       stopwatch.time_elapsed = (WatchTime_t){0, 0};
       stopwatch.time_offset  = (WatchTime_t){0, 0};
     
-      if ((session[session_index].end_index<NUM_LAP_MEMORY) && (session_index<NUM_LAP_MEMORY-1)) {
-        // Save recorded time
+      // The slot was kept free ahead of the press: nothing here evicts or waits
+      // on the queue
+      if (can_save()) {
+        // Save recorded time, the revision, summary, training log and telemetry follow from the work queue
         save_time[session_index] = time(NULL);
+        saves_pending++;
+        workq_post(WORKQ_PRIORITY_BOOKKEEPING, bookkeep_saved_session, 0);
+        post_stream(TELEMETRY_KIND_SAVE, session[session_index].end_index-session[session_index].start_index+1,
+                    split_cs[session[session_index].end_index], stamp_ms);
+        // The save vibe below belongs to the session being saved, and so do the writes saving it takes
+        energy_count(ENERGY_VIBE, 1);
+        energy_session_saved(session_index);
     
         // Initialize next session
         session[session_index+1].start_index = session[session_index].end_index+1;
         session[session_index+1].end_index   = session[session_index+1].start_index;
     
         session_index++; // Move on to next session_index
+        energy_session_reset(session_index);
         cdt_reset();     // Reset countdown timer
+        reserve_lap_slot();
       }
     
       // Issue a short vibe
@@ -656,13 +1015,14 @@ static void long_click_down_handler(ClickRecognizerRef recognizer, void *context
       
       // Clobber lap and split memory
       for (int i=session[session_index].start_index; i<=session[session_index].end_index; i++)
-        split_memory[i]=(SWTime){0, 0, 0, 0};
+        split_cs[i] = 0;
     
       // Reset countdown timer
       cdt_reset();
       
-      // Revert end_index to start_index
+      // Revert end_index to start_index, and forget the work done
       session[session_index].end_index = session[session_index].start_index;
+      energy_session_reset(session_index);
     
       // Issue a short vibe
       vibes_short_pulse();
@@ -689,34 +1049,54 @@ static void click_config_provider(void *context) {
 }
 //----- End single, long, raw click handlers and stopwatch state transitions
 
-// Initialize watchface layout
+// Look up the face fonts; the frames are fixed at build time
 static void watchface_init(void) {
-  for (int row=0; row < NUM_ROWS; row++) {
-    watchface_digit[row][0].frame     = GRect(0*WIDTH_BITHAM34MN,                    12+ROW_HEIGHT*row, WIDTH_BITHAM34MN, HEIGHT_BITHAM34MN);
-    watchface_digit[row][1].frame     = GRect(1*WIDTH_BITHAM34MN,                    12+ROW_HEIGHT*row, WIDTH_BITHAM34MN, HEIGHT_BITHAM34MN);
-    watchface_digit[row][2].frame     = GRect(2*WIDTH_BITHAM34MN,                    12+ROW_HEIGHT*row, WIDTH_DELIMITER,  HEIGHT_BITHAM34MN);
-    watchface_digit[row][3].frame     = GRect(2*WIDTH_BITHAM34MN+WIDTH_DELIMITER,    12+ROW_HEIGHT*row, WIDTH_BITHAM34MN, HEIGHT_BITHAM34MN);
-    watchface_digit[row][4].frame     = GRect(3*WIDTH_BITHAM34MN+WIDTH_DELIMITER,    12+ROW_HEIGHT*row, WIDTH_BITHAM34MN, HEIGHT_BITHAM34MN);
-    watchface_digit[row][5].frame     = GRect(4*WIDTH_BITHAM34MN+WIDTH_DELIMITER,    12+ROW_HEIGHT*row, WIDTH_DELIMITER,  HEIGHT_BITHAM34MN);
-    watchface_digit[row][6].frame     = GRect(4*WIDTH_BITHAM34MN+WIDTH_DELIMITER*2,  12+(HEIGHT_BITHAM34MN-HEIGHT_GOTHIC28B)+ROW_HEIGHT*row, WIDTH_GOTHIC28B, HEIGHT_GOTHIC28B);
-    watchface_digit[row][7].frame     = GRect(4*WIDTH_BITHAM34MN+WIDTH_DELIMITER*2+WIDTH_GOTHIC28B, 12+(HEIGHT_BITHAM34MN-HEIGHT_GOTHIC28B)+ROW_HEIGHT*row, WIDTH_GOTHIC28B, HEIGHT_GOTHIC28B);
-    
-    // Set font
-    watchface_digit[row][0].font = fonts_get_system_font((row == 0) ? FONT_KEY_BITHAM_30_BLACK : FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-    watchface_digit[row][1].font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-    watchface_digit[row][2].font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-    watchface_digit[row][3].font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-    watchface_digit[row][4].font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-    watchface_digit[row][5].font = fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS);
-    watchface_digit[row][6].font = fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
-    watchface_digit[row][7].font = fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD);
+  for (int i=0; i < LAYOUT_FACE_FONTS; i++) {
+    watchface_font[i] = fonts_get_system_font(layout_face_font_key[i]);
   }
 }
 
+//----- Begin stopwatch record
+static void read_stopwatch(void) {
+  StopwatchRecord_t r;
+  persist_read_data(KEY_STOPWATCH, &r, sizeof(r));
+  stopwatch = (Stopwatch_t){
+    .time_elapsed = store_unpack_watchtime(r.time_elapsed),
+    .time_current = store_unpack_watchtime(r.time_current),
+    .time_start   = store_unpack_watchtime(r.time_start),
+    .time_offset  = store_unpack_watchtime(r.time_offset),
+    .sw_state     = r.sw_state,
+  };
+}
+
+static void write_stopwatch(void) {
+  StopwatchRecord_t r = {
+    .time_elapsed = store_pack_watchtime(stopwatch.time_elapsed),
+    .time_current = store_pack_watchtime(stopwatch.time_current),
+    .time_start   = store_pack_watchtime(stopwatch.time_start),
+    .time_offset  = store_pack_watchtime(stopwatch.time_offset),
+    .sw_state     = stopwatch.sw_state,
+  };
+  persist_write_data(KEY_STOPWATCH, &r, sizeof(r));
+}
+//----- End stopwatch record
+
 // Parent init function
 static void init(void) {  
-  // Initialize countdown timer
+  // Initialize countdown timer, multi-athlete lanes and the finish chute
   cdt_init();
+  lanes_init();
+  chute_init();
+
+  // Deferred work from the click handlers
+  workq_init();
+
+  // Initialize phone communication
+  comm_init();
+  export_init();
+  plan_import_init();
+  chute_export_init();
+  telemetry_init();
   
   // Begin persist-initialization
   if (persist_exists(KEY_SESSION) &&
@@ -725,15 +1105,17 @@ static void init(void) {
       persist_exists(KEY_STOPWATCH) &&
       persist_exists(KEY_SESSION_INDEX)) {
     persist_read_data(KEY_SESSION, &session, sizeof(session));
-    persist_read_data(KEY_SPLIT_MEMORY, &split_memory, sizeof(split_memory));
+    store_read_splits(KEY_SPLIT_MEMORY, split_cs);
     persist_read_data(KEY_SAVE_TIME, &save_time, sizeof(save_time));
-    persist_read_data(KEY_STOPWATCH, &stopwatch, sizeof(stopwatch));
+    read_stopwatch();
     session_index = persist_read_int(KEY_SESSION_INDEX);
+    session_pinned = 0;
+    if (persist_exists(KEY_SESSION_PINNED)) { persist_read_data(KEY_SESSION_PINNED, &session_pinned, sizeof(session_pinned)); }
     //APP_LOG(APP_LOG_LEVEL_DEBUG, "KEY_SESSION, KEY_SPLIT_MEMORY, KEY_SAVE_TIME, KEY_SESSION_INDEX found");
   } else {
     for (int i=0; i < NUM_LAP_MEMORY; i++) {
       session[i]      = (Session_t){0, 0};
-      split_memory[i] = (SWTime){0, 0, 0, 0};
+      split_cs[i]     = 0;
       save_time[i]    = 0;
     }
     stopwatch = (Stopwatch_t){
@@ -744,11 +1126,25 @@ static void init(void) {
       .sw_state     = SW_STATE_IDLE,
     };
     session_index = 0;
+    session_pinned = 0;
     //APP_LOG(APP_LOG_LEVEL_DEBUG, "KEY_SESSION, KEY_SPLIT_MEMORY, KEY_SAVE_TIME, KEY_SESSION_INDEX not found");
   }
   
   // Appearance: inverted, or regular
   invert_color = persist_exists(KEY_INVERT_COLOR) ? persist_read_bool(KEY_INVERT_COLOR) : false;
+
+  // Session revisions for phone sync, needs the session memory above
+  sync_init();
+  energy_init();
+  summary_init();
+  training_init();
+  ghost_init();
+  energy_set_active(stopwatch.sw_state != SW_STATE_IDLE);
+  ghost_set_running(stopwatch.sw_state != SW_STATE_IDLE);
+  room_posted = false;
+  saves_pending = 0;
+  stream_head = stream_count = 0;
+  reserve_lap_slot();
   // End persist-initialization
 
   ms_to_clear_warning = 0;
@@ -772,24 +1168,39 @@ static void init(void) {
     .disappear = window_disappear,
     .unload = window_unload
   });
-  window_set_background_color(window, GColorWhite);
+  window_set_background_color(window, palette_get()->background);
   window_stack_push(window, false);
 }
 
 // Deinit: save persistent data
 static void persist_deinit(void) {
-  persist_write_data(KEY_SPLIT_MEMORY, &split_memory, sizeof(split_memory));
+  energy_count(ENERGY_PERSIST_WRITE, 7);
+  store_write_splits(KEY_SPLIT_MEMORY, split_cs);
   persist_write_data(KEY_SESSION, &session, sizeof(session));
-  persist_write_data(KEY_STOPWATCH, &stopwatch, sizeof(stopwatch));
+  write_stopwatch();
   persist_write_data(KEY_SAVE_TIME, &save_time, sizeof(save_time));
   persist_write_int(KEY_SESSION_INDEX, session_index);
+  persist_write_data(KEY_SESSION_PINNED, &session_pinned, sizeof(session_pinned));
   persist_write_bool(KEY_INVERT_COLOR, invert_color);
 }
 
 // Deinitialize
 static void deinit(void) {
+  // Finish deferred work before anything is persisted
+  workq_deinit();
+  chute_export_deinit();
+  chute_deinit();
+  telemetry_deinit();
+  export_deinit();
+  comm_deinit();
   cdt_deinit();
+  lanes_deinit();
+  sync_deinit();
   persist_deinit();
+  summary_deinit();
+  training_deinit();
+  ghost_deinit();
+  energy_deinit();
   
   // Destroy all window layers
   ui_instant_recall_deinit();
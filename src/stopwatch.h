@@ -4,12 +4,16 @@
 
 #define CLICK_HOLD_MS 1000
 #define SW_STEP_MS_SHORT 130
+#define SW_STEP_MS_GLANCE 1000
+#define GLANCE_IDLE_MS 10000  // Without input while running, before glance mode
+#define GLANCE_WAKE_MS 4000   // Full-rate display after a wrist flick
 #define MAX_STRLEN 5
 #define NUM_ROWS 3
 #define NUM_GUIDES 3
 #define NUM_DIGITS 8
 #define NUM_LAP_MEMORY 50
-#define ROW_HEIGHT 49
+#define MAX_PINNED_LAPS (NUM_LAP_MEMORY/2)  // Leaves room for the session in progress
+#define LAP_HEADROOM 2                      // Free splits the eviction keeps ahead of a lap press
 
 // Persist data keys
 #define KEY_SPLIT_MEMORY  140
@@ -18,29 +22,32 @@
 #define KEY_SESSION_INDEX 200
 #define KEY_SAVE_TIME     220
 #define KEY_INVERT_COLOR  260
-  
-// frame size for bitham_34_medium_numbers and gothic_28_bold
-#define WIDTH_BITHAM34MN  23
-#define HEIGHT_BITHAM34MN 35
-#define WIDTH_GOTHIC28B   12
-#define HEIGHT_GOTHIC28B  29  
-#define WIDTH_DELIMITER   7
+#define KEY_SESSION_PINNED 420
 
-// Placeholder for time_ms values
+// Placeholder for time_ms values. Naturally aligned: the packed form stored
+// on flash is WatchTimeRecord_t (store_format.h)
 typedef struct WatchTime {
   time_t s;
   uint16_t ms;
-} __attribute__((__packed__)) WatchTime_t;
+} WatchTime_t;
 
+// Bounds of a session in the lap memory, absolute split indexes
 typedef struct Session {
   uint8_t start_index;
   uint8_t end_index;
 } __attribute__((__packed__)) Session_t;
 
+extern int32_t get_lap_cs(Session_t, uint8_t);
 extern SWTime get_lap_time(Session_t, uint8_t);
+extern SWTime get_elapsed_time(void);
+extern bool commit_session(const SWTime *, uint8_t);
+extern void delete_session(uint8_t);
+extern bool session_is_pinned(uint8_t);
+extern bool session_set_pinned(uint8_t, bool);
 
-// Lap memory-related components
-extern SWTime    split_memory[NUM_LAP_MEMORY+1];
+// Lap memory-related components: the cumulative split times of all sessions
+// in centiseconds, one contiguous word array, and each session's bounds into it
+extern int32_t   split_cs[NUM_LAP_MEMORY+1];
 extern Session_t session[NUM_LAP_MEMORY];
 extern time_t    save_time[NUM_LAP_MEMORY];
 extern uint8_t   session_index;
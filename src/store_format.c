@@ -0,0 +1,28 @@
+#include "pebble.h"
+#include "store_format.h"
+
+WatchTimeRecord_t store_pack_watchtime(WatchTime_t t) {
+  return (WatchTimeRecord_t){.s=t.s, .ms=t.ms};
+}
+
+WatchTime_t store_unpack_watchtime(WatchTimeRecord_t r) {
+  return (WatchTime_t){.s=r.s, .ms=r.ms};
+}
+
+void store_read_splits(uint32_t key, int32_t *split) {
+  SWTime record[NUM_LAP_MEMORY+1];
+
+  persist_read_data(key, record, sizeof(record));
+  for (uint8_t i=0; i<NUM_LAP_MEMORY+1; i++) {
+    split[i] = SWTime_to_centisecond(record[i]);
+  }
+}
+
+void store_write_splits(uint32_t key, const int32_t *split) {
+  SWTime record[NUM_LAP_MEMORY+1];
+
+  for (uint8_t i=0; i<NUM_LAP_MEMORY+1; i++) {
+    record[i] = SWTime_from_centisecond(split[i]);
+  }
+  persist_write_data(key, record, sizeof(record));
+}
\ No newline at end of file
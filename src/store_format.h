@@ -0,0 +1,37 @@
+#ifndef STORE_FORMAT_H
+#define STORE_FORMAT_H
+#include "stopwatch.h"
+
+// On-flash layouts of the session store and the clocks kept with it. Memory
+// holds the same data naturally aligned; these packed forms are what the
+// persist keys hold, unchanged from when memory used them directly, so data
+// stored by older versions reads back as it was.
+
+typedef struct WatchTimeRecord {
+  time_t s;
+  uint16_t ms;
+} __attribute__((__packed__)) WatchTimeRecord_t;
+
+extern WatchTimeRecord_t store_pack_watchtime(WatchTime_t);
+extern WatchTime_t store_unpack_watchtime(WatchTimeRecord_t);
+
+// Splits are stored as SWTime, NUM_LAP_MEMORY+1 of them under one key
+extern void store_read_splits(uint32_t, int32_t *);
+extern void store_write_splits(uint32_t, const int32_t *);
+
+// The most each store holds in persistent storage, in bytes. The app gets
+// PERSIST_BUDGET in all and the chute's data keys get what the other stores
+// leave, so growing one of them takes from the chute
+#define PERSIST_BUDGET           4096
+#define PERSIST_BUDGET_SESSIONS  614   // Splits, sessions, save times, pins, stopwatch and color
+#define PERSIST_BUDGET_PLAN      210   // KEY_CDT_PLAN holding CDT_MAX_BLOCKS blocks
+#define PERSIST_BUDGET_LANES     820   // NUM_LANES lanes and their count
+#define PERSIST_BUDGET_SYNC      269
+#define PERSIST_BUDGET_ENERGY    500
+#define PERSIST_BUDGET_TRAINING  195
+#define PERSIST_BUDGET_GHOST     4
+#define PERSIST_BUDGET_CHUTE     (PERSIST_BUDGET - PERSIST_BUDGET_SESSIONS - PERSIST_BUDGET_PLAN - \
+                                  PERSIST_BUDGET_LANES - PERSIST_BUDGET_SYNC - PERSIST_BUDGET_ENERGY - \
+                                  PERSIST_BUDGET_TRAINING - PERSIST_BUDGET_GHOST)
+
+#endif
\ No newline at end of file
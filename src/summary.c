@@ -0,0 +1,92 @@
+#include "pebble.h"
+#include "summary.h"
+
+typedef struct SummaryPage {
+  int8_t page;         // -1 if the slot is free
+  uint8_t last_use;
+  SummaryRow_t row[SUMMARY_PAGE_SIZE];
+} SummaryPage_t;
+
+static SummaryPage_t cache[SUMMARY_CACHE_PAGES];
+static uint8_t use_clock;
+
+static void format_date(SummaryRow_t *row, time_t t) {
+  strftime(row->date, sizeof(row->date), "%m/%d/%Y %I:%M %p", localtime(&t));
+}
+
+// Summarize saved session i from the lap memory
+static void summarize(SummaryRow_t *row, uint8_t i) {
+  int32_t best_cs = get_lap_cs(session[i], session[i].start_index);
+
+  for (uint8_t j=session[i].start_index+1; j<=session[i].end_index; j++) {
+    int32_t lap_cs = split_cs[j] - split_cs[j-1];
+    if (lap_cs < best_cs) { best_cs = lap_cs; }
+  }
+  row->summary = (SessionSummary_t){.num_laps = session[i].end_index-session[i].start_index+1,
+                                    .total = SWTime_from_centisecond(split_cs[session[i].end_index]),
+                                    .best_lap = SWTime_from_centisecond(best_cs)};
+  format_date(row, save_time[i]);
+}
+
+// Build a page into the least recently used slot. The lap memory is in RAM, so
+// a page is summarized afresh rather than kept in persistent storage
+static SummaryPage_t *page_in(uint8_t page) {
+  SummaryPage_t *slot = &cache[0];
+
+  for (uint8_t s=0; s<SUMMARY_CACHE_PAGES; s++) {
+    if (cache[s].page == page) {
+      cache[s].last_use = ++use_clock;
+      return &cache[s];
+    }
+  }
+  for (uint8_t s=1; s<SUMMARY_CACHE_PAGES && slot->page >= 0; s++) {
+    if (cache[s].page < 0 ||
+        (uint8_t)(use_clock - cache[s].last_use) > (uint8_t)(use_clock - slot->last_use)) { slot = &cache[s]; }
+  }
+
+  slot->page = page;
+  slot->last_use = ++use_clock;
+  for (uint8_t j=0; j<SUMMARY_PAGE_SIZE; j++) {
+    uint8_t i = page*SUMMARY_PAGE_SIZE + j;
+    if (i < session_index) {
+      summarize(&slot->row[j], i);
+    } else {
+      slot->row[j] = (SummaryRow_t){{0, {0, 0, 0, 0}, {0, 0, 0, 0}}, ""};
+    }
+  }
+  return slot;
+}
+
+const SummaryRow_t *summary_get(uint8_t i) {
+  return &page_in(i / SUMMARY_PAGE_SIZE)->row[i % SUMMARY_PAGE_SIZE];
+}
+
+// On saving or committing session i, which may be before session_index moves
+// past it: its row in a cached page is built here
+void summary_session_saved(uint8_t i) {
+  summarize(&page_in(i / SUMMARY_PAGE_SIZE)->row[i % SUMMARY_PAGE_SIZE], i);
+}
+
+// The later sessions shift down, so the pages from i's on are built again when
+// next read. Call before the sessions are shifted
+void summary_session_deleted(uint8_t i) {
+  for (uint8_t s=0; s<SUMMARY_CACHE_PAGES; s++) {
+    if (cache[s].page >= i / SUMMARY_PAGE_SIZE) { cache[s].page = -1; }
+  }
+}
+
+// Call after the session memory is read. Summaries persisted by earlier
+// versions are deleted to give their space back
+void summary_init(void) {
+  for (uint8_t s=0; s<SUMMARY_CACHE_PAGES; s++) {
+    cache[s] = (SummaryPage_t){.page=-1, .last_use=0};
+  }
+  use_clock = 0;
+
+  for (uint8_t k=0; k<SUMMARY_NUM_PAGES; k++) {
+    if (persist_exists(KEY_SUMMARY+k)) { persist_delete(KEY_SUMMARY+k); }
+  }
+}
+
+void summary_deinit(void) {
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef SUMMARY_H
+#define SUMMARY_H
+#include "stopwatch.h"
+
+// Persist data keys of earlier versions, SUMMARY_NUM_PAGES of them from
+// KEY_SUMMARY. No longer written, and deleted at launch
+#define KEY_SUMMARY 340
+
+#define SUMMARY_PAGE_SIZE   8     // Sessions per cached page
+#define SUMMARY_NUM_PAGES   ((NUM_LAP_MEMORY + SUMMARY_PAGE_SIZE - 1) / SUMMARY_PAGE_SIZE)
+#define SUMMARY_CACHE_PAGES 2     // Pages held in RAM, enough to scroll across a page boundary
+#define SUMMARY_DATE_LEN    20
+
+// What the session list shows of a saved session, so drawing a row touches
+// neither the lap data nor localtime()
+typedef struct SessionSummary {
+  uint8_t num_laps;
+  SWTime total;
+  SWTime best_lap;
+} __attribute__((__packed__)) SessionSummary_t;
+
+// A summary as held in the page cache, with its save date formatted once when
+// the page is read in rather than on every redraw
+typedef struct SummaryRow {
+  SessionSummary_t summary;
+  char date[SUMMARY_DATE_LEN];
+} SummaryRow_t;
+
+extern const SummaryRow_t *summary_get(uint8_t);
+extern void summary_session_saved(uint8_t);
+extern void summary_session_deleted(uint8_t);
+
+extern void summary_init(void);
+extern void summary_deinit(void);
+
+#endif
\ No newline at end of file
@@ -63,4 +63,17 @@ signed char SWTime_compare(SWTime a, SWTime b) {
          (a.centisecond < b.centisecond) ? -1 :
          (a.centisecond > b.centisecond) ? 1 :
          0;
+}
+
+// Conversion to/from a flat centisecond count, used for compact encoding and plan arithmetic
+int32_t SWTime_to_centisecond(SWTime t) {
+  return (int32_t)t.hour*360000 + (int32_t)t.minute*6000 + (int32_t)t.second*100 + (int32_t)t.centisecond;
+}
+
+SWTime SWTime_from_centisecond(int32_t cs) {
+  SWTime t = {.centisecond=(signed char)(cs%100),
+              .second=(signed char)((cs/100)%60),
+              .minute=(signed char)((cs/6000)%60),
+              .hour=(signed char)(cs/360000)};
+  return t;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #ifndef SWTIME_H
 #define SWTIME_H
+#include <stdint.h>
 
 // 32-bit representation of "stopwatch" time
 typedef struct SWTime {
@@ -12,5 +13,7 @@ typedef struct SWTime {
 extern SWTime SWTime_add(SWTime, SWTime);
 extern SWTime SWTime_subtract(SWTime, SWTime);
 extern signed char SWTime_compare(SWTime, SWTime);
+extern int32_t SWTime_to_centisecond(SWTime);
+extern SWTime SWTime_from_centisecond(int32_t);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "pebble.h"
+#include "sync.h"
+#include "energy.h"
+
+typedef struct SyncState {
+  uint16_t revision;         // Last revision handed out
+  uint16_t tombstone_floor;  // Deletions at or before this revision may have been forgotten
+  uint8_t tombstone_head;    // Next tombstone slot to overwrite
+} __attribute__((__packed__)) SyncState_t;
+
+SessionRev_t session_rev[NUM_LAP_MEMORY];
+
+static SyncState_t sync_state;
+static SessionRev_t tombstone[SYNC_MAX_TOMBSTONES];  // id and revision of deleted sessions, rev 0 if unused
+
+uint16_t sync_get_revision(void) {
+  return sync_state.revision;
+}
+
+void sync_session_created(uint8_t i) {
+  session_rev[i].id = session_rev[i].rev = ++sync_state.revision;
+}
+
+// Shift down, same as session[]
+static void shift_down(uint8_t i) {
+  for (uint8_t j=i; j<NUM_LAP_MEMORY-1; j++) {
+    session_rev[j] = session_rev[j+1];
+  }
+  session_rev[NUM_LAP_MEMORY-1] = (SessionRev_t){0, 0};
+}
+
+// Call before the session is removed from session[]
+void sync_session_deleted(uint8_t i) {
+  SessionRev_t *slot = &tombstone[sync_state.tombstone_head];
+
+  // Overwriting the oldest tombstone: peers older than it need a full resync
+  if (slot->rev != 0) { sync_state.tombstone_floor = slot->rev; }
+  *slot = (SessionRev_t){.id=session_rev[i].id, .rev=++sync_state.revision};
+  sync_state.tombstone_head = (sync_state.tombstone_head+1) % SYNC_MAX_TOMBSTONES;
+  shift_down(i);
+}
+
+// An evicted session leaves no tombstone, so a peer that has it keeps it
+void sync_session_evicted(uint8_t i) {
+  shift_down(i);
+}
+
+// False if deletions since the given revision may have been forgotten
+bool sync_is_complete_since(uint16_t since) {
+  return since >= sync_state.tombstone_floor;
+}
+
+// Collect ids of sessions deleted after the given revision
+uint8_t sync_get_tombstones(uint16_t since, uint16_t *ids, uint8_t max) {
+  uint8_t n = 0;
+  for (uint8_t i=0; i<SYNC_MAX_TOMBSTONES && n<max; i++) {
+    if (tombstone[i].rev > since) { ids[n++] = tombstone[i].id; }
+  }
+  return n;
+}
+
+// Call after the session memory has been restored
+void sync_init(void) {
+  if (persist_exists(KEY_SYNC_REV) &&
+      persist_exists(KEY_SYNC_TOMBSTONE) &&
+      persist_exists(KEY_SYNC_STATE)) {
+    persist_read_data(KEY_SYNC_REV, &session_rev, sizeof(session_rev));
+    persist_read_data(KEY_SYNC_TOMBSTONE, &tombstone, sizeof(tombstone));
+    persist_read_data(KEY_SYNC_STATE, &sync_state, sizeof(sync_state));
+  } else {
+    sync_state = (SyncState_t){.revision=0, .tombstone_floor=0, .tombstone_head=0};
+    for (uint8_t i=0; i<SYNC_MAX_TOMBSTONES; i++) {
+      tombstone[i] = (SessionRev_t){0, 0};
+    }
+    // Sessions saved before revisions existed get one now
+    for (uint8_t i=0; i<NUM_LAP_MEMORY; i++) {
+      session_rev[i] = (SessionRev_t){0, 0};
+      if (i < session_index) { sync_session_created(i); }
+    }
+  }
+}
+
+void sync_deinit(void) {
+  energy_count(ENERGY_PERSIST_WRITE, 3);
+  persist_write_data(KEY_SYNC_REV, &session_rev, sizeof(session_rev));
+  persist_write_data(KEY_SYNC_TOMBSTONE, &tombstone, sizeof(tombstone));
+  persist_write_data(KEY_SYNC_STATE, &sync_state, sizeof(sync_state));
+}
\ No newline at end of file
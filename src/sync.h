@@ -0,0 +1,33 @@
+#ifndef SYNC_H
+#define SYNC_H
+#include "stopwatch.h"
+
+#define SYNC_MAX_TOMBSTONES 16
+
+// Persist data keys
+#define KEY_SYNC_REV       300
+#define KEY_SYNC_TOMBSTONE 301
+#define KEY_SYNC_STATE     302
+
+// Revision bookkeeping for each saved session, parallel to session[]
+// Revisions come from one store-wide counter; a session's id is the revision it was created at.
+// A saved session's splits and save time never change, so rev stays its id until it is deleted.
+// Pinning is kept on the watch only and is not a change the phone is sent
+typedef struct SessionRev {
+  uint16_t id;   // Stable across deletion of other sessions, never reused
+  uint16_t rev;  // Store revision of the last change
+} __attribute__((__packed__)) SessionRev_t;
+
+extern SessionRev_t session_rev[NUM_LAP_MEMORY];
+
+extern uint16_t sync_get_revision(void);
+extern void sync_session_created(uint8_t);
+extern void sync_session_deleted(uint8_t);
+extern void sync_session_evicted(uint8_t);
+extern bool sync_is_complete_since(uint16_t);
+extern uint8_t sync_get_tombstones(uint16_t, uint16_t *, uint8_t);
+
+extern void sync_init(void);
+extern void sync_deinit(void);
+
+#endif
\ No newline at end of file
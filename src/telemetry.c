@@ -0,0 +1,172 @@
+#include "pebble.h"
+#include "telemetry.h"
+#include "comm.h"
+
+// Ring of events; the first in_flight events from head are in the outbox
+static TelemetryEvent queue[TELEMETRY_QUEUE_SIZE];
+static uint8_t head;
+static uint8_t count;
+static uint8_t in_flight;
+static uint16_t next_seq;
+static uint16_t merged;    // Lap events folded into a later lap of the same lane
+static uint16_t dropped;   // Events lost because nothing could be merged
+
+static uint8_t payload[TELEMETRY_BATCH_MAX*sizeof(TelemetryEvent)];
+static AppTimer *retry_timer;
+static uint16_t retry_ms;
+
+static void pump(void);
+
+static TelemetryEvent *queue_at(uint8_t i) {
+  return &queue[(head+i) % TELEMETRY_QUEUE_SIZE];
+}
+
+// Close the gap at i by moving the later events down
+static void queue_remove(uint8_t i) {
+  for (; i<count-1; i++) { *queue_at(i) = *queue_at(i+1); }
+  count--;
+}
+
+// Queue is full: fold the oldest waiting lap into a later lap of the same lane,
+// whose split already includes it; failing that, drop the oldest waiting event.
+// A save of the lane in between ends its session, and the laps after it do not
+// include the ones before. Return false if every event is in flight and nothing can go
+static bool make_room(void) {
+  for (uint8_t i=in_flight; i<count; i++) {
+    TelemetryEvent *older = queue_at(i);
+    if (older->kind != TELEMETRY_KIND_LAP) { continue; }
+    for (uint8_t j=i+1; j<count; j++) {
+      TelemetryEvent *newer = queue_at(j);
+      if (newer->lane != older->lane) { continue; }
+      if (newer->kind == TELEMETRY_KIND_SAVE) { break; }
+      newer->laps_covered += older->laps_covered;
+      merged += older->laps_covered;
+      queue_remove(i);
+      return true;
+    }
+  }
+  if (in_flight >= count) { return false; }
+  dropped += (queue_at(in_flight)->kind == TELEMETRY_KIND_LAP) ? queue_at(in_flight)->laps_covered : 1;
+  queue_remove(in_flight);
+  return true;
+}
+
+// Never blocks: the event is queued and sent when the outbox is free
+static void push(uint8_t kind, uint8_t lane, uint8_t lap, SWTime split, uint32_t stamp_ms) {
+  if (count >= TELEMETRY_QUEUE_SIZE && !make_room()) {
+    dropped++;
+    return;
+  }
+  *queue_at(count++) = (TelemetryEvent){
+    .seq = next_seq++,
+    .kind = kind,
+    .lane = lane,
+    .lap = lap,
+    .laps_covered = 1,
+    .split_cs = SWTime_to_centisecond(split),
+    .stamp_ms = stamp_ms,
+  };
+  comm_set_fast_link(COMM_OWNER_TELEMETRY, true);
+  pump();
+}
+
+static void retry_timer_callback(void *data) {
+  retry_timer = NULL;
+  pump();
+}
+
+static void schedule_retry(void) {
+  if (retry_timer) { return; }
+  retry_timer = app_timer_register(retry_ms, retry_timer_callback, NULL);
+  retry_ms = (retry_ms*2 > TELEMETRY_RETRY_MAX_MS) ? TELEMETRY_RETRY_MAX_MS : retry_ms*2;
+}
+
+// Send up to a batch of waiting events in one message
+static void pump(void) {
+  DictionaryIterator *iter;
+  uint16_t cap = comm_outbox_payload_size(2, sizeof(uint16_t));
+  uint8_t n;
+
+  if (in_flight > 0 || retry_timer) { return; }
+  if (count == 0) {
+    comm_set_fast_link(COMM_OWNER_TELEMETRY, false);
+    return;
+  }
+  // Outbox is busy: comm calls back through the ready handler
+  if (!comm_outbox_begin(COMM_OWNER_TELEMETRY, &iter)) { return; }
+
+  for (n=0; n<count && n<TELEMETRY_BATCH_MAX && (n+1)*sizeof(TelemetryEvent) <= cap; n++) {
+    memcpy(&payload[n*sizeof(TelemetryEvent)], queue_at(n), sizeof(TelemetryEvent));
+  }
+  dict_write_data(iter, MSG_KEY_TELEMETRY, payload, n*sizeof(TelemetryEvent));
+  dict_write_uint16(iter, MSG_KEY_TELEMETRY_DROPPED, dropped);
+  dict_write_end(iter);
+
+  in_flight = n;
+  if (!comm_outbox_send()) {
+    in_flight = 0;
+    schedule_retry();
+  }
+}
+
+//----- Begin AppMessage handlers
+static void sent_handler(void) {
+  head = (head+in_flight) % TELEMETRY_QUEUE_SIZE;
+  count -= in_flight;
+  in_flight = 0;
+  retry_ms = TELEMETRY_RETRY_MS;
+  pump();
+}
+
+// Events stay queued, and keep merging, until the phone is back
+static void failed_handler(AppMessageResult reason) {
+  in_flight = 0;
+  schedule_retry();
+}
+//----- End AppMessage handlers
+
+// Wall clock for an event's stamp_ms. Take it as the button goes down, the
+// event may reach the queue later
+uint32_t telemetry_stamp_now(void) {
+  time_t s;
+  uint16_t ms;
+  time_ms(&s, &ms);
+  return (uint32_t)s*1000 + ms;
+}
+
+void telemetry_lap(uint8_t lane, uint8_t lap, SWTime split, uint32_t stamp_ms) {
+  push(TELEMETRY_KIND_LAP, lane, lap, split, stamp_ms);
+}
+
+void telemetry_save(uint8_t lane, uint8_t num_laps, SWTime split, uint32_t stamp_ms) {
+  push(TELEMETRY_KIND_SAVE, lane, num_laps, split, stamp_ms);
+}
+
+uint8_t telemetry_get_queued(void) {
+  return count;
+}
+
+uint16_t telemetry_get_merged(void) {
+  return merged;
+}
+
+uint16_t telemetry_get_dropped(void) {
+  return dropped;
+}
+
+void telemetry_init(void) {
+  head = count = in_flight = 0;
+  next_seq = merged = dropped = 0;
+  retry_ms = TELEMETRY_RETRY_MS;
+  comm_register(COMM_OWNER_TELEMETRY, (CommHandlers){
+    .ready = pump,
+    .sent = sent_handler,
+    .failed = failed_handler,
+  });
+}
+
+// Live events are of no use later, whatever is still queued is dropped
+void telemetry_deinit(void) {
+  if (retry_timer) { app_timer_cancel(retry_timer); retry_timer = NULL; }
+  comm_set_fast_link(COMM_OWNER_TELEMETRY, false);
+}
\ No newline at end of file
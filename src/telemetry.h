@@ -0,0 +1,35 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include "swtime.h"
+
+#define TELEMETRY_QUEUE_SIZE      16    // Events waiting for the outbox, including those in flight
+#define TELEMETRY_BATCH_MAX       8     // Events per message, the rest of the queue stays free to merge
+#define TELEMETRY_RETRY_MS        250   // First retry after a failed send, doubled up to the max
+#define TELEMETRY_RETRY_MAX_MS    8000
+#define TELEMETRY_LANE_MAIN       0xFF  // Lane of events from the main stopwatch
+
+enum telemetry_kind_e {TELEMETRY_KIND_LAP,
+                       TELEMETRY_KIND_SAVE};
+
+// One live event as sent to the phone, little-endian
+typedef struct TelemetryEvent {
+  uint16_t seq;           // Per event, lets the phone drop duplicates after a resend
+  uint8_t kind;
+  uint8_t lane;           // Lane index, or TELEMETRY_LANE_MAIN
+  uint8_t lap;            // 0-based lap index; number of laps for a save
+  uint8_t laps_covered;   // More than 1 when earlier laps of the lane were merged into this one
+  int32_t split_cs;       // Split time at the event
+  uint32_t stamp_ms;      // Wall clock in ms (mod 2^32) when the event happened
+} __attribute__((__packed__)) TelemetryEvent;
+
+extern uint32_t telemetry_stamp_now(void);
+extern void telemetry_lap(uint8_t, uint8_t, SWTime, uint32_t);
+extern void telemetry_save(uint8_t, uint8_t, SWTime, uint32_t);
+extern uint8_t telemetry_get_queued(void);
+extern uint16_t telemetry_get_merged(void);
+extern uint16_t telemetry_get_dropped(void);
+
+extern void telemetry_init(void);
+extern void telemetry_deinit(void);
+
+#endif
\ No newline at end of file
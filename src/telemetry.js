@@ -0,0 +1,57 @@
+// Live lap telemetry receiver
+//
+// Each TELEMETRY message holds one or more 14-byte little-endian events
+// (see TelemetryEvent in telemetry.h). Events may arrive twice after a
+// resend, so they are filtered by sequence number.
+
+var TELEMETRY_EVENT_SIZE = 14;
+var TELEMETRY_LANE_MAIN = 0xFF;
+var TELEMETRY_MAX_EVENTS = 200;
+
+var telemetryLastSeq = -1;
+var telemetryEvents = [];
+
+function telemetryReadUint(bytes, pos, size) {
+  var value = 0;
+  for (var i = size - 1; i >= 0; i--) {
+    value = value * 256 + bytes[pos + i];
+  }
+  return value;
+}
+
+function telemetryDecodeEvent(bytes, pos) {
+  var split = telemetryReadUint(bytes, pos + 6, 4);
+  return {
+    seq: telemetryReadUint(bytes, pos, 2),
+    kind: (bytes[pos + 2] === 0) ? 'lap' : 'save',
+    lane: (bytes[pos + 3] === TELEMETRY_LANE_MAIN) ? null : bytes[pos + 3],
+    lap: bytes[pos + 4],
+    lapsCovered: bytes[pos + 5],
+    split: (split >= 0x80000000) ? split - 0x100000000 : split,
+    stamp: telemetryReadUint(bytes, pos + 10, 4),
+    received: Date.now()
+  };
+}
+
+// True if seq is newer than the last one seen, allowing for 16-bit wrap
+function telemetryIsNew(seq) {
+  var ahead = (seq - telemetryLastSeq + 0x10000) % 0x10000;
+  return telemetryLastSeq < 0 || (ahead !== 0 && ahead < 0x8000);
+}
+
+Pebble.addEventListener('appmessage', function(e) {
+  var p = e.payload;
+  if (p.TELEMETRY === undefined) { return; }
+
+  for (var pos = 0; pos + TELEMETRY_EVENT_SIZE <= p.TELEMETRY.length; pos += TELEMETRY_EVENT_SIZE) {
+    var event = telemetryDecodeEvent(p.TELEMETRY, pos);
+    if (!telemetryIsNew(event.seq)) { continue; }
+    telemetryLastSeq = event.seq;
+    telemetryEvents.push(event);
+    if (telemetryEvents.length > TELEMETRY_MAX_EVENTS) { telemetryEvents.shift(); }
+    console.log('Telemetry: ' + JSON.stringify(event));
+  }
+  if (p.TELEMETRY_DROPPED) {
+    console.log('Telemetry: ' + p.TELEMETRY_DROPPED + ' events dropped on the watch');
+  }
+});
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "pebble.h"
+#include "training.h"
+#include "energy.h"
+
+#define SECONDS_PER_DAY 86400
+#define EPOCH_WEEKDAY   3     // 1 January 1970 was a Thursday, 3 days after a Monday
+
+static TrainingLog_t training;
+static bool dirty;
+
+// The watch clock is local time, so a day starts at local midnight
+static uint16_t day_of(time_t t) {
+  return (uint16_t)(t / SECONDS_PER_DAY);
+}
+
+static uint16_t week_of(time_t t) {
+  return (uint16_t)((t / SECONDS_PER_DAY + EPOCH_WEEKDAY) / 7);
+}
+
+// The bucket for period, or NULL if it has rolled off the ring
+static TrainingBucket_t *bucket_get(TrainingBucket_t *ring, uint8_t size, uint16_t period) {
+  TrainingBucket_t *b = &ring[period % size];
+  return (b->period == period && b->sessions > 0) ? b : NULL;
+}
+
+// Take over the bucket of a period that has rolled off. NULL if the ring has
+// already moved past period, from a clock set back
+static TrainingBucket_t *bucket_claim(TrainingBucket_t *ring, uint8_t size, uint16_t period) {
+  TrainingBucket_t *b = &ring[period % size];
+  if (b->sessions > 0 && b->period > period) { return NULL; }
+  if (b->period != period) {
+    *b = (TrainingBucket_t){.period = period};
+  }
+  return b;
+}
+
+static void bucket_add(TrainingBucket_t *b, const SessionSummary_t *s) {
+  int32_t best_lap_cs = SWTime_to_centisecond(s->best_lap);
+  if (!b) { return; }
+  b->sessions++;
+  b->laps += s->num_laps;
+  b->total_cs += SWTime_to_centisecond(s->total);
+  if (b->best_lap_cs == 0 || best_lap_cs < b->best_lap_cs) { b->best_lap_cs = best_lap_cs; }
+}
+
+// The best lap stays, as the best done in the period: taking it back out would
+// mean looking through the period's other sessions
+static void bucket_remove(TrainingBucket_t *b, const SessionSummary_t *s) {
+  if (!b) { return; }
+  b->sessions--;
+  b->laps -= (s->num_laps < b->laps) ? s->num_laps : b->laps;
+  b->total_cs -= SWTime_to_centisecond(s->total);
+  if (b->sessions == 0) { *b = (TrainingBucket_t){.period = b->period}; }
+}
+
+// Totals days_back days before now's day, NULL if nothing was saved or the day
+// has rolled off
+const TrainingBucket_t *training_get_day(time_t now, uint8_t days_back) {
+  if (days_back >= TRAINING_NUM_DAYS) { return NULL; }
+  return bucket_get(training.day, TRAINING_NUM_DAYS, day_of(now) - days_back);
+}
+
+const TrainingBucket_t *training_get_week(time_t now, uint8_t weeks_back) {
+  if (weeks_back >= TRAINING_NUM_WEEKS) { return NULL; }
+  return bucket_get(training.week, TRAINING_NUM_WEEKS, week_of(now) - weeks_back);
+}
+
+// A session saved at t, with its summary
+void training_session_saved(time_t t, const SessionSummary_t *s) {
+  bucket_add(bucket_claim(training.day, TRAINING_NUM_DAYS, day_of(t)), s);
+  bucket_add(bucket_claim(training.week, TRAINING_NUM_WEEKS, week_of(t)), s);
+  dirty = true;
+}
+
+// A session saved at t is being deleted. Nothing to do once its day or week
+// has rolled off
+void training_session_deleted(time_t t, const SessionSummary_t *s) {
+  bucket_remove(bucket_get(training.day, TRAINING_NUM_DAYS, day_of(t)), s);
+  bucket_remove(bucket_get(training.week, TRAINING_NUM_WEEKS, week_of(t)), s);
+  dirty = true;
+}
+
+// Call after the summaries are read. A log missing from before it was kept is
+// started from the sessions in memory, once
+void training_init(void) {
+  dirty = false;
+  if (persist_exists(KEY_TRAINING)) {
+    persist_read_data(KEY_TRAINING, &training, sizeof(training));
+    return;
+  }
+  memset(&training, 0, sizeof(training));
+  for (uint8_t i=0; i<session_index; i++) {
+    training_session_saved(save_time[i], &summary_get(i)->summary);
+  }
+}
+
+void training_deinit(void) {
+  if (!dirty) { return; }
+  energy_count(ENERGY_PERSIST_WRITE, 1);
+  persist_write_data(KEY_TRAINING, &training, sizeof(training));
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef TRAINING_H
+#define TRAINING_H
+#include "stopwatch.h"
+#include "summary.h"
+
+// Persist data keys
+#define KEY_TRAINING 400
+
+#define TRAINING_NUM_DAYS   7
+#define TRAINING_NUM_WEEKS  8
+
+// Totals of the sessions saved in one day or one week. Kept up as sessions are
+// saved and deleted, never rebuilt from the session memory
+typedef struct TrainingBucket {
+  uint16_t period;        // Days since the epoch, or weeks since the Monday before it
+  uint8_t sessions;
+  uint16_t laps;
+  int32_t total_cs;
+  int32_t best_lap_cs;    // Best saved in the period, 0 for none
+} __attribute__((__packed__)) TrainingBucket_t;
+
+// Rings indexed by period, a bucket whose period is past has rolled off
+typedef struct TrainingLog {
+  TrainingBucket_t day[TRAINING_NUM_DAYS];
+  TrainingBucket_t week[TRAINING_NUM_WEEKS];
+} __attribute__((__packed__)) TrainingLog_t;
+
+extern const TrainingBucket_t *training_get_day(time_t, uint8_t);
+extern const TrainingBucket_t *training_get_week(time_t, uint8_t);
+extern void training_session_saved(time_t, const SessionSummary_t *);
+extern void training_session_deleted(time_t, const SessionSummary_t *);
+
+extern void training_init(void);
+extern void training_deinit(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "pebble.h"
+#include "ui_chute.h"
+#include "chute.h"
+#include "chute_export.h"
+#include "palette.h"
+
+#define CHUTE_CLOCK_MS 1000
+
+// Finish chute window and layers
+static Window *window;
+static Layer *layer_chute;
+static AppTimer *timer;
+
+// Helper function declaration
+static void window_load(Window *);
+static void window_appear(Window *);
+static void window_disappear(Window *);
+static void window_unload(Window *);
+static void click_config_provider(void *);
+
+// h:mm:ss.mmm, or m:ss.mmm under an hour
+static void format_ms(char *str, size_t size, uint32_t ms) {
+  uint32_t s = ms / 1000;
+  if (s >= 3600)
+    snprintf(str, size, "%d:%02d:%02d.%03d", (int)(s/3600), (int)(s/60%60), (int)(s%60), (int)(ms%1000));
+  else
+    snprintf(str, size, "%d:%02d.%03d", (int)(s/60), (int)(s%60), (int)(ms%1000));
+}
+
+// Everything is formatted here, at redraw, never in the press handler. Presses
+// faster than the display refreshes only cost one redraw
+static void layer_chute_update_callback(Layer *layer, GContext *ctx) {
+  const Palette_t *palette = palette_get();
+  const Chute_t *c = chute_get();
+  GRect bounds = layer_get_bounds(layer);
+  uint16_t count = chute_get_count();
+  char str[20];
+  char time_str[14];
+
+  graphics_context_set_text_color(ctx, palette->foreground);
+  graphics_context_set_stroke_color(ctx, palette->foreground);
+
+  // Chute clock, or what to press next
+  if (c->state == CHUTE_STATE_RUN) {
+    uint32_t s = chute_elapsed_ms() / 1000;
+    snprintf(str, sizeof(str), "%d:%02d:%02d", (int)(s/3600), (int)(s/60%60), (int)(s%60));
+  } else {
+    strcpy(str, (c->state == CHUTE_STATE_IDLE) ? "SELECT: Start" : "Hold DOWN: Clear");
+  }
+  graphics_draw_text(ctx, str, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+                     GRect(0, -2, bounds.size.w, 28), GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+
+  // Running count
+  snprintf(str, sizeof(str), "%d", count);
+  graphics_draw_text(ctx, str, fonts_get_system_font(FONT_KEY_BITHAM_42_MEDIUM_NUMBERS),
+                     GRect(0, 24, bounds.size.w, 48), GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+  if (c->num_lost > 0) {
+    snprintf(str, sizeof(str), "Full, %d Not Kept", c->num_lost);
+  } else if (chute_get_unsaved() > 0) {
+    snprintf(str, sizeof(str), "%d Kept Until Exit", chute_get_unsaved());
+  }
+  if (c->num_lost > 0 || chute_get_unsaved() > 0) {
+    graphics_draw_text(ctx, str, fonts_get_system_font(FONT_KEY_GOTHIC_14),
+                       GRect(0, 70, bounds.size.w, 16), GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+  }
+  graphics_draw_line(ctx, GPoint(4, 88), GPoint(bounds.size.w-5, 88));
+
+  // Last finishers, newest first
+  for (uint8_t i=0; i<CHUTE_NUM_RECENT && i<count; i++) {
+    snprintf(str, sizeof(str), "%d", count-i);
+    format_ms(time_str, sizeof(time_str), c->recent_ms[i]);
+    graphics_draw_text(ctx, str, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+                       GRect(5, 88+i*25, 40, 28), GTextOverflowModeFill, GTextAlignmentLeft, NULL);
+    graphics_draw_text(ctx, time_str, fonts_get_system_font(FONT_KEY_GOTHIC_24),
+                       GRect(40, 88+i*25, bounds.size.w-45, 28), GTextOverflowModeFill, GTextAlignmentRight, NULL);
+  }
+}
+
+// Whole seconds for the chute clock
+static void timer_callback(void *data) {
+  timer = NULL;
+  layer_mark_dirty(layer_chute);
+  if (chute_get()->state == CHUTE_STATE_RUN) {
+    timer = app_timer_register(CHUTE_CLOCK_MS - chute_elapsed_ms()%1000, timer_callback, NULL);
+  }
+}
+
+// Initialize finish chute window hander
+void ui_chute_init(void) {
+  window = window_create();
+  window_set_click_config_provider(window, click_config_provider);
+  window_set_window_handlers(window, (WindowHandlers) {
+    .load = window_load,
+    .appear = window_appear,
+    .disappear = window_disappear,
+    .unload = window_unload,
+  });
+}
+
+void ui_chute_deinit(void) {
+  window_destroy(window);
+}
+
+void ui_chute_spawn(void) {
+  window_stack_push(window, false);
+}
+
+//----- Begin finish chute window load/unload
+static void window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+
+  layer_chute = layer_create(layer_get_frame(window_layer));
+  layer_set_update_proc(layer_chute, layer_chute_update_callback);
+  layer_add_child(window_layer, layer_chute);
+}
+
+static void window_appear(Window *window) {
+  window_set_background_color(window, palette_get()->background);
+  timer_callback(NULL);
+}
+
+static void window_disappear(Window *window) {
+  if (timer) {
+    app_timer_cancel(timer);
+    timer = NULL;
+  }
+}
+
+static void window_unload(Window *window) {
+  layer_destroy(layer_chute);
+}
+//----- End finish chute window load/unload
+
+//----- Begin click handlers
+// UP: a finisher, taken as the button goes down
+static void raw_click_down_handler(ClickRecognizerRef recognizer, void *context) {
+  chute_record();
+  layer_mark_dirty(layer_chute);
+}
+
+// SELECT: start the chute
+static void single_click_handler(ClickRecognizerRef recognizer, void *context) {
+  if (chute_get()->state != CHUTE_STATE_IDLE) { return; }
+  chute_start();
+  timer_callback(NULL);
+}
+
+// Hold SELECT: stop the chute, hold DOWN: clear a stopped one
+static void long_click_down_handler(ClickRecognizerRef recognizer, void *context) {
+  int button_id = click_recognizer_get_button_id(recognizer);
+
+  switch (button_id) {
+    case BUTTON_ID_SELECT:
+      if (chute_get()->state != CHUTE_STATE_RUN) { return; }
+      chute_stop();
+      chute_export_start();
+      break;
+    case BUTTON_ID_DOWN:
+      if (chute_get()->state != CHUTE_STATE_STOP) { return; }
+      chute_export_cancel();
+      chute_clear();
+      break;
+  }
+  vibes_short_pulse();
+  layer_mark_dirty(layer_chute);
+}
+
+static void click_config_provider(void *context) {
+  window_raw_click_subscribe(BUTTON_ID_UP, raw_click_down_handler, NULL, NULL);
+  window_single_click_subscribe(BUTTON_ID_SELECT, single_click_handler);
+  window_long_click_subscribe(BUTTON_ID_SELECT, CLICK_HOLD_MS, long_click_down_handler, NULL);
+  window_long_click_subscribe(BUTTON_ID_DOWN,   CLICK_HOLD_MS, long_click_down_handler, NULL);
+}
+//----- End click handlers
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef UI_CHUTE_H
+#define UI_CHUTE_H
+
+extern void ui_chute_init(void);
+extern void ui_chute_deinit(void);
+extern void ui_chute_spawn(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "pebble.h"
+#include "ui_compare.h"
+#include "stopwatch.h"
+
+#define ROW_HEIGHT_COMPARE 24
+#define COLUMN_LAP_W       22
+#define COLUMN_TIME_W      40
+
+// Session comparison window and layers
+static Window *window;
+static MenuLayer *menu_layer_compare;
+
+// Sessions compared, A against B. Rows are drawn straight from the lap memory
+// as they scroll into view, so nothing is kept per lap
+static uint8_t session_a;
+static uint8_t session_b;
+
+// Helper function declaration
+static void window_load(Window *);
+static void window_unload(Window *);
+
+static uint8_t num_laps(uint8_t s) {
+  return session[s].end_index - session[s].start_index + 1;
+}
+
+// m:ss.c, or h:mm:ss from an hour
+static void format_time(char *str, size_t size, int32_t cs) {
+  if (cs >= 360000)
+    snprintf(str, size, "%d:%02d:%02d", (int)(cs/360000), (int)(cs/6000%60), (int)(cs/100%60));
+  else
+    snprintf(str, size, "%d:%02d.%d", (int)(cs/6000), (int)(cs/100%60), (int)(cs/10%10));
+}
+
+// +s.cc under a minute, +m:ss from there
+static void format_delta(char *str, size_t size, int32_t cs) {
+  char sign = (cs < 0) ? '-' : '+';
+  if (cs < 0) { cs = -cs; }
+  if (cs < 6000)
+    snprintf(str, size, "%c%d.%02d", sign, (int)(cs/100), (int)(cs%100));
+  else
+    snprintf(str, size, "%c%d:%02d", sign, (int)(cs/6000), (int)(cs/100%60));
+}
+
+static uint16_t num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *callback_context) {
+  uint8_t a = num_laps(session_a);
+  uint8_t b = num_laps(session_b);
+  // A row per lap of the longer session, then the totals
+  return ((a > b) ? a : b) + 1;
+}
+
+static int16_t get_cell_height_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *callback_context) {
+  return ROW_HEIGHT_COMPARE;
+}
+
+static int16_t get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *callback_context) {
+  return 17;
+}
+
+static void draw_header_callback(GContext *ctx, const Layer *cell_layer, uint16_t section_index, void *callback_context) {
+  char header[24];
+  snprintf(header, sizeof(header), "Session %d vs %d", session_a+1, session_b+1);
+  menu_cell_basic_header_draw(ctx, cell_layer, header);
+}
+
+// Lap row-1 of both sessions, or both totals on the last row. A session without
+// that lap shows a dash and there is no delta
+static void draw_row_callback(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *callback_context) {
+  GRect bounds = layer_get_bounds(cell_layer);
+  GFont font = fonts_get_system_font(FONT_KEY_GOTHIC_18);
+  uint16_t row = cell_index->row;
+  bool total = (row == num_rows_callback(menu_layer_compare, 0, NULL)-1);
+  bool has_a = total || row < num_laps(session_a);
+  bool has_b = total || row < num_laps(session_b);
+  int32_t cs_a = 0;
+  int32_t cs_b = 0;
+  char str[10];
+
+  if (has_a) {
+    cs_a = total ? split_cs[session[session_a].end_index] :
+                   get_lap_cs(session[session_a], session[session_a].start_index+row);
+  }
+  if (has_b) {
+    cs_b = total ? split_cs[session[session_b].end_index] :
+                   get_lap_cs(session[session_b], session[session_b].start_index+row);
+  }
+
+  if (total) {
+    strcpy(str, "T");
+  } else {
+    snprintf(str, sizeof(str), "%d", row+1);
+  }
+  graphics_draw_text(ctx, str, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+                     GRect(0, -1, COLUMN_LAP_W, bounds.size.h), GTextOverflowModeFill, GTextAlignmentRight, NULL);
+
+  if (has_a) { format_time(str, sizeof(str), cs_a); } else { strcpy(str, "-"); }
+  graphics_draw_text(ctx, str, font, GRect(COLUMN_LAP_W+2, -1, COLUMN_TIME_W, bounds.size.h),
+                     GTextOverflowModeFill, GTextAlignmentRight, NULL);
+
+  if (has_b) { format_time(str, sizeof(str), cs_b); } else { strcpy(str, "-"); }
+  graphics_draw_text(ctx, str, font, GRect(COLUMN_LAP_W+2+COLUMN_TIME_W, -1, COLUMN_TIME_W, bounds.size.h),
+                     GTextOverflowModeFill, GTextAlignmentRight, NULL);
+
+  if (has_a && has_b) {
+    format_delta(str, sizeof(str), cs_a - cs_b);
+    graphics_draw_text(ctx, str, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+                       GRect(COLUMN_LAP_W+2+2*COLUMN_TIME_W, -1, bounds.size.w-COLUMN_LAP_W-4-2*COLUMN_TIME_W, bounds.size.h),
+                       GTextOverflowModeFill, GTextAlignmentRight, NULL);
+  }
+}
+
+// Next session after s, skipping other
+static uint8_t next_session(uint8_t s, uint8_t other) {
+  do { s = (s+1) % session_index; } while (s == other);
+  return s;
+}
+
+// SELECT: compare against the next session, hold SELECT: swap A and B
+static void select_click_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *callback_context) {
+  session_b = next_session(session_b, session_a);
+  menu_layer_reload_data(menu_layer_compare);
+}
+
+static void select_long_click_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *callback_context) {
+  uint8_t a = session_a;
+  session_a = session_b;
+  session_b = a;
+  menu_layer_reload_data(menu_layer_compare);
+}
+
+// Initialize session comparison window hander
+void ui_compare_init(void) {
+  window = window_create();
+  window_set_window_handlers(window, (WindowHandlers) {
+    .load = window_load,
+    .unload = window_unload,
+  });
+}
+
+void ui_compare_deinit(void) {
+  window_destroy(window);
+}
+
+// Compare saved sessions a and b, which must differ
+void ui_compare_spawn(uint8_t a, uint8_t b) {
+  session_a = a;
+  session_b = b;
+  window_stack_push(window, false);
+}
+
+//----- Begin session comparison window load/unload
+static void window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+
+  menu_layer_compare = menu_layer_create(layer_get_frame(window_layer));
+  menu_layer_set_click_config_onto_window(menu_layer_compare, window);
+  menu_layer_set_callbacks(menu_layer_compare, NULL, (MenuLayerCallbacks) {
+    .draw_header       = (MenuLayerDrawHeaderCallback) draw_header_callback,
+    .draw_row          = (MenuLayerDrawRowCallback) draw_row_callback,
+    .get_header_height = (MenuLayerGetHeaderHeightCallback) get_header_height_callback,
+    .get_cell_height   = (MenuLayerGetCellHeightCallback) get_cell_height_callback,
+    .get_num_rows      = (MenuLayerGetNumberOfRowsInSectionsCallback) num_rows_callback,
+    .select_click      = (MenuLayerSelectCallback) select_click_callback,
+    .select_long_click = (MenuLayerSelectCallback) select_long_click_callback,
+  });
+  layer_add_child(window_layer, menu_layer_get_layer(menu_layer_compare));
+}
+
+static void window_unload(Window *window) {
+  menu_layer_destroy(menu_layer_compare);
+}
+//----- End session comparison window load/unload
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef UI_COMPARE_H
+#define UI_COMPARE_H
+
+extern void ui_compare_init(void);
+extern void ui_compare_deinit(void);
+extern void ui_compare_spawn(uint8_t, uint8_t);
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "pebble.h"
 #include "ui_instant_recall.h"
 #include "stopwatch.h"
+#include "palette.h"
   
 // Instant recall window and layers
 static Window *window;
@@ -8,7 +9,6 @@ static ScrollLayer *scroll_layer;
 static TextLayer *text_layer_header;
 static TextLayer *text_layer_left;
 static TextLayer *text_layer_right;
-static InverterLayer *inverter_layer;
 
 // Helper function declaration
 static void window_load(Window *);
@@ -26,7 +26,6 @@ void ui_instant_recall_init(void) {
     .load = window_load,
     .unload = window_unload,
   });
-  window_set_background_color(window, GColorWhite);
 }
 
 void ui_instant_recall_deinit(void) {
@@ -42,6 +41,7 @@ void window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
   GRect frame = layer_get_frame(window_layer);
   
+  window_set_background_color(window, palette_get()->background);
   scroll_layer = scroll_layer_create(frame);
   scroll_layer_set_click_config_onto_window(scroll_layer, window);
   
@@ -49,6 +49,7 @@ void window_load(Window *window) {
   text_layer_header = text_layer_create(GRect(frame.origin.x+5, frame.origin.y, frame.size.w-10, 30));
   text_layer_set_font(text_layer_header, fonts_get_system_font(FONT_KEY_GOTHIC_28_BOLD));
   text_layer_set_text_alignment(text_layer_header, GTextAlignmentCenter);
+  palette_apply_text_layer(text_layer_header);
   static char header[20];
   snprintf(header, sizeof(header), "Session %d\n", session_index+1);
   text_layer_set_text(text_layer_header, header);
@@ -93,12 +94,14 @@ void window_load(Window *window) {
   text_layer_left = text_layer_create(GRect((frame.size.w-max_size_left.w-max_size_right.w-10)/2, 30, max_size_left.w, max_size_right.h+15));
   text_layer_set_font(text_layer_left, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
   text_layer_set_text_alignment(text_layer_left, GTextAlignmentLeft);  
+  palette_apply_text_layer(text_layer_left);
   text_layer_set_text(text_layer_left, str_left);
 
   // Set up recall text layer (right)
   text_layer_right = text_layer_create(GRect((frame.size.w-max_size_left.w-max_size_right.w-10)/2+max_size_left.w+10, 30, max_size_right.w, max_size_left.h+15));
   text_layer_set_font(text_layer_right, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
   text_layer_set_text_alignment(text_layer_right, GTextAlignmentRight);
+  palette_apply_text_layer(text_layer_right);
   text_layer_set_text(text_layer_right, str_right);
     
   GSize max_size = text_layer_get_content_size(text_layer_right);
@@ -106,11 +109,6 @@ void window_load(Window *window) {
   scroll_layer_add_child(scroll_layer, text_layer_get_layer(text_layer_left));
   scroll_layer_add_child(scroll_layer, text_layer_get_layer(text_layer_right));
   layer_add_child(window_layer, scroll_layer_get_layer(scroll_layer));
-
-  // Add inverter layer
-  inverter_layer = inverter_layer_create(frame);
-  layer_add_child(window_layer, inverter_layer_get_layer(inverter_layer));
-  layer_set_hidden(inverter_layer_get_layer(inverter_layer), (invert_color==true) ? 0 : 1);
 }
 
 void window_unload(Window *window) {
@@ -120,6 +118,5 @@ void window_unload(Window *window) {
   text_layer_destroy(text_layer_left);
   text_layer_destroy(text_layer_right);
   scroll_layer_destroy(scroll_layer);
-  inverter_layer_destroy(inverter_layer);
 }
 //----- End recall window load/unload
\ No newline at end of file
@@ -3,36 +3,157 @@
 #include "stopwatch.h"
 #include "cdt.h"
 #include "ui_review.h"
+#include "ui_compare.h"
 #include "ui_timer_config.h"
 #include "ui_preset_assistant.h"
+#include "ui_multi_lane.h"
+#include "ui_chute.h"
+#include "lanes.h"
+#include "chute.h"
+#include "export.h"
+#include "probe.h"
+#include "summary.h"
+#include "ghost.h"
+#include "training.h"
+
+// Rows of the session review section before the first session
+#define REVIEW_FIRST_SESSION_ROW 3
+#define ROW_HEIGHT_BASIC   44
+#define ROW_HEIGHT_SESSION 60  // Title, date, then laps and times
+
+enum menu_section_e {MENU_SECTION_APPEARANCE,
+                     MENU_SECTION_MULTI_LANE,
+                     MENU_SECTION_CHUTE,
+                     MENU_SECTION_REVIEW,
+                     MENU_SECTION_TRAINING,
+                     MENU_SECTION_PACERBAND,
+#ifdef PROBE_ENABLE
+                     MENU_SECTION_DIAGNOSTICS,   // Only in probe builds
+#endif
+                     MENU_SECTION_SIZE};
   
 static Window *window;
 static MenuLayer *menu_layer_main_menu;
 static MenuLayerCallbacks menu_layer_callbacks;
 
+// The latest session against the ghost, or against the one before it
+static void get_compare_pair(uint8_t *a, uint8_t *b) {
+  *a = session_index-1;
+  *b = (ghost_get_session() < *a) ? ghost_get_session() : session_index-2;
+}
+
 static int16_t get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *callback_context) {
   return 17;
 }
 
+static int16_t get_cell_height_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *callback_context) {
+  return (((cell_index->section == MENU_SECTION_REVIEW) && (cell_index->row >= REVIEW_FIRST_SESSION_ROW)) ||
+          (cell_index->section == MENU_SECTION_TRAINING)) ?
+         ROW_HEIGHT_SESSION : ROW_HEIGHT_BASIC;
+}
+
+// h:mm:ss, or m:ss under an hour
+static void format_swtime(char *str, size_t size, SWTime t) {
+  if (t.hour > 0)
+    snprintf(str, size, "%d:%02d:%02d", t.hour, t.minute, t.second);
+  else
+    snprintf(str, size, "%d:%02d", t.minute, t.second);
+}
+
+// Drawn from the session's summary alone
+static void draw_session_row(GContext *ctx, const Layer *cell_layer, uint8_t index) {
+  const SummaryRow_t *row = summary_get(index);
+  GRect bounds = layer_get_bounds(cell_layer);
+  char title[12];
+  char laps[24];
+  char best[16];
+  char time_str[9];
+
+  // The session raced against, or one kept from eviction, is marked in place of the word Session
+  snprintf(title, sizeof(title), (index == ghost_get_session()) ? "Ghost %d" :
+                                 session_is_pinned(index)       ? "Pinned %d" : "Session %d", index+1);
+  format_swtime(time_str, sizeof(time_str), row->summary.total);
+  snprintf(laps, sizeof(laps), "%d Laps, %s", row->summary.num_laps, time_str);
+  format_swtime(time_str, sizeof(time_str), row->summary.best_lap);
+  snprintf(best, sizeof(best), "Best %s", time_str);
+
+  graphics_draw_text(ctx, title, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+                     GRect(5, -4, bounds.size.w-10, 26), GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+  graphics_draw_text(ctx, row->date, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                     GRect(5, 20, bounds.size.w-10, 20), GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+  graphics_draw_text(ctx, laps, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                     GRect(5, 38, bounds.size.w-10, 20), GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+  graphics_draw_text(ctx, best, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                     GRect(5, -1, bounds.size.w-10, 20), GTextOverflowModeTrailingEllipsis, GTextAlignmentRight, NULL);
+}
+
+// Today, this week and last week, each read from its bucket of the training log
+static void draw_training_row(GContext *ctx, const Layer *cell_layer, uint16_t row) {
+  static const char *titles[] = {"Today", "This Week", "Last Week"};
+  time_t now = time(NULL);
+  const TrainingBucket_t *b = (row == 0) ? training_get_day(now, 0) : training_get_week(now, row-1);
+  GRect bounds = layer_get_bounds(cell_layer);
+  char count[24];
+  char total[16];
+  char best[16];
+  char time_str[9];
+
+  strcpy(best, "");
+  if (b) {
+    snprintf(count, sizeof(count), "%d Sessions, %d Laps", b->sessions, b->laps);
+    format_swtime(time_str, sizeof(time_str), SWTime_from_centisecond(b->total_cs));
+    snprintf(total, sizeof(total), "Total %s", time_str);
+    format_swtime(time_str, sizeof(time_str), SWTime_from_centisecond(b->best_lap_cs));
+    snprintf(best, sizeof(best), "Best %s", time_str);
+  } else {
+    strcpy(count, "No Sessions");
+    strcpy(total, "");
+  }
+
+  graphics_draw_text(ctx, titles[row], fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD),
+                     GRect(5, -4, bounds.size.w-10, 26), GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+  graphics_draw_text(ctx, count, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                     GRect(5, 20, bounds.size.w-10, 20), GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+  graphics_draw_text(ctx, total, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                     GRect(5, 38, bounds.size.w-10, 20), GTextOverflowModeTrailingEllipsis, GTextAlignmentLeft, NULL);
+  graphics_draw_text(ctx, best, fonts_get_system_font(FONT_KEY_GOTHIC_18),
+                     GRect(5, -1, bounds.size.w-10, 20), GTextOverflowModeTrailingEllipsis, GTextAlignmentRight, NULL);
+}
+
 static void draw_header_callback(GContext *ctx, const Layer *cell_layer, uint16_t section_index, void *callback_context) {
   switch(section_index) {
-    case 0:
+    case MENU_SECTION_APPEARANCE:
       menu_cell_basic_header_draw(ctx, cell_layer, "Appearance");
       break;
-    case 1:
+    case MENU_SECTION_MULTI_LANE:
+      menu_cell_basic_header_draw(ctx, cell_layer, "Multi-Athlete");
+      break;
+    case MENU_SECTION_CHUTE:
+      menu_cell_basic_header_draw(ctx, cell_layer, "Finish Chute");
+      break;
+    case MENU_SECTION_REVIEW:
       menu_cell_basic_header_draw(ctx, cell_layer, "Session Review");
       break;
-    case 2:
+    case MENU_SECTION_TRAINING:
+      menu_cell_basic_header_draw(ctx, cell_layer, "Training Log");
+      break;
+    case MENU_SECTION_PACERBAND:
       menu_cell_basic_header_draw(ctx, cell_layer, "Pacerband");
       break;
+#ifdef PROBE_ENABLE
+    case MENU_SECTION_DIAGNOSTICS:
+      menu_cell_basic_header_draw(ctx, cell_layer, "Diagnostics");
+      break;
+#endif
   }
 }
 
 static uint16_t get_num_sections_callback(MenuLayer *menu_layer, void *callback_context) {
-  return 3;
+  return MENU_SECTION_SIZE;
 }
   
 static void draw_row_callback(GContext *ctx, const Layer *cell_layer, MenuIndex *cell_index, void *callback_context) {
+  PROBE_SCOPE(PROBE_MENU_DRAW);
   char title[17];
   char body[20];
   int index;
@@ -40,24 +161,70 @@ static void draw_row_callback(GContext *ctx, const Layer *cell_layer, MenuIndex
   SWTime cdt_lap;
   
   switch(cell_index->section) {
-    case 0:
+    case MENU_SECTION_APPEARANCE:
       menu_cell_basic_draw(ctx, cell_layer, "Display Color", invert_color ? "Inverted" : "Regular", NULL);
       break;
-    case 1:
+    case MENU_SECTION_MULTI_LANE:
+      switch (cell_index->row) {
+        case 0:
+          menu_cell_basic_draw(ctx, cell_layer, "Open Lanes", "Hold UP: Mass Start", NULL);
+          break;
+        case 1:
+          snprintf(body, sizeof(body), "%d Lanes", lanes_get_count());
+          menu_cell_basic_draw(ctx, cell_layer, "Lane Count", body, NULL);
+          break;
+      }
+      break;
+    case MENU_SECTION_CHUTE:
+      snprintf(body, sizeof(body), "%d Finishers", chute_get_count());
+      menu_cell_basic_draw(ctx, cell_layer, "Open Chute", body, NULL);
+      break;
+    case MENU_SECTION_REVIEW:
       switch (cell_index->row) {
         case 0:
           snprintf(body, sizeof(body), "%d/%d Free",
                    NUM_LAP_MEMORY-session[session_index].end_index, NUM_LAP_MEMORY);
           menu_cell_basic_draw(ctx, cell_layer, "Memory Status", body, NULL);
           break;
+        case 1:
+          switch (export_get_state()) {
+            case EXPORT_STATE_SEND:
+              snprintf(body, sizeof(body), "%d%% Sent", export_get_progress());
+              break;
+            case EXPORT_STATE_END:
+              strcpy(body, "Finishing");
+              break;
+            case EXPORT_STATE_DONE:
+              strcpy(body, "Done");
+              break;
+            case EXPORT_STATE_FAILED:
+              strcpy(body, "Failed, Retry?");
+              break;
+            default:
+              strcpy(body, "All Sessions");
+              break;
+          }
+          menu_cell_basic_draw(ctx, cell_layer, "Export to Phone", body, NULL);
+          break;
+        case 2:
+          if (session_index < 2) {
+            strcpy(body, "Needs 2 Sessions");
+          } else {
+            uint8_t a, b;
+            get_compare_pair(&a, &b);
+            snprintf(body, sizeof(body), "Session %d vs %d", a+1, b+1);
+          }
+          menu_cell_basic_draw(ctx, cell_layer, "Compare", body, NULL);
+          break;
         default:
-          snprintf(title, sizeof(title), "Session %d", cell_index->row);
-          strftime(body, sizeof(body), "%m/%d/%Y %I:%M %p", localtime(&save_time[cell_index->row-1]));
-          menu_cell_basic_draw(ctx, cell_layer, title, body, NULL);
+          draw_session_row(ctx, cell_layer, cell_index->row-REVIEW_FIRST_SESSION_ROW);
           break;
       }
       break;
-    case 2:
+    case MENU_SECTION_TRAINING:
+      draw_training_row(ctx, cell_layer, cell_index->row);
+      break;
+    case MENU_SECTION_PACERBAND:
       switch (cell_index->row) {
         case 0:
           menu_cell_basic_draw(ctx, cell_layer, "Pacerband",
@@ -67,9 +234,10 @@ static void draw_row_callback(GContext *ctx, const Layer *cell_layer, MenuIndex
           break;
         case 1:
           snprintf(body, sizeof(body),
-                   "%d/%d Free",
-                   CDT_MAX_LENGTH-(cdt->length),
-                   CDT_MAX_LENGTH);
+                   "%d Seg, %d/%d Free",
+                   cdt->length,
+                   CDT_MAX_BLOCKS-(cdt->num_blocks),
+                   CDT_MAX_BLOCKS);
           menu_cell_basic_draw(ctx, cell_layer, "Reset All?", body, NULL);
           break;
         case 2:
@@ -79,7 +247,7 @@ static void draw_row_callback(GContext *ctx, const Layer *cell_layer, MenuIndex
           index=cell_index->row-3;
           cdt_lap = cdt_get_lap(index);
           snprintf(title, sizeof(title),
-                   "Timer Segment %d",
+                   "Segment %d",
                    index+1);
           snprintf(body, sizeof(body),
                    "%d:%02d:%02d",
@@ -90,6 +258,17 @@ static void draw_row_callback(GContext *ctx, const Layer *cell_layer, MenuIndex
           break;
       }
       break;
+#ifdef PROBE_ENABLE
+    case MENU_SECTION_DIAGNOSTICS:
+      if (cell_index->row == PROBE_SIZE) {
+        menu_cell_basic_draw(ctx, cell_layer, "Dump to Log", "Hold: Reset", NULL);
+      } else {
+        ProbeStats stats = probe_get_stats(cell_index->row);
+        snprintf(body, sizeof(body), "%u/%u/%u ms", stats.p50_ms, stats.p99_ms, stats.max_ms);
+        menu_cell_basic_draw(ctx, cell_layer, probe_get_name(cell_index->row), body, NULL);
+      }
+      break;
+#endif
   }
 }
  
@@ -97,17 +276,34 @@ static uint16_t num_rows_callback(MenuLayer *menu_layer, uint16_t section_index,
   cdt_t *cdt = cdt_get();
 
   switch (section_index) {
-    case 0:
+    case MENU_SECTION_APPEARANCE:
       return 1;
       break;
-    case 1:
-      // 1 for memory status
-      return session_index + 1;
+    case MENU_SECTION_MULTI_LANE:
+      // 1 for opening lanes, 1 for lane count
+      return 2;
       break;
-    case 2:
+    case MENU_SECTION_CHUTE:
+      return 1;
+      break;
+    case MENU_SECTION_REVIEW:
+      // 1 for memory status, 1 for export, 1 for compare
+      return session_index + REVIEW_FIRST_SESSION_ROW;
+      break;
+    case MENU_SECTION_TRAINING:
+      // Today, this week, last week
+      return 3;
+      break;
+    case MENU_SECTION_PACERBAND:
       // 1 for config, 1 for reset-all, and cdt_length + 1
-      return (cdt->length) + (((cdt->length)==CDT_MAX_LENGTH) ? 3 : 4) ;
+      return (cdt->length) + (((cdt->length)==CDT_MAX_SEGMENTS) ? 3 : 4) ;
+      break;
+#ifdef PROBE_ENABLE
+    case MENU_SECTION_DIAGNOSTICS:
+      // p50/p99/max per probe, and 1 for the log dump
+      return PROBE_SIZE + 1;
       break;
+#endif
   }
   return 0;
 }
@@ -117,20 +313,46 @@ static void select_click_callback(MenuLayer *menu_layer, MenuIndex *cell_index,
   cdt_t *cdt = cdt_get();
 
   switch(cell_index->section) {
-    case 0:
+    case MENU_SECTION_APPEARANCE:
       invert_color = (invert_color==false) ? true : false;
       layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
       break;
-    case 1:
+    case MENU_SECTION_MULTI_LANE:
+      switch (cell_index->row) {
+        case 0:
+          ui_multi_lane_spawn();
+          break;
+        case 1:
+          // Cycle lane count, wrapping back to the smallest count that keeps busy lanes visible
+          lanes_set_count((lanes_get_count() >= NUM_LANES) ? lanes_get_min_count() : lanes_get_count()+1);
+          layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
+          break;
+      }
+      break;
+    case MENU_SECTION_CHUTE:
+      ui_chute_spawn();
+      break;
+    case MENU_SECTION_REVIEW:
       switch (cell_index->row) {
         case 0:
           break;
+        case 1:
+          export_start(0);
+          layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
+          break;
+        case 2:
+          if (session_index >= 2) {
+            uint8_t a, b;
+            get_compare_pair(&a, &b);
+            ui_compare_spawn(a, b);
+          }
+          break;
         default:
-          ui_review_spawn(cell_index->row-1);
+          ui_review_spawn(cell_index->row-REVIEW_FIRST_SESSION_ROW);
           break;
       }
       break;
-    case 2:
+    case MENU_SECTION_PACERBAND:
       switch (cell_index->row) {
         case 0:
           // Toggle "disabled" -> "enabled, single" -> "enabled, repeat"
@@ -155,9 +377,44 @@ static void select_click_callback(MenuLayer *menu_layer, MenuIndex *cell_index,
           break;
       }
       break;
+#ifdef PROBE_ENABLE
+    case MENU_SECTION_DIAGNOSTICS:
+      probe_log_dump();
+      layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
+      break;
+#endif
   }
 }
 
+// Hold on a session: race against it, or stop racing against it. Elsewhere a
+// long press stays a plain select
+static void select_long_click_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *callback_context) {
+  uint8_t index;
+
+  switch (cell_index->section) {
+    case MENU_SECTION_REVIEW:
+      if (cell_index->row < REVIEW_FIRST_SESSION_ROW) { break; }
+      index = cell_index->row-REVIEW_FIRST_SESSION_ROW;
+      ghost_set_session((index == ghost_get_session()) ? GHOST_NONE : index);
+      vibes_short_pulse();
+      layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
+      return;
+#ifdef PROBE_ENABLE
+    case MENU_SECTION_DIAGNOSTICS:
+      probe_reset();
+      vibes_short_pulse();
+      layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
+      return;
+#endif
+  }
+  select_click_callback(menu_layer, cell_index, callback_context);
+}
+
+// Redraw export progress as the phone acknowledges packets
+static void export_status_handler(void) {
+  layer_mark_dirty(menu_layer_get_layer(menu_layer_main_menu));
+}
+
 //----- Begin main menu window load/unload
 static void window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
@@ -168,9 +425,11 @@ static void window_load(Window *window) {
   menu_layer_set_callbacks(menu_layer_main_menu, NULL, menu_layer_callbacks);
   
   layer_add_child(window_layer, menu_layer_get_layer(menu_layer_main_menu));
+  export_set_status_handler(export_status_handler);
 }
 
 static void window_unload(Window *window) {
+  export_set_status_handler(NULL);
   menu_layer_destroy(menu_layer_main_menu);
 }
 
@@ -197,8 +456,11 @@ static void window_appear(Window *window) {
 // Initialize recall window hander
 void ui_main_menu_init(void) {
   ui_review_init();
+  ui_compare_init();
   ui_timer_config_init();
   ui_preset_assistant_init();
+  ui_multi_lane_init();
+  ui_chute_init();
   
   window = window_create();
   window_set_window_handlers(window, (WindowHandlers){
@@ -210,15 +472,20 @@ void ui_main_menu_init(void) {
   menu_layer_callbacks.draw_header       = (MenuLayerDrawHeaderCallback) draw_header_callback;
   menu_layer_callbacks.draw_row          = (MenuLayerDrawRowCallback) draw_row_callback;
   menu_layer_callbacks.get_header_height = (MenuLayerGetHeaderHeightCallback) get_header_height_callback;
+  menu_layer_callbacks.get_cell_height   = (MenuLayerGetCellHeightCallback) get_cell_height_callback;
   menu_layer_callbacks.get_num_sections  = (MenuLayerGetNumberOfSectionsCallback) get_num_sections_callback;
   menu_layer_callbacks.get_num_rows      = (MenuLayerGetNumberOfRowsInSectionsCallback) num_rows_callback;
   menu_layer_callbacks.select_click      = (MenuLayerSelectCallback)select_click_callback;
+  menu_layer_callbacks.select_long_click = (MenuLayerSelectCallback)select_long_click_callback;
 }
 
 void ui_main_menu_deinit(void) {
   ui_review_deinit();
+  ui_compare_deinit();
   ui_timer_config_deinit();
   ui_preset_assistant_deinit();
+  ui_multi_lane_deinit();
+  ui_chute_deinit();
   
   window_destroy(window);
 }
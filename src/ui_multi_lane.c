@@ -0,0 +1,241 @@
+#include "pebble.h"
+#include "ui_multi_lane.h"
+#include "stopwatch.h"
+#include "lanes.h"
+#include "palette.h"
+
+// Multi-athlete window and layers
+static Window *window;
+static Layer *layer_lane[NUM_LANES];
+static AppTimer *timer;
+
+// Helper function declaration
+static void window_load(Window *);
+static void window_appear(Window *);
+static void window_disappear(Window *);
+static void window_unload(Window *);
+static void click_config_provider(void *);
+
+// Lane selector and per-lane render cache
+static uint8_t selected_lane;
+static int32_t lane_key[NUM_LANES];   // Last rendered time, in displayed resolution
+static char lane_time_str[NUM_LANES][12];
+static char lane_num_str[NUM_LANES][3];
+static char lane_lap_str[NUM_LANES][4];
+
+// Re-render a lane only if its displayed text would change
+// Only the selected lane displays centiseconds, so other lanes change at most once per second
+static void refresh_lane(uint8_t i, bool force) {
+  Lane_t *lane = lanes_get(i);
+  SWTime t = lanes_elapsed(i);
+  int32_t key = (((int32_t)t.hour*60 + t.minute)*60 + t.second)*100 + ((i == selected_lane) ? t.centisecond : 0);
+
+  if (!force && key == lane_key[i]) { return; }
+  lane_key[i] = key;
+
+  if (lane->state == LANE_STATE_IDLE) {
+    strcpy(lane_time_str[i], "--:--");
+  } else if (t.hour > 0) {
+    snprintf(lane_time_str[i], sizeof(lane_time_str[i]), "%d:%02d:%02d", t.hour, t.minute, t.second);
+  } else if (i == selected_lane) {
+    snprintf(lane_time_str[i], sizeof(lane_time_str[i]), "%02d:%02d.%02d", t.minute, t.second, t.centisecond);
+  } else {
+    snprintf(lane_time_str[i], sizeof(lane_time_str[i]), "%02d:%02d", t.minute, t.second);
+  }
+  snprintf(lane_lap_str[i], sizeof(lane_lap_str[i]), "L%d", lane->num_splits+1);
+  layer_mark_dirty(layer_lane[i]);
+}
+
+static void layer_lane_update_callback(Layer *layer, GContext *ctx) {
+  uint8_t i = *(uint8_t *)layer_get_data(layer);
+  Lane_t *lane = lanes_get(i);
+  GRect bounds = layer_get_bounds(layer);
+  GFont font = fonts_get_system_font((bounds.size.h >= 30) ? FONT_KEY_GOTHIC_28_BOLD : FONT_KEY_GOTHIC_18_BOLD);
+  int16_t text_y = (bounds.size.h >= 30) ? (bounds.size.h-34)/2 : (bounds.size.h-22)/2;
+
+  // Highlight the selected lane, drawn in the scheme's colors swapped
+  const Palette_t *palette = palette_get();
+  GColor fg = (i == selected_lane) ? palette->background : palette->foreground;
+  if (i == selected_lane) {
+    graphics_context_set_fill_color(ctx, palette->foreground);
+    graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  }
+  graphics_context_set_text_color(ctx, fg);
+  graphics_context_set_fill_color(ctx, fg);
+  graphics_context_set_stroke_color(ctx, fg);
+
+  // Lane number and state marker (filled: running, hollow: stopped)
+  graphics_draw_text(ctx, lane_num_str[i], font, GRect(0, text_y, 16, bounds.size.h),
+                     GTextOverflowModeFill, GTextAlignmentRight, NULL);
+  if (lane->state == LANE_STATE_RUN) {
+    graphics_fill_circle(ctx, GPoint(22, bounds.size.h/2), 3);
+  } else if (lane->state == LANE_STATE_STOP) {
+    graphics_draw_circle(ctx, GPoint(22, bounds.size.h/2), 3);
+  }
+
+  graphics_draw_text(ctx, lane_time_str[i], font, GRect(28, text_y, bounds.size.w-28-30, bounds.size.h),
+                     GTextOverflowModeFill, GTextAlignmentLeft, NULL);
+  if (lane->state != LANE_STATE_IDLE) {
+    graphics_draw_text(ctx, lane_lap_str[i], font, GRect(bounds.size.w-30, text_y, 28, bounds.size.h),
+                       GTextOverflowModeFill, GTextAlignmentRight, NULL);
+  }
+}
+
+static void timer_callback(void *data);
+
+// One shared tick for all lanes: at full rate while the selected lane runs, once
+// a second while only the others run (they show whole seconds), none otherwise
+static void schedule_tick(void) {
+  uint32_t step_ms = 0;
+
+  for (uint8_t i=0; i<lanes_get_count(); i++) {
+    if (lanes_get(i)->state != LANE_STATE_RUN) { continue; }
+    if (i == selected_lane) { step_ms = SW_STEP_MS_SHORT; break; }
+    step_ms = SW_STEP_MS_GLANCE;
+  }
+  if (timer) { app_timer_cancel(timer); }
+  timer = step_ms ? app_timer_register(step_ms, timer_callback, NULL) : NULL;
+}
+
+static void timer_callback(void *data) {
+  timer = NULL;
+  lanes_tick();
+  for (uint8_t i=0; i<lanes_get_count(); i++) {
+    refresh_lane(i, false);
+  }
+  schedule_tick();
+}
+
+// Initialize multi-athlete window hander
+void ui_multi_lane_init(void) {
+  selected_lane = 0;
+  window = window_create();
+  window_set_click_config_provider(window, click_config_provider);
+  window_set_window_handlers(window, (WindowHandlers) {
+    .load = window_load,
+    .appear = window_appear,
+    .disappear = window_disappear,
+    .unload = window_unload,
+  });
+}
+
+void ui_multi_lane_deinit(void) {
+  window_destroy(window);
+}
+
+void ui_multi_lane_spawn(void) {
+  if (selected_lane >= lanes_get_count()) { selected_lane = 0; }
+  window_stack_push(window, false);
+}
+
+//----- Begin multi-athlete window load/unload
+static void window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  GRect frame = layer_get_frame(window_layer);
+  uint8_t count = lanes_get_count();
+  int16_t row_height = frame.size.h / count;
+
+  for (uint8_t i=0; i<count; i++) {
+    layer_lane[i] = layer_create_with_data(GRect(0, row_height*i, frame.size.w, row_height), sizeof(uint8_t));
+    *(uint8_t *)layer_get_data(layer_lane[i]) = i;
+    layer_set_update_proc(layer_lane[i], layer_lane_update_callback);
+    layer_add_child(window_layer, layer_lane[i]);
+    snprintf(lane_num_str[i], sizeof(lane_num_str[i]), "%d", i+1);
+  }
+}
+
+static void window_appear(Window *window) {
+  // The color scheme may have changed in the menu
+  window_set_background_color(window, palette_get()->background);
+  lanes_tick();
+  for (uint8_t i=0; i<lanes_get_count(); i++) {
+    refresh_lane(i, true);
+  }
+  schedule_tick();
+}
+
+static void window_disappear(Window *window) {
+  if (timer) { app_timer_cancel(timer); }
+  timer = NULL;
+}
+
+static void window_unload(Window *window) {
+  for (uint8_t i=0; i<lanes_get_count(); i++) {
+    layer_destroy(layer_lane[i]);
+  }
+}
+//----- End multi-athlete window load/unload
+
+//----- Begin click handlers
+// UP/DOWN: select lane, SELECT: start or lap the selected lane
+static void single_click_handler(ClickRecognizerRef recognizer, void *context) {
+  int button_id = click_recognizer_get_button_id(recognizer);
+  uint8_t count = lanes_get_count();
+  uint8_t prev_lane = selected_lane;
+
+  switch (button_id) {
+    case BUTTON_ID_UP:
+      selected_lane = (selected_lane == 0) ? count-1 : selected_lane-1;
+      break;
+    case BUTTON_ID_DOWN:
+      selected_lane = (selected_lane+1) % count;
+      break;
+    case BUTTON_ID_SELECT:
+      if (lanes_get(selected_lane)->state == LANE_STATE_RUN) {
+        if (!lanes_lap(selected_lane)) { vibes_short_pulse(); }
+      } else {
+        lanes_start(selected_lane);
+      }
+      break;
+  }
+  refresh_lane(prev_lane, true);
+  refresh_lane(selected_lane, true);
+  schedule_tick();
+}
+
+// Hold SELECT: stop, then save the selected lane
+// Hold UP: mass start all idle lanes, hold DOWN: discard the selected stopped lane
+static void long_click_down_handler(ClickRecognizerRef recognizer, void *context) {
+  int button_id = click_recognizer_get_button_id(recognizer);
+  Lane_t *lane = lanes_get(selected_lane);
+
+  switch (button_id) {
+    case BUTTON_ID_SELECT:
+      if (lane->state == LANE_STATE_RUN) {
+        lanes_stop(selected_lane);
+      } else if (lane->state == LANE_STATE_STOP) {
+        if (lanes_save(selected_lane)) {
+          vibes_short_pulse();
+        } else {
+          vibes_double_pulse();
+        }
+      }
+      refresh_lane(selected_lane, true);
+      break;
+    case BUTTON_ID_UP:
+      lanes_start_all();
+      for (uint8_t i=0; i<lanes_get_count(); i++) {
+        refresh_lane(i, true);
+      }
+      break;
+    case BUTTON_ID_DOWN:
+      if (lane->state != LANE_STATE_STOP) { break; }
+      lanes_reset(selected_lane);
+      vibes_short_pulse();
+      refresh_lane(selected_lane, true);
+      break;
+  }
+  schedule_tick();
+}
+
+static void click_config_provider(void *context) {
+  // Single click
+  window_single_click_subscribe(BUTTON_ID_UP,     single_click_handler);
+  window_single_click_subscribe(BUTTON_ID_SELECT, single_click_handler);
+  window_single_click_subscribe(BUTTON_ID_DOWN,   single_click_handler);
+  // Long click
+  window_long_click_subscribe(BUTTON_ID_UP,     CLICK_HOLD_MS, long_click_down_handler, NULL);
+  window_long_click_subscribe(BUTTON_ID_SELECT, CLICK_HOLD_MS, long_click_down_handler, NULL);
+  window_long_click_subscribe(BUTTON_ID_DOWN,   CLICK_HOLD_MS, long_click_down_handler, NULL);
+}
+//----- End click handlers
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef UI_MULTI_LANE_H
+#define UI_MULTI_LANE_H
+
+extern void ui_multi_lane_init(void);
+extern void ui_multi_lane_deinit(void);
+extern void ui_multi_lane_spawn(void);
+
+#endif
\ No newline at end of file
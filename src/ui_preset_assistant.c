@@ -3,6 +3,7 @@
 //#include "stopwatch.h"
 #include "swtime.h"
 #include "cdt.h"
+#include "layout.auto.h"
 
 // Instant recall window and layers
 static Window *window;
@@ -10,6 +11,7 @@ static TextLayer *text_layer_header;
 static TextLayer *text_layer_digit[6];
 static TextLayer *text_layer_delimiter[2];
 static TextLayer *text_layer_footer;
+static TextLayer *text_layer_step_footer;
 
 static Layer *graphics_layer;
 
@@ -25,17 +27,21 @@ static void update_displayed_digits(unsigned char);
 static void update_displayed_focus(void);
 
 // Main string container
-static char text_digit[4][5];  // Fixed-length substring
+static char text_digit[5][6];  // Fixed-length substring
 static uint8_t focus_index;    // One of enum_fields
 static uint16_t cdt_new_length_tenth;
+static int8_t cdt_new_step;    // Seconds added to each segment, negative split below 0
 static SWTime target_time;     // Target time
 
 enum enum_fields {FOCUS_INDEX_HOUR,
                   FOCUS_INDEX_MINUTE,
                   FOCUS_INDEX_SECOND,
                   FOCUS_INDEX_NUM_SEGMENT,
+                  FOCUS_INDEX_STEP,
                   FOCUS_INDEX_SIZE};
 
+#define CDT_MAX_STEP 60
+
 // Initialize recall window hander
 void ui_preset_assistant_init(void) {
   window = window_create();
@@ -63,16 +69,19 @@ static void graphics_layer_update_callback(Layer *me, GContext *ctx) {
   graphics_context_set_fill_color(ctx, GColorBlack);
   switch(focus_index) {
     case FOCUS_INDEX_HOUR:
-      graphics_fill_rect(ctx, GRect(1,55,24,34), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_preset_focus[0], 5, GCornersAll);
       break;
     case FOCUS_INDEX_MINUTE:
-      graphics_fill_rect(ctx, GRect(34,55,50,34), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_preset_focus[1], 5, GCornersAll);
       break;
     case FOCUS_INDEX_SECOND:
-      graphics_fill_rect(ctx, GRect(93,55,50,34), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_preset_focus[2], 5, GCornersAll);
       break;
     case FOCUS_INDEX_NUM_SEGMENT:
-      graphics_fill_rect(ctx, GRect(10,94,46,25), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_preset_focus[3], 5, GCornersAll);
+      break;
+    case FOCUS_INDEX_STEP:
+      graphics_fill_rect(ctx, layout_preset_focus[4], 5, GCornersAll);
       break;
   }
 }
@@ -81,25 +90,24 @@ static void graphics_layer_update_callback(Layer *me, GContext *ctx) {
 void window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
   target_time = (SWTime){.hour=0, .minute=0, .second=0, .centisecond=0};
+  cdt_new_step = 0;
   
   graphics_layer = layer_create(layer_get_frame(window_layer));
   layer_set_update_proc(graphics_layer, graphics_layer_update_callback);
   layer_add_child(window_layer, graphics_layer);
   
   // Set up header (one time only)
-  text_layer_header = text_layer_create(GRect(0,20,144,30));
+  text_layer_header = text_layer_create(layout_preset_header);
   text_layer_set_font(text_layer_header, fonts_get_system_font(FONT_KEY_GOTHIC_24));
   text_layer_set_text_alignment(text_layer_header, GTextAlignmentCenter);
   text_layer_set_text(text_layer_header, "Total / Segments");
   layer_add_child(window_layer, text_layer_get_layer(text_layer_header));
   
-  // Digit width=24, delimiter width=7
-  // Character height 35  
-  text_layer_digit[0]     = text_layer_create(GRect(0,50,26,40));
-  text_layer_delimiter[0] = text_layer_create(GRect(26,50,7,40));
-  text_layer_digit[1]     = text_layer_create(GRect(33,50,52,40));
-  text_layer_delimiter[1] = text_layer_create(GRect(85,50,7,40));
-  text_layer_digit[2]     = text_layer_create(GRect(92,50,52,40));
+  text_layer_digit[0]     = text_layer_create(layout_preset_entry[0]);
+  text_layer_delimiter[0] = text_layer_create(layout_preset_entry[1]);
+  text_layer_digit[1]     = text_layer_create(layout_preset_entry[2]);
+  text_layer_delimiter[1] = text_layer_create(layout_preset_entry[3]);
+  text_layer_digit[2]     = text_layer_create(layout_preset_entry[4]);
   text_layer_set_font(text_layer_digit[0],     fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS));
   text_layer_set_font(text_layer_delimiter[0], fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS));
   text_layer_set_font(text_layer_digit[1],     fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS));
@@ -115,17 +123,27 @@ void window_load(Window *window) {
   text_layer_set_text(text_layer_delimiter[1], ":");
   
   // Segment layers  
-  text_layer_digit[3] = text_layer_create(GRect(8,90,50,30));
+  text_layer_digit[3] = text_layer_create(layout_preset_segments);
   text_layer_set_font(text_layer_digit[3], fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
   text_layer_set_text_alignment(text_layer_digit[3], GTextAlignmentCenter);
   layer_add_child(window_layer, text_layer_get_layer(text_layer_digit[3]));
     
-  text_layer_footer = text_layer_create(GRect(60,90,90,30));
+  text_layer_footer = text_layer_create(layout_preset_segments_footer);
   text_layer_set_font(text_layer_footer, fonts_get_system_font(FONT_KEY_GOTHIC_24));
   text_layer_set_text_alignment(text_layer_footer, GTextAlignmentLeft);
   text_layer_set_text(text_layer_footer, "Segments");
   layer_add_child(window_layer, text_layer_get_layer(text_layer_footer));
   
+  // Step layers
+  text_layer_digit[4] = text_layer_create(layout_preset_step);
+  text_layer_set_font(text_layer_digit[4], fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
+  text_layer_set_text_alignment(text_layer_digit[4], GTextAlignmentCenter);
+  
+  text_layer_step_footer = text_layer_create(layout_preset_step_footer);
+  text_layer_set_font(text_layer_step_footer, fonts_get_system_font(FONT_KEY_GOTHIC_24));
+  text_layer_set_text_alignment(text_layer_step_footer, GTextAlignmentLeft);
+  text_layer_set_text(text_layer_step_footer, "Sec Step");
+  
   layer_add_child(window_layer, text_layer_get_layer(text_layer_digit[0]));
   layer_add_child(window_layer, text_layer_get_layer(text_layer_delimiter[0]));
   layer_add_child(window_layer, text_layer_get_layer(text_layer_digit[1]));
@@ -134,6 +152,8 @@ void window_load(Window *window) {
 
   layer_add_child(window_layer, text_layer_get_layer(text_layer_digit[3]));
   layer_add_child(window_layer, text_layer_get_layer(text_layer_footer));
+  layer_add_child(window_layer, text_layer_get_layer(text_layer_digit[4]));
+  layer_add_child(window_layer, text_layer_get_layer(text_layer_step_footer));
 }
 
 void window_appear(Window *window) {
@@ -151,28 +171,33 @@ void window_disappear(Window *window) {
   } else if (target_time.hour==0 && target_time.minute==0 && target_time.second==0) {
     cdt_reset_all();
   } else {
-    long target_end_centisecond = (long)target_time.hour*360000 +
-                                  (long)target_time.minute*6000 +
-                                  (long)target_time.second*100;
-    long target_lap_centisecond = (target_end_centisecond * 10 / cdt_new_length_tenth);
-    
-    SWTime cdt_split_acc = (SWTime){0, 0, 0, 0};  // CDT split accumulator
-    for (uint8_t i=0; i*10 < cdt_new_length_tenth; i++) {
-      long target_split_centisecond = (cdt_new_length_tenth - i*10 < 10) ? 
-                                      target_end_centisecond : (i+1) * target_lap_centisecond;
-      SWTime cdt_target_split = (SWTime) {.hour = (uint8_t)(target_split_centisecond/360000),
-                                          .minute = (uint8_t)((target_split_centisecond%360000)/6000),
-                                          .second = (uint8_t)((target_split_centisecond%6000)/100),
-                                          .centisecond = 0};
-      cdt_set_lap(i, SWTime_subtract(cdt_target_split, cdt_split_acc));
-      cdt_split_acc = SWTime_add(cdt_split_acc, (cdt->lap)[i]);
-    }
+    // Lay the plan out as one linear block and a last segment that takes up the
+    // rounding, or the remainder when the segment count ends in a fraction
+    int32_t target_end_centisecond = (int32_t)target_time.hour*360000 +
+                                     (int32_t)target_time.minute*6000 +
+                                     (int32_t)target_time.second*100;
+    int32_t num_full = cdt_new_length_tenth / 10;
+    int32_t fraction = cdt_new_length_tenth % 10;
+    int32_t step = cdt_new_step*100;
     
-    // Set new countdown timer length
-    cdt->length = cdt_new_length_tenth / 10 + ((cdt_new_length_tenth % 10 == 0) ? 0 : 1);
+    // The full segments plus the fraction of the segment after them add up to
+    // the target: solve for the first segment, in tenths to stay exact
+    int32_t first = (int32_t)(((int64_t)target_end_centisecond*10 -
+                               (int64_t)step*(5*num_full*(num_full-1) + fraction*num_full)) /
+                              (10*num_full + fraction));
+    uint16_t num_linear = (fraction == 0) ? num_full-1 : num_full;
+    int32_t linear_sum = (int32_t)((int64_t)num_linear*first + (int64_t)step*num_linear*(num_linear-1)/2);
     
-    // Enable CDT if not already
-    cdt->enable = (!cdt->enable) ? true : (cdt->enable);
+    cdt_reset_all();
+    if (!cdt_append_block((CDTBlock_t){.first_cs=first, .step_cs=step, .count=num_linear}) ||
+        !cdt_append_block((CDTBlock_t){.first_cs=target_end_centisecond-linear_sum, .step_cs=0, .count=1})) {
+      // Step too steep for the target: a segment would be negative
+      cdt_reset_all();
+      vibes_short_pulse();
+    } else {
+      // Enable CDT if not already
+      cdt->enable = true;
+    }
   }
   // End assigning timer segments
 }
@@ -187,6 +212,8 @@ void window_unload(Window *window) {
   text_layer_destroy(text_layer_delimiter[0]);
   text_layer_destroy(text_layer_delimiter[1]);
   text_layer_destroy(text_layer_footer);
+  text_layer_destroy(text_layer_digit[4]);
+  text_layer_destroy(text_layer_step_footer);
   cdt_reset();
 }
 //----- End recall window load/unload
@@ -223,7 +250,11 @@ static void repeating_click_handler(ClickRecognizerRef recognizer, void *context
           target_time.second = (target_time.second+1)%60;
           break;
         case FOCUS_INDEX_NUM_SEGMENT:
-          cdt_new_length_tenth = (cdt_new_length_tenth==CDT_MAX_LENGTH*10) ? 0 : (cdt_new_length_tenth+1);
+          cdt_new_length_tenth = (cdt_new_length_tenth==CDT_MAX_SEGMENTS*10) ? 0 : (cdt_new_length_tenth+1);
+          break;
+        case FOCUS_INDEX_STEP:
+          cdt_new_step = (cdt_new_step==CDT_MAX_STEP) ? -CDT_MAX_STEP : (cdt_new_step+1);
+          break;
       }
       update_displayed_digits(focus_index);
       break;
@@ -239,7 +270,10 @@ static void repeating_click_handler(ClickRecognizerRef recognizer, void *context
           target_time.second = (target_time.second==0) ? 59 : (target_time.second-1);
           break;
         case FOCUS_INDEX_NUM_SEGMENT:
-          cdt_new_length_tenth = (cdt_new_length_tenth==0) ? CDT_MAX_LENGTH*10 : (cdt_new_length_tenth-1);
+          cdt_new_length_tenth = (cdt_new_length_tenth==0) ? CDT_MAX_SEGMENTS*10 : (cdt_new_length_tenth-1);
+          break;
+        case FOCUS_INDEX_STEP:
+          cdt_new_step = (cdt_new_step==-CDT_MAX_STEP) ? CDT_MAX_STEP : (cdt_new_step-1);
           break;
       }
       update_displayed_digits(focus_index);
@@ -264,6 +298,10 @@ void update_displayed_digits(unsigned char index) {
     snprintf(text_digit[3], sizeof(text_digit[3]), "%d.%1d", cdt_new_length_tenth/10, cdt_new_length_tenth%10);
     text_layer_set_text(text_layer_digit[3], text_digit[3]);
   }
+  if ((index==FOCUS_INDEX_STEP) || (index==FOCUS_INDEX_SIZE)) {
+    snprintf(text_digit[4], sizeof(text_digit[4]), "%c%d", (cdt_new_step<0) ? '-' : '+', abs(cdt_new_step));
+    text_layer_set_text(text_layer_digit[4], text_digit[4]);
+  }
 }
 
 void update_displayed_focus(void) {
@@ -271,9 +309,11 @@ void update_displayed_focus(void) {
   text_layer_set_text_color(text_layer_digit[1], (focus_index==FOCUS_INDEX_MINUTE) ? GColorWhite : GColorBlack);
   text_layer_set_text_color(text_layer_digit[2], (focus_index==FOCUS_INDEX_SECOND) ? GColorWhite : GColorBlack);
   text_layer_set_text_color(text_layer_digit[3], (focus_index==FOCUS_INDEX_NUM_SEGMENT) ? GColorWhite : GColorBlack);
+  text_layer_set_text_color(text_layer_digit[4], (focus_index==FOCUS_INDEX_STEP) ? GColorWhite : GColorBlack);
   text_layer_set_background_color(text_layer_digit[0], GColorClear);
   text_layer_set_background_color(text_layer_digit[1], GColorClear);
   text_layer_set_background_color(text_layer_digit[2], GColorClear);
   text_layer_set_background_color(text_layer_digit[3], GColorClear);
+  text_layer_set_background_color(text_layer_digit[4], GColorClear);
   layer_mark_dirty(graphics_layer);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "pebble.h"
 #include "ui_review.h"
 #include "stopwatch.h"
+#include "energy.h"
   
 // Instant review window and layers
 static Window *window;
@@ -9,16 +10,19 @@ static TextLayer *text_layer_review_header;
 static TextLayer *text_layer_review_lap_num;
 static TextLayer *text_layer_review_lap;
 static TextLayer *text_layer_review_split;
+static TextLayer *text_layer_review_energy;
 
 // Warning TextLayer and the border TextLayer around it
 static TextLayer *text_layer_review_warning_border;
 static TextLayer *text_layer_review_warning;
 
 static uint16_t review_index;
+static char header[20];
 
 static char* lap_num_str;
 static char* lap_str;
 static char* split_str;
+static char energy_str[96];
 
 enum state_e {
   IDLE,
@@ -71,6 +75,12 @@ void set_warning_text(const Window *window, const char *font_key, char *str) {
   layer_set_hidden(text_layer_get_layer(text_layer_review_warning), false);
 }
 
+static void update_header(void) {
+  snprintf(header, sizeof(header), session_is_pinned(review_index) ? "Session %d Pinned\n" : "Session %d Review\n",
+           review_index+1);
+  text_layer_set_text(text_layer_review_header, header);
+}
+
 // Initialize review window UI
 void ui_review_init(void) {
   state = IDLE;
@@ -123,27 +133,21 @@ void raw_click_up_handler (ClickRecognizerRef recognizer, void *context) {
 void long_click_down_handler(ClickRecognizerRef recognizer, void *context) {
   int button_id = click_recognizer_get_button_id(recognizer);
   switch (state) {
+    case IDLE:
+      if (button_id != BUTTON_ID_DOWN) { break; }
+
+      // Hold DOWN to pin or unpin, apart from SELECT so a reset let go early
+      // changes nothing
+      if (session_set_pinned(review_index, !session_is_pinned(review_index))) {
+        update_header();
+      } else {
+        vibes_double_pulse();
+      }
+      break;
     case RESET_ONE_CONFIRM:
       if (button_id != BUTTON_ID_SELECT) { break; }
       
-      // Shift down all data
-      int shift_down = session[review_index].end_index - session[review_index].start_index + 1;
-      for (uint16_t i=review_index+1; i<session_index; i++) {
-        for (int src_index=session[i].start_index; src_index<=session[i].end_index; src_index++) {
-          int dst_index = src_index - shift_down;
-          split_memory[dst_index] = split_memory[src_index];
-        }
-        session[i-1].start_index = session[i].start_index - shift_down;
-        session[i-1].end_index   = session[i].end_index   - shift_down;
-        //session[i-1].recorded_time = session[i].recorded_time;
-        save_time[i-1] = save_time[i];
-      }
-    
-      session_index--;
-
-      // Define the latest session
-      session[session_index].start_index = (session_index==0) ? 0 : session[session_index-1].end_index+1;
-      session[session_index].end_index = session[session_index].start_index;
+      delete_session(review_index);
     
       // Issue a short vibe
       vibes_short_pulse();
@@ -162,6 +166,7 @@ void long_click_down_handler(ClickRecognizerRef recognizer, void *context) {
 void click_config_provider(void *context) {  
   // Long click
   window_long_click_subscribe(BUTTON_ID_SELECT, CLICK_HOLD_MS, long_click_down_handler, NULL);
+  window_long_click_subscribe(BUTTON_ID_DOWN,   CLICK_HOLD_MS, long_click_down_handler, NULL);
   
   // Raw click
   window_raw_click_subscribe(BUTTON_ID_SELECT, raw_click_down_handler, raw_click_up_handler, NULL);
@@ -184,9 +189,7 @@ void window_load_review(Window *window) {
   text_layer_review_header = text_layer_create(GRect(0, 0, frame.size.w, 18));
   text_layer_set_font(text_layer_review_header, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
   text_layer_set_text_alignment(text_layer_review_header, GTextAlignmentCenter);
-  static char header[20];
-  snprintf(header, sizeof(header), "Session %d Review\n", review_index+1);
-  text_layer_set_text(text_layer_review_header, header);
+  update_header();
   scroll_layer_add_child(scroll_layer_review, text_layer_get_layer(text_layer_review_header));
   
   // Set up review text layer (body)
@@ -205,7 +208,7 @@ void window_load_review(Window *window) {
   // Lap memory report (only cover logged laps)
   int max_str_length;
   max_str_length = (session[review_index].end_index - session[review_index].start_index + 1 >= 10) ?
-                   4 + 18 + 3 * (session[review_index].end_index - session[review_index].start_index + 1 - 10) :
+                   4 + 18 + 3 * (session[review_index].end_index - session[review_index].start_index + 1 - 9) :
                    4 + 2 * (session[review_index].end_index - session[review_index].start_index + 1);
   lap_num_str = malloc(max_str_length);
   max_str_length = 8 + 8 * (session[review_index].end_index - session[review_index].start_index + 1);
@@ -219,6 +222,7 @@ void window_load_review(Window *window) {
   char substr[12];
   for (int i = session[review_index].start_index; i <= session[review_index].end_index; i++) {
     SWTime lap_time = get_lap_time(session[review_index], i);
+    SWTime split_time = SWTime_from_centisecond(split_cs[i]);
     snprintf(substr, sizeof(substr), "%d\n", i-session[review_index].start_index+1);
     strcat(lap_num_str, substr);
     snprintf(substr,
@@ -231,9 +235,9 @@ void window_load_review(Window *window) {
     snprintf(substr,
              sizeof(substr),
              "%d:%02d:%02d\n",
-             split_memory[i].hour,
-             split_memory[i].minute,     
-             split_memory[i].second);
+             split_time.hour,
+             split_time.minute,
+             split_time.second);
     strcat(split_str, substr);
   }
   
@@ -247,10 +251,22 @@ void window_load_review(Window *window) {
   text_layer_set_size(text_layer_review_lap,     GSize(layer_get_frame(text_layer_get_layer(text_layer_review_lap)).size.w,     max_size.h + 15));
   text_layer_set_size(text_layer_review_split,   GSize(layer_get_frame(text_layer_get_layer(text_layer_review_split)).size.w,   max_size.h + 15));
 
-  scroll_layer_set_content_size(scroll_layer_review, GSize(frame.size.w, max_size.h + 30));  
+  // Work done on the watch during the session, below the laps
+  SessionEnergy_t *energy = &session_energy[review_index];
+  snprintf(energy_str, sizeof(energy_str), "Energy\nWakeups %u\nRedraws %u\nText Draws %lu\nPersist Writes %u\nVibes %u\n",
+           energy->wakeups, energy->redraws, (unsigned long)energy->text_draws, energy->persist_writes, energy->vibes);
+  text_layer_review_energy = text_layer_create(GRect(5, 18 + max_size.h + 15, frame.size.w-10, 2000));
+  text_layer_set_font(text_layer_review_energy, fonts_get_system_font(FONT_KEY_GOTHIC_18));
+  text_layer_set_text_alignment(text_layer_review_energy, GTextAlignmentLeft);
+  text_layer_set_text(text_layer_review_energy, energy_str);
+  GSize energy_size = text_layer_get_content_size(text_layer_review_energy);
+  text_layer_set_size(text_layer_review_energy, GSize(frame.size.w-10, energy_size.h + 5));
+
+  scroll_layer_set_content_size(scroll_layer_review, GSize(frame.size.w, max_size.h + 30 + energy_size.h + 5));
   scroll_layer_add_child(scroll_layer_review, text_layer_get_layer(text_layer_review_lap_num));
   scroll_layer_add_child(scroll_layer_review, text_layer_get_layer(text_layer_review_lap));
   scroll_layer_add_child(scroll_layer_review, text_layer_get_layer(text_layer_review_split));
+  scroll_layer_add_child(scroll_layer_review, text_layer_get_layer(text_layer_review_energy));
   layer_add_child(window_layer, scroll_layer_get_layer(scroll_layer_review));
   
   // Warning layers
@@ -277,6 +293,7 @@ void window_unload_review(Window *window) {
   text_layer_destroy(text_layer_review_lap_num);
   text_layer_destroy(text_layer_review_lap);
   text_layer_destroy(text_layer_review_split);
+  text_layer_destroy(text_layer_review_energy);
   scroll_layer_destroy(scroll_layer_review);
 }
 //----- End review window load/unload
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "ui_timer_config.h"
 #include "swtime.h"
 #include "cdt.h"
+#include "layout.auto.h"
   
 // Instant recall window and layers
 static Window *window;
@@ -24,7 +25,7 @@ static void update_displayed_focus(void);
 // Main string container
 static char text_header[26];
 static char text_digit[3][3];      // Fixed-length substring
-static unsigned char timer_index;  // Timer config index
+static uint16_t timer_index;       // Timer config index
 static unsigned char focus_index;  // One of enum_fields
 static SWTime new_lap_time;
 
@@ -61,13 +62,13 @@ static void graphics_layer_update_callback(Layer *me, GContext *ctx) {
   graphics_context_set_fill_color(ctx, GColorBlack);
   switch(focus_index) {
     case FOCUS_INDEX_HOUR:
-      graphics_fill_rect(ctx, GRect(1,70,24,34), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_timer_config_focus[0], 5, GCornersAll);
       break;
     case FOCUS_INDEX_MINUTE:
-      graphics_fill_rect(ctx, GRect(34,70,50,34), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_timer_config_focus[1], 5, GCornersAll);
       break;
     case FOCUS_INDEX_SECOND:
-      graphics_fill_rect(ctx, GRect(93,70,50,34), 5, GCornersAll);
+      graphics_fill_rect(ctx, layout_timer_config_focus[2], 5, GCornersAll);
       break;
   }
 }
@@ -81,20 +82,18 @@ void window_load(Window *window) {
   layer_add_child(window_layer, graphics_layer);
   
   // Set up header (one time only)
-  text_layer_header = text_layer_create(GRect(0,35,144,30));
+  text_layer_header = text_layer_create(layout_timer_config_header);
   text_layer_set_font(text_layer_header, fonts_get_system_font(FONT_KEY_GOTHIC_24));
   text_layer_set_text_alignment(text_layer_header, GTextAlignmentCenter);
   snprintf(text_header, sizeof(text_header), "Edit Segment %d", timer_index+1);
   text_layer_set_text(text_layer_header, text_header);
   layer_add_child(window_layer, text_layer_get_layer(text_layer_header));
   
-  // Digit width=24, delimiter width=7
-  // Character height 35  
-  text_layer_digit[0]     = text_layer_create(GRect(0,65,26,40));
-  text_layer_delimiter[0] = text_layer_create(GRect(26,65,7,40));
-  text_layer_digit[1]     = text_layer_create(GRect(33,65,52,40));
-  text_layer_delimiter[1] = text_layer_create(GRect(85,65,7,40));
-  text_layer_digit[2]     = text_layer_create(GRect(92,65,52,40));
+  text_layer_digit[0]     = text_layer_create(layout_timer_config_entry[0]);
+  text_layer_delimiter[0] = text_layer_create(layout_timer_config_entry[1]);
+  text_layer_digit[1]     = text_layer_create(layout_timer_config_entry[2]);
+  text_layer_delimiter[1] = text_layer_create(layout_timer_config_entry[3]);
+  text_layer_digit[2]     = text_layer_create(layout_timer_config_entry[4]);
 
   text_layer_set_font(text_layer_digit[0],     fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS));
   text_layer_set_font(text_layer_delimiter[0], fonts_get_system_font(FONT_KEY_BITHAM_34_MEDIUM_NUMBERS));
@@ -124,9 +123,12 @@ void window_load(Window *window) {
 void window_disappear(Window *window) {
   cdt_t *cdt = cdt_get();
   
-  cdt_set_lap(timer_index, new_lap_time);
-  if (!(new_lap_time.hour==0 && new_lap_time.minute==0 && new_lap_time.second==0) && (timer_index == cdt->length)) {
-    cdt->length++;
+  uint16_t length = cdt->length;
+  
+  // The plan has run out of blocks or would run past 99 hours
+  if (!cdt_set_lap(timer_index, new_lap_time)) {
+    vibes_short_pulse();
+  } else if (cdt->length > length) {
     cdt->enable = (!cdt->enable) ? true : (cdt->enable);
   }
 }
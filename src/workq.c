@@ -0,0 +1,78 @@
+#include "pebble.h"
+#include "workq.h"
+#include "probe.h"
+#include "energy.h"
+
+typedef struct WorkqEntry {
+  WorkqJob job;
+  uint32_t arg;
+} WorkqEntry;
+
+// One ring per priority, each run in the order posted
+static WorkqEntry ring[WORKQ_NUM_PRIORITIES][WORKQ_RING_SIZE];
+static uint8_t head[WORKQ_NUM_PRIORITIES];
+static uint8_t count[WORKQ_NUM_PRIORITIES];
+static AppTimer *timer;
+
+// Run the oldest job of the highest priority waiting, false if none is
+static bool run_one(void) {
+  for (uint8_t p=0; p<WORKQ_NUM_PRIORITIES; p++) {
+    if (count[p] == 0) { continue; }
+    WorkqEntry entry = ring[p][head[p]];
+    head[p] = (head[p]+1) % WORKQ_RING_SIZE;
+    count[p]--;
+    entry.job(entry.arg);
+    return true;
+  }
+  return false;
+}
+
+// A bounded slice per wakeup, so a button press queued behind it waits for at
+// most WORKQ_SLICE_JOBS jobs
+static void timer_callback(void *data) {
+  PROBE_SCOPE(PROBE_WORKQ_SLICE);
+  energy_count(ENERGY_WAKEUP, 1);
+  timer = NULL;
+  for (uint8_t i=0; i<WORKQ_SLICE_JOBS && run_one(); i++) {}
+  if (timer == NULL && workq_get_pending() > 0) {
+    timer = app_timer_register(0, timer_callback, NULL);
+  }
+}
+
+// Run job(arg) after the current handler returns. Never drops a job: with its
+// ring full, the job runs right away instead
+void workq_post(uint8_t priority, WorkqJob job, uint32_t arg) {
+  if (count[priority] >= WORKQ_RING_SIZE) {
+    job(arg);
+    return;
+  }
+  ring[priority][(head[priority]+count[priority]) % WORKQ_RING_SIZE] = (WorkqEntry){job, arg};
+  count[priority]++;
+  if (timer == NULL) {
+    timer = app_timer_register(0, timer_callback, NULL);
+  }
+}
+
+uint8_t workq_get_pending(void) {
+  uint8_t pending = 0;
+  for (uint8_t p=0; p<WORKQ_NUM_PRIORITIES; p++) { pending += count[p]; }
+  return pending;
+}
+
+// Run everything waiting now, e.g. before persisting on exit
+void workq_flush(void) {
+  while (run_one()) {}
+  if (timer != NULL) {
+    app_timer_cancel(timer);
+    timer = NULL;
+  }
+}
+
+void workq_init(void) {
+  for (uint8_t p=0; p<WORKQ_NUM_PRIORITIES; p++) { head[p] = count[p] = 0; }
+  timer = NULL;
+}
+
+void workq_deinit(void) {
+  workq_flush();
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef WORKQ_H
+#define WORKQ_H
+#include "pebble.h"
+
+#define WORKQ_RING_SIZE   8   // Jobs waiting per priority
+#define WORKQ_SLICE_JOBS  2   // Jobs run per wakeup before button events get a turn
+
+// Highest first: what is on screen, then session bookkeeping, then the phone
+enum workq_priority_e {WORKQ_PRIORITY_UI,
+                       WORKQ_PRIORITY_BOOKKEEPING,
+                       WORKQ_PRIORITY_BACKGROUND,
+                       WORKQ_NUM_PRIORITIES};
+
+typedef void (*WorkqJob)(uint32_t);
+
+extern void workq_post(uint8_t, WorkqJob, uint32_t);
+extern uint8_t workq_get_pending(void);
+extern void workq_flush(void);
+
+extern void workq_init(void);
+extern void workq_deinit(void);
+
+#endif
\ No newline at end of file